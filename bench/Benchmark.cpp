@@ -0,0 +1,1452 @@
+// Benchmark.cpp
+//
+// Benchmarks for the MC Simulator, in the order they run:
+// - random number generators: normals/sec, one draw at a time against the batched fill
+// - Sobol + Brownian bridge against pseudo-random paths: error on an Asian option
+// - Euler steps/sec of the scalar loop against the SIMD block kernels
+// - strong and weak convergence of the schemes against NT
+// - exact GBM stepper in log space against the former one
+// - vector exp, log, pow, sqrt and sincos: accuracy (ulp against libm) and values/sec
+// - paths/sec of the virtual mediator against the statically dispatched engine
+// - stored paths against streamed path statistics
+// - plain against antithetic sampling at equal error
+// - variance reduction of the closed-form control variates
+// - adaptive runs against the fixed run at a target standard error
+// - cost of multilevel against standard MC at a target RMS error
+// - single-pass Greeks (pathwise / likelihood ratio) against bump-and-revalue
+// - adjoint (AAD) sensitivities against bump-and-revalue
+// - one portfolio run against one run per contract
+// - 100-strike grid against a single strike and against one pricer per strike
+// - batch runner (jobs/h) on a mix of short and long jobs, sequential against the thread pool
+// - replaying recorded paths against simulating them again
+// - inline random draws against the generator thread pipeline
+// - throughput of the chunked parallel engine (paths/sec) against the number of threads
+//
+// Pierre-Yves Sojic
+//
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "AADEngine.hpp"
+#include "BatchRunner.hpp"
+#include "ClosedForm.hpp"
+#include "FDMDerived.hpp"
+#include "MCDispatch.hpp"
+#include "MCMediator.hpp"
+#include "MLMC.hpp"
+#include "PathStore.hpp"
+#include "PricerDerived.hpp"
+#include "RNGDerived.hpp"
+#include "SDEConcrete.hpp"
+#include "SIMDKernels.hpp"
+#include "SIMDMath.hpp"
+#include "StopWatch.hpp"
+
+namespace
+{
+	std::shared_ptr<OptionData> benchmark_data()
+	{
+		std::shared_ptr<OptionData> od = std::make_shared<OptionData>();
+		od->S0 = 100;
+		od->K = 100;
+		od->T = 1.0;
+		od->vol = 0.3;
+		od->r = 0.08;
+		od->q = 0.0;
+
+		return od;
+	}
+
+	double normals_per_second(const RNGAbstract& rng, bool batched, std::size_t nDraws, std::size_t blockSize)
+	{
+		std::vector<double> block(blockSize);
+		double sink{};
+		StopWatch sw;
+
+		sw.Start();
+		for (std::size_t done = 0; done < nDraws; done += blockSize)
+		{
+			if (batched)
+			{
+				rng.fill(block);
+			}
+			else
+			{
+				for (double& z : block)
+					z = rng.generate_rn();
+			}
+			sink += block.back();
+		}
+		sw.Stop();
+
+		volatile double keep = sink; // Keeps the compiler from optimising the draws away
+		(void)keep;
+
+		return static_cast<double>(nDraws) / sw.GetTime();
+	}
+
+	void rng_benchmark()
+	{
+		const std::size_t nDraws = 10'000'000;
+		const std::size_t blockSize = 256;
+
+		std::cout << "RNG throughput, " << nDraws << " normals, block = " << blockSize << "\n\n";
+		std::cout << std::setw(20) << "generator" << std::setw(18) << "generate_rn/sec" << std::setw(16) << "fill/sec"
+			<< std::setw(12) << "speedup" << '\n';
+
+		auto row = [&](const char* name, const RNGAbstract& rng)
+			{
+				double single = normals_per_second(rng, false, nDraws, blockSize);
+				double batched = normals_per_second(rng, true, nDraws, blockSize);
+				std::cout << std::setw(20) << name << std::setw(18) << std::fixed << std::setprecision(0) << single
+					<< std::setw(16) << batched << std::setw(12) << std::setprecision(2) << batched / single << '\n';
+			};
+
+		row("MersenneTwister", MersenneTwister{});
+		row("PolarMarsagliaNet", PolarMarsagliaNet{});
+		row("BoxMuller", BoxMuller{});
+		row("Philox", Philox{ 1 });
+		std::cout << '\n';
+	}
+
+	// Asian call price for one replication (seed) of nSim paths
+	double asian_call(const std::shared_ptr<OptionData>& od, std::unique_ptr<RNGAbstract> rng, std::size_t nSim, std::size_t NT)
+	{
+		SDEBase<GBM> sde(GBM{ od });
+		MCMediator<GBM>::PartsTuple parts = std::make_tuple(sde, std::make_unique<EulerFDM<GBM>>(sde, NT), std::move(rng));
+
+		auto pricer = std::make_shared<AsianPricer>([od](double a) { return std::max(a - od->K, 0.0); },
+			[od](double a) { return std::max(od->K - a, 0.0); }, [od]() { return std::exp(-od->r * od->T); }, 0);
+		pricer->set_display(false);
+
+		MCMediator<GBM> mediator(parts, [pricer](std::size_t n) { pricer->prepare(n); },
+			[pricer](const std::vector<double>& p, std::size_t slot) { pricer->process_path(p, slot); },
+			[pricer](double d) { pricer->post_process(d); }, nSim);
+		mediator.start();
+
+		return pricer->call_price();
+	}
+
+	// Standard error of the mean of independent replications
+	double replication_error(const std::vector<double>& prices)
+	{
+		double mean{}, var{};
+		for (double p : prices)
+			mean += p;
+		mean /= prices.size();
+		for (double p : prices)
+			var += (p - mean) * (p - mean);
+
+		return std::sqrt(var / (prices.size() - 1) / prices.size());
+	}
+
+	void qmc_benchmark()
+	{
+		const std::size_t NT = 64;
+		const std::size_t replications = 16;
+		auto od = benchmark_data();
+
+		std::cout << "Asian call error, GBM / Euler, NT = " << NT << ", " << replications
+			<< " replications (Philox seeds vs Owen-scrambled Sobol + Brownian bridge)\n\n";
+		std::cout << std::setw(10) << "paths" << std::setw(16) << "MC stderr" << std::setw(16) << "QMC stderr"
+			<< std::setw(16) << "paths ratio" << '\n';
+
+		for (std::size_t nSim = 1024; nSim <= 16384; nSim *= 4)
+		{
+			std::vector<double> mc, qmc;
+			for (std::size_t r = 0; r < replications; ++r)
+			{
+				mc.push_back(asian_call(od, std::make_unique<Philox>(r + 1), nSim, NT));
+				qmc.push_back(asian_call(od, std::make_unique<Sobol>(NT, Sobol::Scrambling::Owen, r + 1), nSim, NT));
+			}
+
+			double mcError = replication_error(mc);
+			double qmcError = replication_error(qmc);
+			// Paths needed by MC to match the QMC error (error ~ 1/sqrt(N))
+			std::cout << '\r' << std::setw(10) << nSim << std::setw(16) << std::scientific << std::setprecision(3) << mcError
+				<< std::setw(16) << qmcError << std::setw(16) << std::fixed << std::setprecision(1)
+				<< (mcError * mcError) / (qmcError * qmcError) << '\n';
+		}
+		std::cout << '\n';
+	}
+
+	// Euler steps/sec on one core, normals drawn beforehand so that only the stepping is timed
+	template <typename SDE>
+	double steps_per_second(const std::shared_ptr<OptionData>& od, bool block, std::size_t blockSize, std::size_t NT)
+	{
+		SDEBase<SDE> sde(SDE{ od });
+		EulerFDM<SDE> fdm(sde, NT);
+		std::vector<double> mesh = fdm.get_mesh();
+		double dt = fdm.get_meshSize();
+
+		std::vector<double> normals(NT * blockSize);
+		Philox(1).fill(normals);
+		std::vector<double> paths((NT + 1) * blockSize, od->S0);
+
+		const std::size_t repetitions = 200;
+		StopWatch sw;
+		sw.Start();
+		for (std::size_t rep = 0; rep < repetitions; ++rep)
+		{
+			if (block)
+			{ // Structure of arrays, one kernel call per time step
+				for (std::size_t j = 1; j <= NT; ++j)
+					fdm.advance_block({ paths.data() + (j - 1) * blockSize, blockSize }, mesh[j - 1], dt,
+						{ normals.data() + (j - 1) * blockSize, blockSize }, { paths.data() + j * blockSize, blockSize });
+			}
+			else
+			{ // One virtual call per step and path, as in the scalar engine
+				const FDMAbstract<SDE>& base = fdm;
+				for (std::size_t p = 0; p < blockSize; ++p)
+				{
+					double* path = paths.data() + p * (NT + 1);
+					for (std::size_t j = 1; j <= NT; ++j)
+						path[j] = base.advance(path[j - 1], mesh[j - 1], dt, normals[p * NT + j - 1], 0.0);
+				}
+			}
+		}
+		sw.Stop();
+
+		volatile double keep = paths.back();
+		(void)keep;
+
+		return static_cast<double>(repetitions * blockSize * NT) / sw.GetTime();
+	}
+
+	void stepping_benchmark()
+	{
+		const std::size_t NT = 256;
+		const std::size_t blockSize = 64;
+		auto od = benchmark_data();
+		od->betaCEV = 0.8;
+
+		std::cout << "Euler steps/sec on one core, NT = " << NT << ", block = " << blockSize
+			<< ", CPU: " << simd::isa_name(simd::detected_isa()) << "\n\n";
+		std::cout << std::setw(8) << "SDE" << std::setw(12) << "kernel" << std::setw(16) << "steps/sec" << std::setw(12) << "speedup" << '\n';
+
+		auto rows = [&]<typename SDE>(const char* name)
+			{
+				double scalar = steps_per_second<SDE>(od, false, blockSize, NT);
+				std::cout << std::setw(8) << name << std::setw(12) << "loop" << std::setw(16) << std::fixed << std::setprecision(0)
+					<< scalar << std::setw(12) << std::setprecision(2) << 1.0 << '\n';
+
+				for (simd::ISA isa : { simd::ISA::Scalar, simd::ISA::AVX2, simd::ISA::AVX512 })
+				{
+					if (isa > simd::detected_isa())
+						break;
+					simd::set_isa(isa);
+					double rate = steps_per_second<SDE>(od, true, blockSize, NT);
+					std::cout << std::setw(8) << name << std::setw(12) << simd::isa_name(isa) << std::setw(16) << std::setprecision(0)
+						<< rate << std::setw(12) << std::setprecision(2) << rate / scalar << '\n';
+				}
+				simd::set_isa(simd::detected_isa());
+			};
+
+		rows.template operator()<GBM>("GBM");
+		rows.template operator()<CEV>("CEV");
+		std::cout << '\n';
+	}
+
+	// Strong (RMS of S_T against the reference on the same Brownian path) and weak (call price) errors of the schemes against NT.
+	// The coarse normals are sums of the fine ones: reference = exact solution (GBM) or Milstein on the finest grid (CEV)
+	template <typename SDE>
+	void scheme_convergence_rows(const char* name, const std::shared_ptr<OptionData>& od, std::size_t nPaths)
+	{
+		const std::size_t fineNT = 1024;
+		const std::vector<std::size_t> steps{ 4, 8, 16, 32, 64, 128 };
+		SDEBase<SDE> sde{ SDE(od) };
+		Philox rng(7);
+		double discount = std::exp(-od->r * od->T);
+
+		std::vector<std::pair<const char*, std::function<std::unique_ptr<FDMAbstract<SDE>>(std::size_t)>>> schemes{
+			{ "Euler", [&](std::size_t NT) { return std::make_unique<EulerFDM<SDE>>(sde, NT); } },
+			{ "Milstein", [&](std::size_t NT) { return std::make_unique<MilsteinFDM<SDE>>(sde, NT); } },
+			{ "Pred-corr", [&](std::size_t NT) { return std::make_unique<PredictorCorrectorFDM<SDE>>(sde, NT); } },
+			{ "Log-Euler", [&](std::size_t NT) { return std::make_unique<LogEulerFDM<SDE>>(sde, NT); } } };
+
+		// Fine normals and reference terminal values
+		std::vector<double> normals(nPaths * fineNT);
+		std::vector<double> reference(nPaths);
+		MilsteinFDM<SDE> fine(sde, fineNT);
+		double fineDt = od->T / fineNT;
+		double referencePrice{};
+		for (std::size_t i = 0; i < nPaths; ++i)
+		{
+			double* z = normals.data() + i * fineNT;
+			rng.seek(i);
+			rng.fill({ z, fineNT });
+			double x = od->S0;
+			if constexpr (std::is_same_v<SDE, GBM>)
+			{
+				double W = 0.0;
+				for (std::size_t j = 0; j < fineNT; ++j)
+					W += std::sqrt(fineDt) * z[j];
+				x = od->S0 * std::exp((od->r - od->q - 0.5 * od->vol * od->vol) * od->T + od->vol * W);
+			}
+			else
+			{
+				for (std::size_t j = 0; j < fineNT; ++j)
+					x = fine.advance(x, j * fineDt, fineDt, z[j], 0.0);
+			}
+			reference[i] = x;
+			referencePrice += std::max(x - od->K, 0.0);
+		}
+		referencePrice *= discount / nPaths;
+
+		for (const auto& [scheme, make] : schemes)
+		{
+			double previous{};
+			for (std::size_t NT : steps)
+			{
+				auto fdm = make(NT);
+				std::size_t m = fineNT / NT;
+				double dt = od->T / NT;
+				double squares{}, price{};
+
+				StopWatch sw;
+				sw.Start();
+				for (std::size_t i = 0; i < nPaths; ++i)
+				{
+					const double* z = normals.data() + i * fineNT;
+					double x = od->S0;
+					for (std::size_t j = 0; j < NT; ++j)
+					{
+						double sum{};
+						for (std::size_t k = 0; k < m; ++k)
+							sum += z[j * m + k];
+						x = fdm->advance(x, j * dt, dt, sum / std::sqrt(static_cast<double>(m)), 0.0);
+					}
+					squares += (x - reference[i]) * (x - reference[i]);
+					price += std::max(x - od->K, 0.0);
+				}
+				sw.Stop();
+				double strong = std::sqrt(squares / nPaths);
+				price *= discount / nPaths;
+
+				std::cout << std::setw(6) << name << std::setw(12) << scheme << std::setw(8) << NT << std::setw(16) << std::scientific << std::setprecision(2)
+					<< strong << std::setw(10) << std::fixed << std::setprecision(2);
+				if (previous > 0.0)
+					std::cout << std::log2(previous / strong);
+				else
+					std::cout << "-";
+				std::cout << std::setw(16) << std::scientific << std::setprecision(2) << std::abs(price - referencePrice) << std::setw(14) << std::fixed
+					<< std::setprecision(3) << 1e3 * sw.GetTime() << '\n';
+				previous = strong;
+			}
+		}
+	}
+
+	void scheme_convergence_benchmark()
+	{
+		const std::size_t nPaths = 20'000;
+		auto od = benchmark_data();
+
+		std::cout << "Scheme convergence against NT, " << nPaths << " paths on the same Brownian paths as the reference (fine grid of 1024 steps)\n\n";
+		std::cout << std::setw(6) << "SDE" << std::setw(12) << "scheme" << std::setw(8) << "NT" << std::setw(16) << "strong error" << std::setw(10)
+			<< "order" << std::setw(16) << "weak error" << std::setw(14) << "time (ms)" << '\n';
+
+		scheme_convergence_rows<GBM>("GBM", od, nPaths);
+		od->betaCEV = 0.5;
+		od->vol = 0.3 * std::pow(od->S0, 1.0 - od->betaCEV); // Same local volatility as GBM at S0
+		scheme_convergence_rows<CEV>("CEV", od, nPaths);
+		std::cout << '\n';
+	}
+
+	void exact_stepping_benchmark()
+	{
+		const std::size_t NT = 256;
+		const std::size_t blockSize = 64;
+		const std::size_t repetitions = 200;
+		auto od = benchmark_data();
+		SDEBase<GBM> sde(GBM{ od });
+		ExactFDM<GBM> fdm(sde, NT, od->vol, od->r, od->q);
+		std::vector<double> mesh = fdm.get_mesh();
+		double dt = fdm.get_meshSize();
+
+		std::vector<double> normals(NT * blockSize);
+		Philox(1).fill(normals);
+		std::vector<double> paths((NT + 1) * blockSize, od->S0);
+
+		std::cout << "Exact GBM steps/sec on one core, NT = " << NT << ", block = " << blockSize << "\n\n";
+		std::cout << std::setw(36) << "stepping" << std::setw(16) << "steps/sec" << std::setw(12) << "speedup" << std::setw(16) << "max rel. diff" << '\n';
+
+		auto run = [&](const std::function<void()>& step)
+			{
+				StopWatch sw;
+				sw.Start();
+				for (std::size_t rep = 0; rep < repetitions; ++rep)
+					step();
+				sw.Stop();
+				return static_cast<double>(repetitions * blockSize * NT) / sw.GetTime();
+			};
+		auto difference = [&](const std::vector<double>& reference)
+			{
+				double d{};
+				for (std::size_t i = 0; i < paths.size(); ++i)
+					d = std::max(d, std::abs(paths[i] / reference[i] - 1.0));
+				return d;
+			};
+
+		// Former stepper: full transcendental chain from S0 on every step (whole-path draws, ignores the previous state)
+		double a = od->r - 0.5 * od->vol * od->vol;
+		double base = run([&]()
+			{
+				for (std::size_t j = 1; j <= NT; ++j)
+					for (std::size_t p = 0; p < blockSize; ++p)
+						paths[j * blockSize + p] = od->S0 * std::exp(a * (mesh[j - 1] + dt) + od->vol * std::sqrt(mesh[j - 1] + dt) * normals[(j - 1) * blockSize + p]);
+			});
+		std::cout << std::setw(36) << "exp from S0 per step (former)" << std::setw(16) << std::fixed << std::setprecision(0) << base
+			<< std::setw(12) << std::setprecision(2) << 1.0 << std::setw(16) << "-" << '\n';
+
+		double rate = run([&]()
+			{
+				for (std::size_t j = 1; j <= NT; ++j)
+					for (std::size_t p = 0; p < blockSize; ++p)
+						paths[j * blockSize + p] = fdm.advance(paths[(j - 1) * blockSize + p], mesh[j - 1], dt, normals[(j - 1) * blockSize + p], 0.0);
+			});
+		std::vector<double> reference = paths;
+		std::cout << std::setw(36) << "advance (libm exp per step)" << std::setw(16) << std::setprecision(0) << rate << std::setw(12)
+			<< std::setprecision(2) << rate / base << std::setw(16) << "-" << '\n';
+
+		rate = run([&]()
+			{
+				for (std::size_t j = 1; j <= NT; ++j)
+					fdm.advance_block({ paths.data() + (j - 1) * blockSize, blockSize }, mesh[j - 1], dt,
+						{ normals.data() + (j - 1) * blockSize, blockSize }, { paths.data() + j * blockSize, blockSize });
+			});
+		std::cout << std::setw(36) << "advance_block (vector exp per step)" << std::setw(16) << std::setprecision(0) << rate << std::setw(12)
+			<< std::setprecision(2) << rate / base << std::setw(16) << std::scientific << difference(reference) << std::fixed << '\n';
+
+		rate = run([&]()
+			{ // Log-increments summed with one FMA per step, spot values only at maturity
+				std::fill(paths.begin(), paths.begin() + blockSize, std::log(od->S0));
+				for (std::size_t j = 1; j <= NT; ++j)
+					fdm.log_advance_block({ paths.data() + (j - 1) * blockSize, blockSize }, mesh[j - 1], dt,
+						{ normals.data() + (j - 1) * blockSize, blockSize }, { paths.data() + j * blockSize, blockSize });
+				simd::exp(paths.data() + NT * blockSize, paths.data() + NT * blockSize, blockSize);
+			});
+		double terminal{};
+		for (std::size_t p = 0; p < blockSize; ++p)
+			terminal = std::max(terminal, std::abs(paths[NT * blockSize + p] / reference[NT * blockSize + p] - 1.0));
+		std::cout << std::setw(36) << "log space, exp at maturity" << std::setw(16) << std::setprecision(0) << rate << std::setw(12)
+			<< std::setprecision(2) << rate / base << std::setw(16) << std::scientific << terminal << std::fixed << '\n';
+
+		rate = run([&]()
+			{ // Log space, then every spot value of the block at once
+				std::fill(paths.begin(), paths.begin() + blockSize, std::log(od->S0));
+				for (std::size_t j = 1; j <= NT; ++j)
+					fdm.log_advance_block({ paths.data() + (j - 1) * blockSize, blockSize }, mesh[j - 1], dt,
+						{ normals.data() + (j - 1) * blockSize, blockSize }, { paths.data() + j * blockSize, blockSize });
+				simd::exp(paths.data() + blockSize, paths.data() + blockSize, NT * blockSize);
+				std::fill(paths.begin(), paths.begin() + blockSize, od->S0);
+			});
+		std::cout << std::setw(36) << "log space, exp of the whole path" << std::setw(16) << std::setprecision(0) << rate << std::setw(12)
+			<< std::setprecision(2) << rate / base << std::setw(16) << std::scientific << difference(reference) << std::fixed << "\n\n";
+	}
+
+	// Distance in units in the last place between two doubles (0 when both are NaN)
+	double ulp_distance(double a, double b)
+	{
+		if (a == b || (std::isnan(a) && std::isnan(b)))
+			return 0.0;
+		if (std::isnan(a) || std::isnan(b))
+			return std::numeric_limits<double>::infinity();
+
+		// Bit patterns mapped to a monotone integer line
+		auto ordered = [](double x)
+			{
+				std::int64_t i = std::bit_cast<std::int64_t>(x);
+				return i < 0 ? std::numeric_limits<std::int64_t>::min() - i : i;
+			};
+		std::uint64_t ia = static_cast<std::uint64_t>(ordered(a)), ib = static_cast<std::uint64_t>(ordered(b));
+		return static_cast<double>(std::bit_cast<std::int64_t>(ia - ib) < 0 ? ib - ia : ia - ib); // Integer difference, exact
+	}
+
+	// Accuracy of the vector math against libm (max ulp on random arguments and special values) and its throughput.
+	// Returns false if a function is more than 2 ulp away from libm
+	bool math_benchmark()
+	{
+		const std::size_t nValues = 1'000'000;
+		const std::size_t blockSize = 1024;
+		const std::size_t repetitions = 20'000;
+		const double maxUlp = 2.0;
+		const double beta = 0.7;   // Exponent of pow (CEV elasticity)
+		const std::vector<double> specials{ 0.0, -0.0, 1.0, -1.0, 1e-310, 1e300, -745.0, 710.0, std::numbers::pi / 2, std::numbers::pi, 2e5,
+			std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN() };
+
+		struct Function
+		{
+			const char* name;
+			const char* domain;
+			std::function<double(std::mt19937_64&)> argument;
+			std::function<double(double)> libm;
+			std::function<void(const double*, double*, std::size_t)> vector;
+		};
+		std::uniform_real_distribution<double> unif(0.0, 1.0);
+		std::vector<Function> functions{
+			{ "exp", "[-745, 710]", [&](std::mt19937_64& g) { return -745.0 + 1455.0 * unif(g); }, [](double x) { return std::exp(x); },
+				[](const double* x, double* y, std::size_t n) { simd::exp(x, y, n); } },
+			{ "log", "e^[-700, 700]", [&](std::mt19937_64& g) { return std::exp(-700.0 + 1400.0 * unif(g)); }, [](double x) { return std::log(x); },
+				[](const double* x, double* y, std::size_t n) { simd::log(x, y, n); } },
+			{ "log", "(0, 1)", [&](std::mt19937_64& g) { return unif(g); }, [](double x) { return std::log(x); },
+				[](const double* x, double* y, std::size_t n) { simd::log(x, y, n); } },
+			{ "pow(x, 0.7)", "e^[-30, 30]", [&](std::mt19937_64& g) { return std::exp(-30.0 + 60.0 * unif(g)); }, [&](double x) { return std::pow(x, beta); },
+				[&](const double* x, double* y, std::size_t n) { simd::pow(x, beta, y, n); } },
+			{ "pow(x, 17.3)", "e^[-30, 30]", [&](std::mt19937_64& g) { return std::exp(-30.0 + 60.0 * unif(g)); }, [](double x) { return std::pow(x, 17.3); },
+				[](const double* x, double* y, std::size_t n) { simd::pow(x, 17.3, y, n); } },
+			{ "sqrt", "e^[-30, 30]", [&](std::mt19937_64& g) { return std::exp(-30.0 + 60.0 * unif(g)); }, [](double x) { return std::sqrt(x); },
+				[](const double* x, double* y, std::size_t n) { simd::sqrt(x, y, n); } },
+			{ "sin", "[-1e5, 1e5]", [&](std::mt19937_64& g) { return -1e5 + 2e5 * unif(g); }, [](double x) { return std::sin(x); },
+				[](const double* x, double* y, std::size_t n) { std::vector<double> c(n); simd::sincos(x, y, c.data(), n); } },
+			{ "cos", "[0, 2 pi)", [&](std::mt19937_64& g) { return 2.0 * std::numbers::pi * unif(g); }, [](double x) { return std::cos(x); },
+				[](const double* x, double* y, std::size_t n) { std::vector<double> s(n); simd::sincos(x, s.data(), y, n); } } };
+
+		std::cout << "Vector math against libm, " << nValues << " random arguments + special values, CPU: " << simd::isa_name(simd::detected_isa()) << "\n\n";
+		std::cout << std::setw(14) << "function" << std::setw(16) << "domain" << std::setw(10) << "ISA" << std::setw(10) << "max ulp" << std::setw(8) << "" << '\n';
+
+		bool accurate = true;
+		std::vector<double> x(nValues), y(nValues);
+		for (const Function& f : functions)
+		{
+			std::mt19937_64 gen(11);
+			for (double& v : x)
+				v = f.argument(gen);
+			std::copy(specials.begin(), specials.end(), x.begin());
+
+			for (simd::ISA isa : { simd::ISA::AVX2, simd::ISA::AVX512 })
+			{
+				if (isa > simd::detected_isa())
+					break;
+				simd::set_isa(isa);
+				f.vector(x.data(), y.data(), nValues);
+
+				double worst{};
+				for (std::size_t i = 0; i < nValues; ++i)
+					worst = std::max(worst, ulp_distance(y[i], f.libm(x[i])));
+				accurate = accurate && worst <= maxUlp;
+				std::cout << std::setw(14) << f.name << std::setw(16) << f.domain << std::setw(10) << simd::isa_name(isa) << std::setw(10)
+					<< std::setprecision(0) << std::fixed << worst << std::setw(8) << (worst <= maxUlp ? "ok" : "FAILED") << '\n';
+			}
+			simd::set_isa(simd::detected_isa());
+		}
+
+		// Throughput on blocks of the size the engine works on
+		std::cout << "\nValues/sec on one core, block = " << blockSize << "\n\n";
+		std::cout << std::setw(14) << "function" << std::setw(16) << "libm" << std::setw(16) << simd::isa_name(simd::detected_isa())
+			<< std::setw(12) << "speedup" << '\n';
+
+		std::vector<double> in(blockSize), out(blockSize), out2(blockSize);
+		std::mt19937_64 gen(12);
+		for (double& v : in)
+			v = 0.01 + 2.0 * unif(gen);
+		auto rate = [&](const std::function<void()>& evaluate)
+			{
+				StopWatch sw;
+				sw.Start();
+				for (std::size_t rep = 0; rep < repetitions; ++rep)
+					evaluate();
+				sw.Stop();
+				volatile double keep = out.back();
+				(void)keep;
+				return static_cast<double>(repetitions * blockSize) / sw.GetTime();
+			};
+		auto row = [&](const char* name, const std::function<void()>& libm, const std::function<void()>& vector)
+			{
+				double base = rate(libm);
+				double fast = rate(vector);
+				std::cout << std::setw(14) << name << std::setw(16) << std::setprecision(0) << base << std::setw(16) << fast
+					<< std::setw(12) << std::setprecision(2) << fast / base << '\n';
+			};
+
+		row("exp", [&]() { for (std::size_t i = 0; i < blockSize; ++i) out[i] = std::exp(in[i]); },
+			[&]() { simd::exp(in.data(), out.data(), blockSize); });
+		row("log", [&]() { for (std::size_t i = 0; i < blockSize; ++i) out[i] = std::log(in[i]); },
+			[&]() { simd::log(in.data(), out.data(), blockSize); });
+		row("pow(x, 0.7)", [&]() { for (std::size_t i = 0; i < blockSize; ++i) out[i] = std::pow(in[i], beta); },
+			[&]() { simd::pow(in.data(), beta, out.data(), blockSize); });
+		row("sqrt", [&]() { for (std::size_t i = 0; i < blockSize; ++i) out[i] = std::sqrt(in[i]); },
+			[&]() { simd::sqrt(in.data(), out.data(), blockSize); });
+		row("sin + cos", [&]() { for (std::size_t i = 0; i < blockSize; ++i) { out[i] = std::sin(in[i]); out2[i] = std::cos(in[i]); } },
+			[&]() { simd::sincos(in.data(), out.data(), out2.data(), blockSize); });
+		std::cout << '\n';
+
+		return accurate;
+	}
+
+	void dispatch_benchmark()
+	{
+		const std::size_t nSim = 100'000;
+		const std::size_t NT = 256;
+		auto od = benchmark_data();
+		auto discounter = [od]() { return std::exp(-od->r * od->T); };
+
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng(1);
+
+		std::cout << "Scalar engine on one thread, GBM / Euler / Philox / European, NSim = " << nSim << ", NT = " << NT << "\n\n";
+		std::cout << std::setw(24) << "engine" << std::setw(16) << "paths/sec" << std::setw(12) << "speedup" << '\n';
+
+		// Virtual calls and std::function callbacks
+		auto mediatorPricer = std::make_shared<EuropeanPricer>([od](double a) { return std::max(a - od->K, 0.0); },
+			[od](double a) { return std::max(od->K - a, 0.0); }, discounter, 0);
+		mediatorPricer->set_display(false);
+		MCMediator<GBM>::PartsTuple parts = std::make_tuple(sde, std::make_unique<EulerFDM<GBM>>(sde, NT), std::make_unique<Philox>(1));
+		MCMediator<GBM> mediator(parts, [mediatorPricer](std::size_t n) { mediatorPricer->prepare(n); },
+			[mediatorPricer](const std::vector<double>& p, std::size_t slot) { mediatorPricer->process_path(p, slot); },
+			[mediatorPricer](double d) { mediatorPricer->post_process(d); }, nSim);
+		mediator.set_thread_count(1);
+		StopWatch sw;
+		sw.Start();
+		mediator.start();
+		sw.Stop();
+		double virtualRate = nSim / sw.GetTime();
+
+		// Concrete types found at runtime, calls resolved at compile time
+		EuropeanPricer pricer(od->K, discounter, 0);
+		pricer.set_display(false);
+		sw.Reset();
+		sw.Start();
+		run_dispatched(sde, static_cast<const FDMAbstract<GBM>&>(fdm), rng, pricer, nSim, [](auto& engine) { engine.set_thread_count(1); });
+		sw.Stop();
+		double staticRate = nSim / sw.GetTime();
+
+		std::cout << '\r' << std::setw(24) << "mediator (virtual)" << std::setw(16) << std::fixed << std::setprecision(0) << virtualRate
+			<< std::setw(12) << std::setprecision(2) << 1.0 << '\n';
+		std::cout << std::setw(24) << "dispatched (static)" << std::setw(16) << std::setprecision(0) << staticRate
+			<< std::setw(12) << std::setprecision(2) << staticRate / virtualRate << '\n';
+		std::cout << "Same prices: " << std::boolalpha << (pricer.call_price() == mediatorPricer->call_price()) << "\n\n";
+	}
+
+	void streaming_benchmark()
+	{
+		const std::size_t nSim = 20'000;
+		const std::size_t NT = 2048;
+		const std::size_t blockSize = 64;
+		auto od = benchmark_data();
+
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng(1);
+
+		std::cout << "Block engine on one thread, GBM / Euler / Philox / Asian, NSim = " << nSim << ", NT = " << NT
+			<< ", block = " << blockSize << "\n\n";
+		std::cout << std::setw(24) << "pricer input" << std::setw(16) << "paths/sec" << std::setw(16) << "path memory" << '\n';
+
+		double rates[2]{};
+		double prices[2]{};
+		for (bool streaming : { false, true })
+		{
+			AsianPricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+			pricer.set_display(false);
+
+			MCEngine<GBM, EulerFDM<GBM>, Philox, AsianPricer> engine(sde, fdm, rng, pricer, nSim);
+			engine.set_thread_count(1);
+			engine.set_block_size(blockSize);
+			engine.set_streaming(streaming);
+
+			StopWatch sw;
+			sw.Start();
+			engine.start();
+			sw.Stop();
+
+			rates[streaming] = nSim / sw.GetTime();
+			prices[streaming] = pricer.call_price();
+			std::size_t bytes = (streaming ? 6 : NT + 1) * blockSize * sizeof(double);
+			std::cout << '\r' << std::setw(24) << (streaming ? "streamed statistics" : "stored paths") << std::setw(16) << std::fixed
+				<< std::setprecision(0) << rates[streaming] << std::setw(14) << bytes / 1024.0 << "KB" << '\n';
+		}
+		std::cout << "Speedup: " << std::setprecision(2) << rates[1] / rates[0] << ", same prices: " << std::boolalpha
+			<< (prices[0] == prices[1]) << "\n\n";
+	}
+
+	// Runs replications of nSim paths (seeds 1, 2, ...), returns the time per run and the call prices
+	template <typename Pricer>
+	std::pair<double, std::vector<double>> european_runs(const std::shared_ptr<OptionData>& od, std::size_t nSim, std::size_t NT,
+		std::size_t replications, bool antithetic)
+	{
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		std::vector<double> prices;
+		double duration{};
+
+		for (std::size_t r = 0; r < replications; ++r)
+		{
+			Philox rng(r + 1);
+			Pricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+			pricer.set_display(false);
+
+			MCEngine<GBM, EulerFDM<GBM>, Philox, Pricer> engine(sde, fdm, rng, pricer, nSim);
+			engine.set_thread_count(1);
+			engine.set_block_size(64);
+			engine.set_antithetic(antithetic);
+
+			StopWatch sw;
+			sw.Start();
+			engine.start();
+			sw.Stop();
+
+			duration += sw.GetTime();
+			prices.push_back(pricer.call_price());
+		}
+
+		return { duration / replications, prices };
+	}
+
+	void antithetic_benchmark()
+	{
+		const std::size_t nSim = 20'000;
+		const std::size_t NT = 128;
+		const std::size_t replications = 32;
+		auto od = benchmark_data();
+
+		std::cout << "Antithetic variates on one thread, GBM / Euler / Philox, NSim = " << nSim << " paths, NT = " << NT
+			<< ", " << replications << " replications\n\n";
+		std::cout << std::setw(12) << "option" << std::setw(14) << "sampling" << std::setw(14) << "time (s)" << std::setw(14) << "stderr"
+			<< std::setw(14) << "efficiency" << '\n';
+
+		auto rows = [&]<typename Pricer>(const char* name)
+			{
+				double base{};
+				for (bool antithetic : { false, true })
+				{
+					auto [time, prices] = european_runs<Pricer>(od, nSim, NT, replications, antithetic);
+					double error = replication_error(prices);
+					// Work-normalised variance: time x error^2 for the same error target
+					double cost = time * error * error;
+					if (!antithetic)
+						base = cost;
+
+					std::cout << '\r' << std::setw(12) << name << std::setw(14) << (antithetic ? "antithetic" : "plain") << std::setw(14)
+						<< std::fixed << std::setprecision(4) << time << std::setw(14) << std::scientific << std::setprecision(3) << error
+						<< std::setw(14) << std::fixed << std::setprecision(2) << base / cost << '\n';
+				}
+			};
+
+		rows.template operator()<EuropeanPricer>("European");
+		rows.template operator()<AsianPricer>("Asian");
+		std::cout << '\n';
+	}
+
+	// Control variates on one pricer: variance reduction factor and cost per path against the plain run
+	template <typename Pricer>
+	void control_rows(const char* name, const std::shared_ptr<OptionData>& od, std::size_t nSim, std::size_t NT,
+		const std::vector<ControlVariate>& controls, const std::function<void(Pricer&)>& setup = {})
+	{
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng(1);
+		double times[2]{};
+
+		for (bool controlled : { false, true })
+		{
+			Pricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+			pricer.set_display(false);
+			if (setup)
+				setup(pricer);
+			if (controlled)
+			{
+				for (const ControlVariate& control : controls)
+					pricer.add_control(control);
+			}
+
+			MCEngine<GBM, EulerFDM<GBM>, Philox, Pricer> engine(sde, fdm, rng, pricer, nSim);
+			engine.set_thread_count(1);
+			engine.set_block_size(64);
+
+			StopWatch sw;
+			sw.Start();
+			engine.start();
+			sw.Stop();
+			times[controlled] = sw.GetTime();
+
+			if (controlled)
+			{ // Speedup at equal error: fewer paths by the variance reduction factor, each costing a bit more
+				std::cout << '\r' << std::setw(12) << name << std::setw(14) << std::fixed << std::setprecision(4) << pricer.plain_call_price()
+					<< std::setw(14) << pricer.call_price() << std::setw(14) << std::setprecision(2) << pricer.call_variance_reduction()
+					<< std::setw(14) << times[1] / times[0] << std::setw(14) << pricer.call_variance_reduction() * times[0] / times[1] << '\n';
+			}
+		}
+	}
+
+	void control_variate_benchmark()
+	{
+		const std::size_t nSim = 100'000;
+		const std::size_t NT = 128;
+		auto od = benchmark_data();
+		const OptionData& data = *od;
+
+		std::cout << "Control variates on one thread, GBM / Euler / Philox, NSim = " << nSim << ", NT = " << NT << ", call prices\n\n";
+		std::cout << std::setw(12) << "option" << std::setw(14) << "plain" << std::setw(14) << "controlled" << std::setw(14) << "var. red."
+			<< std::setw(14) << "time ratio" << std::setw(14) << "speedup" << '\n';
+
+		ControlVariate terminal{ ControlVariate::Kind::Terminal, 0.0, ClosedForm::discounted_terminal(data), ClosedForm::discounted_terminal(data) };
+		ControlVariate vanilla{ ControlVariate::Kind::VanillaTerminal, data.K, ClosedForm::black_scholes_call(data), ClosedForm::black_scholes_put(data) };
+		ControlVariate geometric{ ControlVariate::Kind::GeometricAverage, data.K, ClosedForm::geometric_asian_call(data, NT),
+			ClosedForm::geometric_asian_put(data, NT) };
+
+		control_rows<EuropeanPricer>("European", od, nSim, NT, { terminal });
+		control_rows<AsianPricer>("Asian", od, nSim, NT, { geometric, terminal });
+		control_rows<BarrierPricer>("Barrier", od, nSim, NT, { vanilla, terminal }, [](BarrierPricer& pricer)
+			{ // Down-and-out at 80
+				pricer.set_barrier_type(BarrierPricer::BarrierType::Down_and_Out);
+				pricer.set_barrier_amount(80.0);
+			});
+		std::cout << '\n';
+	}
+
+	void adaptive_benchmark()
+	{
+		const std::size_t maxSim = 1'000'000;
+		const std::size_t NT = 64;
+		const double target = 0.05;
+		auto od = benchmark_data();
+		const OptionData& data = *od;
+
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng(1);
+
+		std::cout << "Adaptive runs, GBM / Euler / Philox / European, NT = " << NT << ", target standard error = " << target
+			<< ", cap = " << maxSim << "\n\n";
+		std::cout << std::setw(28) << "run" << std::setw(12) << "paths" << std::setw(14) << "time (s)" << std::setw(14) << "stderr"
+			<< std::setw(12) << "speedup" << '\n';
+
+		double base{};
+		auto row = [&](const char* name, bool adaptive, bool controlled)
+			{
+				EuropeanPricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+				pricer.set_display(false);
+				if (controlled)
+					pricer.add_control({ ControlVariate::Kind::Terminal, 0.0, ClosedForm::discounted_terminal(data), ClosedForm::discounted_terminal(data) });
+
+				MCEngine<GBM, EulerFDM<GBM>, Philox, EuropeanPricer> engine(sde, fdm, rng, pricer, maxSim);
+				engine.set_block_size(64);
+				if (adaptive)
+					engine.set_target_error(target, maxSim);
+
+				StopWatch sw;
+				sw.Start();
+				engine.start();
+				sw.Stop();
+				if (!adaptive)
+					base = sw.GetTime();
+
+				std::cout << '\r' << std::setw(28) << name << std::setw(12) << engine.get_simulation_count() << std::setw(14) << std::fixed
+					<< std::setprecision(4) << sw.GetTime() << std::setw(14) << std::scientific << std::setprecision(3)
+					<< std::max(pricer.call_standard_error(), pricer.put_standard_error()) << std::setw(12) << std::fixed << std::setprecision(1)
+					<< base / sw.GetTime() << '\n';
+			};
+
+		row("fixed", false, false);
+		row("adaptive", true, false);
+		row("adaptive + control variate", true, true);
+		std::cout << '\n';
+	}
+
+	void mlmc_benchmark()
+	{
+		const std::size_t coarseNT = 4;
+		auto od = benchmark_data();
+		SDEBase<GBM> sde(GBM{ od });
+		Philox rng(1);
+
+		std::cout << "Multilevel MC, GBM / Euler / Philox, NT_0 = " << coarseNT << ", M = 2, Black-Scholes call = "
+			<< std::fixed << std::setprecision(4) << ClosedForm::black_scholes_call(*od) << "\n\n";
+		std::cout << std::setw(10) << "option" << std::setw(10) << "eps" << std::setw(8) << "levels" << std::setw(12) << "call"
+			<< std::setw(14) << "MLMC steps" << std::setw(14) << "MC steps" << std::setw(10) << "ratio" << std::setw(12) << "time (s)"
+			<< "   paths per level\n";
+
+		auto rows = [&](const char* name, const PricerAbstract& pricer)
+			{
+				for (double eps : { 0.05, 0.02, 0.01 })
+				{
+					MLMCEngine<GBM> mlmc(sde, rng, pricer, coarseNT);
+					StopWatch sw;
+					sw.Start();
+					MLMCEngine<GBM>::Result result = mlmc.run(eps);
+					sw.Stop();
+
+					std::cout << std::setw(10) << name << std::setw(10) << std::setprecision(3) << eps << std::setw(8) << result.levels.size()
+						<< std::setw(12) << std::setprecision(4) << result.callPrice << std::setw(14) << std::scientific << std::setprecision(2)
+						<< result.cost << std::setw(14) << result.standardCost << std::setw(10) << std::fixed << std::setprecision(1)
+						<< result.standardCost / result.cost << std::setw(12) << std::setprecision(3) << sw.GetTime() << "  ";
+					for (const auto& level : result.levels)
+						std::cout << ' ' << level.nSamples;
+					std::cout << (result.converged ? "" : " (bias test failed)") << '\n';
+				}
+			};
+
+		auto discounter = [od]() { return std::exp(-od->r * od->T); };
+		rows("European", EuropeanPricer(od->K, discounter, 0));
+		rows("Asian", AsianPricer(od->K, discounter, 0));
+		std::cout << '\n';
+	}
+
+	// One run of a pricer on its own copy of the option data, Greeks computed in the same pass on request
+	template <typename Pricer>
+	std::pair<Pricer, double> greek_run(const OptionData& data, std::size_t nSim, std::size_t NT, bool greeks,
+		const std::function<void(Pricer&)>& setup)
+	{
+		auto od = std::make_shared<OptionData>(data);
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng(1); // Same draws in every run: the bumped prices use common random numbers
+
+		Pricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+		pricer.set_display(false);
+		setup(pricer);
+		if (greeks)
+			pricer.set_greeks({ od->S0, od->vol, od->r, od->q, od->T });
+
+		MCEngine<GBM, EulerFDM<GBM>, Philox, Pricer> engine(sde, fdm, rng, pricer, nSim);
+		engine.set_thread_count(1);
+		engine.set_block_size(64);
+
+		StopWatch sw;
+		sw.Start();
+		engine.start();
+		sw.Stop();
+
+		return { std::move(pricer), sw.GetTime() };
+	}
+
+	// Single-pass call Greeks against central bump-and-revalue differences (7 runs)
+	template <typename Pricer>
+	void greek_rows(const char* name, const OptionData& od, std::size_t nSim, std::size_t NT,
+		const std::function<void(Pricer&)>& setup, const double* closedForm = nullptr)
+	{
+		auto [pricer, time] = greek_run<Pricer>(od, nSim, NT, true, setup);
+
+		const double hS = 0.01 * od.S0, hVol = 0.01, hR = 0.001;
+		double bumpTime{};
+		auto price = [&](auto bump)
+			{
+				OptionData bumped = od;
+				bump(bumped);
+				auto [bumpedPricer, t] = greek_run<Pricer>(bumped, nSim, NT, false, setup);
+				bumpTime += t;
+				return bumpedPricer.call_price();
+			};
+		double base = price([](OptionData&) {});
+		double up = price([&](OptionData& b) { b.S0 += hS; });
+		double down = price([&](OptionData& b) { b.S0 -= hS; });
+		double volUp = price([&](OptionData& b) { b.vol += hVol; });
+		double volDown = price([&](OptionData& b) { b.vol -= hVol; });
+		double rUp = price([&](OptionData& b) { b.r += hR; });
+		double rDown = price([&](OptionData& b) { b.r -= hR; });
+		double bumps[NGreeks] = { (up - down) / (2.0 * hS), (up - 2.0 * base + down) / (hS * hS),
+			(volUp - volDown) / (2.0 * hVol), (rUp - rDown) / (2.0 * hR) };
+
+		const char* names[NGreeks] = { "delta", "gamma", "vega", "rho" };
+		for (std::size_t g = 0; g < NGreeks; ++g)
+		{
+			Greek greek = static_cast<Greek>(g);
+			std::cout << std::setw(10) << (g == 0 ? name : "") << std::setw(8) << names[g] << std::setw(14) << std::fixed << std::setprecision(5)
+				<< pricer.call_greek(greek) << std::setw(12) << std::setprecision(5) << pricer.call_greek_error(greek) << std::setw(14) << bumps[g];
+			if (closedForm)
+				std::cout << std::setw(14) << closedForm[g];
+			std::cout << '\n';
+		}
+		std::cout << std::setw(18) << "time (s)" << std::setw(14) << std::setprecision(3) << time << std::setw(12) << ""
+			<< std::setw(14) << bumpTime << '\n';
+	}
+
+	void greeks_benchmark()
+	{
+		const std::size_t nSim = 200'000;
+		const std::size_t NT = 50;
+		auto od = benchmark_data();
+
+		std::cout << "Single-pass Greeks of the call (pathwise / likelihood ratio) against bump-and-revalue, GBM / Euler / Philox, NSim = "
+			<< nSim << ", NT = " << NT << "\n\n";
+		std::cout << std::setw(10) << "option" << std::setw(8) << "greek" << std::setw(14) << "single pass" << std::setw(12) << "stderr"
+			<< std::setw(14) << "bumped" << std::setw(14) << "closed form" << '\n';
+
+		double blackScholes[NGreeks] = { ClosedForm::black_scholes_call_delta(*od), ClosedForm::black_scholes_call_gamma(*od),
+			ClosedForm::black_scholes_call_vega(*od), ClosedForm::black_scholes_call_rho(*od) };
+		greek_rows<EuropeanPricer>("European", *od, nSim, NT, [](EuropeanPricer&) {}, blackScholes);
+		greek_rows<AsianPricer>("Asian", *od, nSim, NT, [](AsianPricer&) {});
+		greek_rows<BarrierPricer>("Barrier", *od, nSim, NT, [](BarrierPricer& pricer)
+			{ // Down-and-out at 80
+				pricer.set_barrier_type(BarrierPricer::BarrierType::Down_and_Out);
+				pricer.set_barrier_amount(80.0);
+			});
+		std::cout << '\n';
+	}
+
+	// Discounted call price of a plain (double) run on its own copy of the option data, and its duration
+	template <typename SDE, typename Pricer>
+	std::pair<double, double> plain_call(const OptionData& data, std::size_t nSim, std::size_t NT)
+	{
+		auto od = std::make_shared<OptionData>(data);
+		SDEBase<SDE> sde(SDE{ od });
+		EulerFDM<SDE> fdm(sde, NT);
+		Philox rng(1); // Common random numbers across the bumped runs
+
+		Pricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+		pricer.set_display(false);
+		MCEngine<SDE, EulerFDM<SDE>, Philox, Pricer> engine(sde, fdm, rng, pricer, nSim);
+		engine.set_thread_count(1);
+		engine.set_block_size(64);
+
+		StopWatch sw;
+		sw.Start();
+		engine.start();
+		sw.Stop();
+
+		return { pricer.call_price(), sw.GetTime() };
+	}
+
+	// Adjoint sensitivities of the call w.r.t. every input against central bump-and-revalue differences
+	template <typename SDE, typename Pricer>
+	void aad_rows(const char* name, const std::shared_ptr<OptionData>& od, std::size_t nSim, std::size_t NT)
+	{
+		Philox rng(1);
+		Pricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+		AADEngine<SDE> aad(od, rng, pricer, NT);
+
+		StopWatch sw;
+		sw.Start();
+		typename AADEngine<SDE>::Result result = aad.run(nSim);
+		sw.Stop();
+		double aadTime = sw.GetTime();
+
+		auto [base, plainTime] = plain_call<SDE, Pricer>(*od, nSim, NT);
+		const char* names[AADEngine<SDE>::NInputs] = { "S0", "vol", "r", "q", "betaCEV" };
+		double OptionData::* fields[AADEngine<SDE>::NInputs] = { &OptionData::S0, &OptionData::vol, &OptionData::r, &OptionData::q, &OptionData::betaCEV };
+		const double bumps[AADEngine<SDE>::NInputs] = { 0.01 * od->S0, 0.01, 0.001, 0.001, 0.01 };
+
+		double bumpTime = plainTime;
+		for (std::size_t i = 0; i < AADEngine<SDE>::NInputs; ++i)
+		{
+			OptionData up = *od, down = *od;
+			up.*fields[i] += bumps[i];
+			down.*fields[i] -= bumps[i];
+			auto [upPrice, upTime] = plain_call<SDE, Pricer>(up, nSim, NT);
+			auto [downPrice, downTime] = plain_call<SDE, Pricer>(down, nSim, NT);
+			bumpTime += upTime + downTime;
+
+			std::cout << '\r' << std::setw(10) << (i == 0 ? name : "") << std::setw(10) << names[i] << std::setw(14) << std::fixed
+				<< std::setprecision(5) << result.callSensitivities[i] << std::setw(12) << result.callSensitivityErrors[i]
+				<< std::setw(14) << (upPrice - downPrice) / (2.0 * bumps[i]) << '\n';
+		}
+		std::cout << std::setw(20) << "time (s)" << std::setw(14) << std::setprecision(3) << aadTime << std::setw(12) << ""
+			<< std::setw(14) << bumpTime << "   (one plain run " << plainTime << " s, tape " << result.tapeNodes << " nodes)\n";
+	}
+
+	void aad_benchmark()
+	{
+		const std::size_t nSim = 100'000;
+		const std::size_t NT = 50;
+		auto od = benchmark_data();
+		od->betaCEV = 0.8;
+		od->vol = 0.3 * std::pow(od->S0, 1.0 - od->betaCEV); // Same local volatility as GBM at S0
+
+		std::cout << "Adjoint (AAD) sensitivities of the call against bump-and-revalue (11 runs), CEV beta = " << od->betaCEV
+			<< " / Euler / Philox, NSim = " << nSim << ", NT = " << NT << "\n\n";
+		std::cout << std::setw(10) << "option" << std::setw(10) << "input" << std::setw(14) << "adjoint" << std::setw(12) << "stderr"
+			<< std::setw(14) << "bumped" << '\n';
+
+		aad_rows<CEV, EuropeanPricer>("European", od, nSim, NT);
+		aad_rows<CEV, AsianPricer>("Asian", od, nSim, NT);
+		std::cout << '\n';
+	}
+
+	// 200 contracts on one underlying: one portfolio run against one run per contract (same draws)
+	void portfolio_benchmark()
+	{
+		const std::size_t nSim = 20'000;
+		const std::size_t NT = 50;
+		auto od = benchmark_data();
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng(1);
+		auto discounter = [od]() { return std::exp(-od->r * od->T); };
+
+		auto make_contracts = [&]()
+			{ // 40 strikes x (European, Asian, three barriers)
+				std::vector<std::shared_ptr<PricerAbstract>> contracts;
+				for (std::size_t k = 0; k < 40; ++k)
+				{
+					double strike = 80.0 + k;
+					contracts.push_back(std::make_shared<EuropeanPricer>(strike, discounter, 0));
+					contracts.push_back(std::make_shared<AsianPricer>(strike, discounter, 0));
+					for (auto [type, level] : { std::pair{ BarrierPricer::BarrierType::Down_and_Out, 80.0 },
+						std::pair{ BarrierPricer::BarrierType::Up_and_Out, 130.0 }, std::pair{ BarrierPricer::BarrierType::Down_and_In, 90.0 } })
+					{
+						auto barrier = std::make_shared<BarrierPricer>(strike, discounter, 0);
+						barrier->set_barrier_type(type);
+						barrier->set_barrier_amount(level);
+						contracts.push_back(barrier);
+					}
+				}
+				return contracts;
+			};
+
+		auto configure = [](auto& engine)
+			{
+				engine.set_thread_count(1);
+				engine.set_block_size(64);
+			};
+
+		PortfolioPricer portfolio(discounter, 0);
+		portfolio.set_display(false);
+		for (const auto& contract : make_contracts())
+			portfolio.add_contract(contract, "");
+
+		StopWatch sw;
+		sw.Start();
+		MCEngine<GBM, EulerFDM<GBM>, Philox, PortfolioPricer> engine(sde, fdm, rng, portfolio, nSim);
+		configure(engine);
+		engine.start();
+		sw.Stop();
+		double portfolioTime = sw.GetTime();
+
+		// One simulation per contract, through the dispatch layer as the pricer types differ
+		double maxDifference{};
+		std::vector<std::shared_ptr<PricerAbstract>> contracts = make_contracts();
+		sw.Reset(); // The stopwatch accumulates over the runs
+		for (std::size_t i = 0; i < contracts.size(); ++i)
+		{
+			contracts[i]->set_display(false);
+			sw.Start();
+			run_dispatched(sde, fdm, rng, *contracts[i], nSim, configure);
+			sw.Stop();
+			maxDifference = std::max(maxDifference, std::abs(contracts[i]->call_price() - portfolio.contract(i).call_price()));
+		}
+
+		double separateTime = sw.GetTime();
+
+		std::cout << "Portfolio of " << contracts.size() << " contracts (European, Asian, barriers), GBM / Euler / Philox, NSim = " << nSim
+			<< ", NT = " << NT << "\n\n";
+		std::cout << std::setw(20) << "portfolio run (s)" << std::setw(20) << "separate runs (s)" << std::setw(12) << "speedup"
+			<< std::setw(22) << "max price difference" << '\n';
+		std::cout << std::setw(20) << std::fixed << std::setprecision(3) << portfolioTime << std::setw(20) << separateTime << std::setw(12)
+			<< std::setprecision(1) << separateTime / portfolioTime << std::setw(22) << std::scientific << std::setprecision(2) << maxDifference << "\n\n";
+	}
+
+	void strike_grid_benchmark()
+	{
+		const std::size_t nSim = 100'000;
+		const std::size_t NT = 50;
+		auto od = benchmark_data();
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng(1);
+		auto discounter = [od]() { return std::exp(-od->r * od->T); };
+
+		std::vector<double> ladder(100);
+		for (std::size_t k = 0; k < ladder.size(); ++k)
+			ladder[k] = 60.0 + 0.8 * k;
+
+		std::cout << "Strike grid, GBM / Euler / Philox, NSim = " << nSim << ", NT = " << NT << ", 1 thread\n\n";
+		std::cout << std::setw(12) << "underlying" << std::setw(10) << "antith." << std::setw(16) << "1 strike (s)" << std::setw(18) << "100 strikes (s)"
+			<< std::setw(20) << "100 pricers (s)" << std::setw(24) << "max price difference" << std::setw(24) << "max error difference" << '\n';
+
+		for (auto underlying : { StrikeGridPricer::Underlying::Terminal, StrikeGridPricer::Underlying::Average })
+		{
+			for (bool antithetic : { false, true })
+			{
+				auto configure = [antithetic](auto& engine)
+					{
+						engine.set_thread_count(1);
+						engine.set_block_size(64);
+						engine.set_antithetic(antithetic);
+					};
+				auto run_grid = [&](const std::vector<double>& strikes, StrikeGridPricer& grid)
+					{
+						grid.set_display(false);
+						StopWatch sw;
+						sw.Start();
+						MCEngine<GBM, EulerFDM<GBM>, Philox, StrikeGridPricer> engine(sde, fdm, rng, grid, nSim);
+						configure(engine);
+						engine.start();
+						sw.Stop();
+						return sw.GetTime();
+					};
+
+				StrikeGridPricer single({ 100.0 }, underlying, discounter, 0);
+				double singleTime = run_grid({ 100.0 }, single);
+				StrikeGridPricer grid(ladder, underlying, discounter, 0);
+				double gridTime = run_grid(ladder, grid);
+
+				// The same ladder as one pricer per strike, sharing the paths through a portfolio
+				PortfolioPricer portfolio(discounter, 0);
+				portfolio.set_display(false);
+				for (double strike : ladder)
+				{
+					if (underlying == StrikeGridPricer::Underlying::Terminal)
+						portfolio.add_contract(std::make_shared<EuropeanPricer>(strike, discounter, 0), "");
+					else
+						portfolio.add_contract(std::make_shared<AsianPricer>(strike, discounter, 0), "");
+				}
+				StopWatch sw;
+				sw.Start();
+				MCEngine<GBM, EulerFDM<GBM>, Philox, PortfolioPricer> engine(sde, fdm, rng, portfolio, nSim);
+				configure(engine);
+				engine.start();
+				sw.Stop();
+
+				double priceDifference{}, errorDifference{};
+				for (std::size_t k = 0; k < ladder.size(); ++k)
+				{
+					const PricerAbstract& contract = portfolio.contract(k);
+					priceDifference = std::max({ priceDifference, std::abs(grid.call_prices()[k] - contract.call_price()), std::abs(grid.put_prices()[k] - contract.put_price()) });
+					errorDifference = std::max({ errorDifference, std::abs(grid.call_errors()[k] - contract.call_standard_error()),
+						std::abs(grid.put_errors()[k] - contract.put_standard_error()) });
+				}
+
+				std::cout << std::setw(12) << (underlying == StrikeGridPricer::Underlying::Terminal ? "terminal" : "average") << std::setw(10) << (antithetic ? "yes" : "no")
+					<< std::setw(16) << std::fixed << std::setprecision(3) << singleTime << std::setw(18) << gridTime << std::setw(20) << sw.GetTime()
+					<< std::setw(24) << std::scientific << std::setprecision(2) << priceDifference << std::setw(24) << errorDifference << '\n';
+			}
+		}
+		std::cout << '\n';
+	}
+
+	void batch_benchmark()
+	{
+		// Overnight-like mix: many short European / Asian jobs and a few long barrier jobs
+		std::vector<BatchJob> jobs;
+		for (std::size_t i = 0; i < 48; ++i)
+		{
+			BatchJob job;
+			job.id = std::to_string(i);
+			job.data.S0 = 100.0; job.data.K = 80.0 + i; job.data.T = 1.0; job.data.r = 0.05; job.data.vol = 0.2; job.data.betaCEV = 1.0;
+			job.pricer = i % 2 == 0 ? "european" : "asian";
+			job.NT = 50;
+			job.paths = 20'000;
+			job.seed = i;
+			if (i % 12 == 0)
+			{ // Long jobs
+				job.pricer = "barrier";
+				job.barrier = 80.0;
+				job.NT = 250;
+				job.paths = 100'000;
+			}
+			jobs.push_back(job);
+		}
+
+		StopWatch sw;
+		sw.Start();
+		for (const BatchJob& job : jobs)
+			BatchRunner::run_job(job);
+		sw.Stop();
+		double sequential = sw.GetTime();
+
+		BatchRunner runner;
+		runner.run(jobs);
+
+		std::cout << "Batch of " << jobs.size() << " jobs (European, Asian, barriers), GBM / Euler / Philox\n\n";
+		std::cout << std::setw(14) << "threads" << std::setw(22) << "sequential (jobs/h)" << std::setw(22) << "thread pool (jobs/h)" << std::setw(12) << "speedup" << '\n';
+		std::cout << std::setw(14) << runner.thread_count() << std::setw(22) << std::fixed << std::setprecision(0) << 3600.0 * jobs.size() / sequential
+			<< std::setw(22) << 3600.0 * jobs.size() / runner.duration() << std::setw(12) << std::setprecision(2) << sequential / runner.duration() << "\n\n";
+	}
+
+	void path_store_benchmark()
+	{
+		const std::size_t nSim = 100'000;
+		const std::size_t NT = 50;
+		const std::size_t blockSize = 64;
+		const std::string file = "paths.mcp";
+		auto od = benchmark_data();
+		auto discounter = [od]() { return std::exp(-od->r * od->T); };
+
+		SDEBase<GBM> sde(GBM{ od });
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng(1);
+
+		std::cout << "Path store: GBM / Euler / Philox, NSim = " << nSim << ", NT = " << NT << ", block = " << blockSize
+			<< ", replay against a new simulation\n\n";
+		std::cout << std::setw(12) << "layout" << std::setw(14) << "file (MB)" << std::setw(16) << "record (s)" << std::setw(16) << "simulate (s)"
+			<< std::setw(14) << "replay (s)" << std::setw(14) << "GB/s" << std::setw(14) << "speedup" << std::setw(16) << "same prices" << '\n';
+
+		for (bool statistics : { false, true })
+		{
+			PathFileInfo info{ *od, "GBM", "Euler", "Philox", 1, NT, nSim, 1024, blockSize, false, statistics };
+			auto european = std::make_shared<EuropeanPricer>(od->K, discounter, 0);
+			PathRecorder recorder(file, info, european);
+			recorder.set_display(false);
+
+			MCEngine<GBM, EulerFDM<GBM>, Philox, PathRecorder> engine(sde, fdm, rng, recorder, nSim);
+			engine.set_block_size(blockSize);
+			engine.set_chunk_size(info.chunkSize);
+			engine.set_progress(false);
+			StopWatch record;
+			record.Start();
+			engine.start();
+			record.Stop();
+
+			// New payoff on the same scenarios: simulated again, then replayed
+			AsianPricer simulated(od->K, discounter, 0);
+			simulated.set_display(false);
+			MCEngine<GBM, EulerFDM<GBM>, Philox, AsianPricer> asianEngine(sde, fdm, rng, simulated, nSim);
+			asianEngine.set_block_size(blockSize);
+			asianEngine.set_progress(false);
+			StopWatch simulate;
+			simulate.Start();
+			asianEngine.start();
+			simulate.Stop();
+
+			PathReplay replay(file);
+			EuropeanPricer replayedEuropean(od->K, discounter, 0);
+			replayedEuropean.set_display(false);
+			replay.run(replayedEuropean);
+			AsianPricer replayed(od->K, discounter, 0);
+			replayed.set_display(false);
+			StopWatch sw;
+			sw.Start();
+			replay.run(replayed);
+			sw.Stop();
+
+			double bytes = static_cast<double>(nSim) * info.rows() * sizeof(double);
+			bool same = replayedEuropean.call_price() == european->call_price() && replayed.call_price() == simulated.call_price();
+			std::cout << std::setw(12) << (statistics ? "statistics" : "paths") << std::setw(14) << std::fixed << std::setprecision(1) << bytes / 1e6
+				<< std::setw(16) << std::setprecision(3) << record.GetTime() << std::setw(16) << simulate.GetTime() << std::setw(14) << sw.GetTime()
+				<< std::setw(14) << std::setprecision(2) << bytes / sw.GetTime() / 1e9 << std::setw(14) << simulate.GetTime() / sw.GetTime()
+				<< std::setw(16) << std::boolalpha << same << '\n';
+		}
+		std::remove(file.c_str());
+		std::cout << '\n';
+	}
+
+	void pipeline_benchmark()
+	{
+		const std::size_t nSim = 100'000;
+		const std::size_t NT = 250;
+		const std::size_t blockSize = 64;
+		const std::size_t maxThreads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+		auto od = benchmark_data();
+		od->betaCEV = 0.8;
+		od->vol = 0.3 * std::pow(od->S0, 1.0 - od->betaCEV);
+
+		SDEBase<CEV> sde(CEV{ od });
+		EulerFDM<CEV> fdm(sde, NT);
+		Philox rng(1);
+
+		std::cout << "RNG pipeline: CEV / Euler / Philox / Asian, NSim = " << nSim << ", NT = " << NT << ", block = " << blockSize
+			<< ", inline draws against generator threads\n\n";
+		std::cout << std::setw(12) << "steppers" << std::setw(12) << "generators" << std::setw(16) << "paths/sec" << std::setw(12) << "speedup"
+			<< std::setw(12) << "tiles" << std::setw(12) << "starved" << std::setw(12) << "stalled" << std::setw(14) << "same price" << '\n';
+
+		double base{};
+		double basePrice{};
+		auto row = [&](std::size_t nSteppers, std::size_t nGenerators)
+			{
+				AsianPricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+				pricer.set_display(false);
+				MCEngine<CEV, EulerFDM<CEV>, Philox, AsianPricer> engine(sde, fdm, rng, pricer, nSim);
+				engine.set_block_size(blockSize);
+				engine.set_thread_count(nSteppers);
+				engine.set_pipeline(nGenerators);
+				engine.set_progress(false);
+
+				StopWatch sw;
+				sw.Start();
+				engine.start();
+				sw.Stop();
+
+				double rate = nSim / sw.GetTime();
+				if (nGenerators == 0)
+				{
+					base = rate;
+					basePrice = pricer.call_price();
+				}
+				const PipelineStats& stats = engine.get_pipeline_stats();
+				std::cout << std::setw(12) << nSteppers << std::setw(12) << nGenerators << std::setw(16) << std::fixed << std::setprecision(0) << rate
+					<< std::setw(12) << std::setprecision(2) << rate / base << std::setw(12) << stats.tiles << std::setw(12) << stats.starved
+					<< std::setw(12) << stats.stalled << std::setw(14) << std::boolalpha << (pricer.call_price() == basePrice) << '\n';
+			};
+
+		row(maxThreads, 0);
+		// Same number of threads split between generators and steppers, then generators on top of the steppers
+		for (std::size_t nGenerators = 1; nGenerators <= std::max<std::size_t>(1, maxThreads / 2); nGenerators *= 2)
+			row(std::max<std::size_t>(1, maxThreads - nGenerators), nGenerators);
+		row(maxThreads, std::max<std::size_t>(1, maxThreads / 2));
+		std::cout << '\n';
+	}
+
+	double paths_per_second(std::size_t nThreads, std::size_t nSim, std::size_t NT, std::size_t chunkSize)
+	{
+		auto od = benchmark_data();
+		SDEBase<GBM> sde(GBM{ od });
+		MCMediator<GBM>::PartsTuple parts = std::make_tuple(sde, std::make_unique<EulerFDM<GBM>>(sde, NT), std::make_unique<MersenneTwister>());
+
+		auto prepare = [](std::size_t) {};
+		auto path = [](const std::vector<double>& p, std::size_t)
+			{ // Cheap sink: keeps the compiler from optimising the simulation away
+				thread_local double sink{};
+				sink += p.back();
+			};
+		double duration{};
+		auto finish = [&duration](double d) { duration = d; };
+
+		MCMediator<GBM> mediator(parts, prepare, path, finish, nSim);
+		mediator.set_thread_count(nThreads);
+		mediator.set_chunk_size(chunkSize);
+		mediator.start();
+
+		return static_cast<double>(nSim) / duration;
+	}
+}
+
+int main()
+{
+	rng_benchmark();
+	qmc_benchmark();
+	stepping_benchmark();
+	scheme_convergence_benchmark();
+	exact_stepping_benchmark();
+	bool accurate = math_benchmark();
+	dispatch_benchmark();
+	streaming_benchmark();
+	antithetic_benchmark();
+	control_variate_benchmark();
+	adaptive_benchmark();
+	mlmc_benchmark();
+	greeks_benchmark();
+	aad_benchmark();
+	portfolio_benchmark();
+	strike_grid_benchmark();
+	batch_benchmark();
+	path_store_benchmark();
+	pipeline_benchmark();
+
+	const std::size_t nSim = 200'000;
+	const std::size_t NT = 250;
+	const std::size_t chunkSize = 1024;
+	const std::size_t maxThreads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+
+	std::cout << "Engine scaling: GBM / Euler / MersenneTwister, NSim = " << nSim << ", NT = " << NT 
+		<< ", chunk = " << chunkSize << "\n\n";
+	std::cout << std::setw(10) << "threads" << std::setw(16) << "paths/sec" << std::setw(12) << "speedup" << '\n';
+
+	double base{};
+	for (std::size_t nThreads = 1; nThreads <= maxThreads; nThreads = (nThreads == maxThreads ? maxThreads + 1 : std::min(2 * nThreads, maxThreads)))
+	{
+		double rate = paths_per_second(nThreads, nSim, NT, chunkSize);
+		if (nThreads == 1)
+			base = rate;
+
+		std::cout << '\r' << std::setw(10) << nThreads << std::setw(16) << std::fixed << std::setprecision(0) << rate
+			<< std::setw(12) << std::setprecision(2) << rate / base << '\n';
+	}
+
+	return accurate ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+// MicroBenchmark.cpp
+//
+// Microbenchmark suite used to track regressions across releases.
+// Measures the normals/sec of the random number generators (one draw at a time and batched), the
+// steps/sec of EulerFDM / ExactFDM::advance under GBM and CEV, the paths/sec of process_path for each
+// pricer and the end-to-end paths/sec of the statically dispatched engine against the number of threads.
+// Every measurement is repeated and the median rate is kept. The results are written as JSON
+// (to the file given as first argument, or to the standard output), a table goes to the error stream.
+//
+// Pierre-Yves Sojic
+//
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "FDMDerived.hpp"
+#include "MCEngine.hpp"
+#include "PricerDerived.hpp"
+#include "RNGDerived.hpp"
+#include "SDEConcrete.hpp"
+#include "StopWatch.hpp"
+
+namespace
+{
+	constexpr double MinTime = 0.05;        // Minimum duration of a repetition (seconds)
+	constexpr std::size_t Repetitions = 5;  // Repetitions of every measurement, the median rate is kept
+
+	volatile double g_sink;                 // Keeps the compiler from optimising the measured work away
+
+	struct Result
+	{
+		std::string group;
+		std::string name;
+		std::string unit;
+		double rate;                        // Items per second (median over the repetitions)
+		double spread;                      // (max - min) / median of the rates
+		std::size_t items;                  // Items per repetition
+		std::size_t threads;
+	};
+
+	std::vector<Result> g_results;
+
+	// Calls f (which processes itemsPerCall items) until a repetition lasts MinTime, then repeats the measurement
+	template <typename F>
+	void measure(const std::string& group, const std::string& name, const std::string& unit, std::size_t itemsPerCall, F&& f, std::size_t threads = 1)
+	{
+		f(); // Warm-up
+
+		std::size_t calls = 1;
+		while (true)
+		{
+			StopWatch sw;
+			sw.Start();
+			for (std::size_t c = 0; c < calls; ++c)
+				f();
+			sw.Stop();
+			if (sw.GetTime() >= MinTime)
+				break;
+			calls *= 2;
+		}
+
+		std::vector<double> rates;
+		for (std::size_t rep = 0; rep < Repetitions; ++rep)
+		{
+			StopWatch sw;
+			sw.Start();
+			for (std::size_t c = 0; c < calls; ++c)
+				f();
+			sw.Stop();
+			rates.push_back(static_cast<double>(calls * itemsPerCall) / sw.GetTime());
+		}
+		std::sort(rates.begin(), rates.end());
+		double median = rates[rates.size() / 2];
+
+		g_results.push_back({ group, name, unit, median, (rates.back() - rates.front()) / median, calls * itemsPerCall, threads });
+		std::cerr << std::setw(10) << group << std::setw(40) << name << std::setw(18) << std::fixed << std::setprecision(0) << median
+			<< ' ' << std::setw(10) << std::left << unit << std::right << std::setw(10) << std::setprecision(1) << 100.0 * g_results.back().spread << "%\n";
+	}
+
+	std::shared_ptr<OptionData> benchmark_data()
+	{
+		std::shared_ptr<OptionData> od = std::make_shared<OptionData>();
+		od->S0 = 100;
+		od->K = 100;
+		od->T = 1.0;
+		od->vol = 0.3;
+		od->r = 0.08;
+		od->q = 0.0;
+		od->betaCEV = 0.8;
+
+		return od;
+	}
+
+	void rng_suite()
+	{
+		const std::size_t blockSize = 256;
+		std::vector<double> block(blockSize);
+
+		auto suite = [&](const std::string& name, const RNGAbstract& rng)
+			{
+				measure("rng", name + "::generate_rn", "normals/s", blockSize, [&]()
+					{
+						double sum{};
+						for (std::size_t i = 0; i < blockSize; ++i)
+							sum += rng.generate_rn();
+						g_sink = sum;
+					});
+				measure("rng", name + "::fill", "normals/s", blockSize, [&]()
+					{
+						rng.fill(block);
+						g_sink = block.back();
+					});
+			};
+
+		suite("MersenneTwister", MersenneTwister{});
+		suite("PolarMarsagliaNet", PolarMarsagliaNet{});
+		suite("BoxMuller", BoxMuller{});
+		suite("Philox", Philox{ 1 });
+	}
+
+	template <typename SDE>
+	void fdm_suite(const std::string& model)
+	{
+		const std::size_t NT = 64;
+		const std::size_t nPaths = 64;
+		auto od = benchmark_data();
+		SDEBase<SDE> sde{ SDE(od) };
+
+		std::vector<double> normals(NT * nPaths);
+		Philox{ 1 }.fill(normals);
+
+		auto suite = [&](const std::string& name, const auto& fdm)
+			{
+				std::vector<double> mesh = fdm.get_mesh();
+				double dt = fdm.get_meshSize();
+				measure("fdm", name + "<" + model + ">::advance", "steps/s", NT * nPaths, [&]()
+					{
+						double sum{};
+						for (std::size_t p = 0; p < nPaths; ++p)
+						{
+							double x = od->S0;
+							for (std::size_t j = 0; j < NT; ++j)
+								x = fdm.advance(x, mesh[j], dt, normals[p * NT + j], 0.0);
+							sum += x;
+						}
+						g_sink = sum;
+					});
+			};
+
+		suite("EulerFDM", EulerFDM<SDE>(sde, NT));
+		suite("ExactFDM", ExactFDM<SDE>(sde, NT, od->vol, od->r, od->q));
+	}
+
+	void pricer_suite()
+	{
+		const std::size_t NT = 64;
+		const std::size_t nPaths = 1024;
+		auto od = benchmark_data();
+		SDEBase<GBM> sde{ GBM(od) };
+		EulerFDM<GBM> fdm(sde, NT);
+		auto discounter = [od]() { return std::exp(-od->r * od->T); };
+
+		// Stored Euler paths, handed to the pricers one at a time
+		std::vector<std::vector<double>> paths(nPaths, std::vector<double>(NT + 1, od->S0));
+		std::vector<double> normals(NT);
+		std::vector<double> mesh = fdm.get_mesh();
+		Philox rng{ 1 };
+		for (auto& path : paths)
+		{
+			rng.fill(normals);
+			for (std::size_t j = 1; j <= NT; ++j)
+				path[j] = fdm.advance(path[j - 1], mesh[j - 1], fdm.get_meshSize(), normals[j - 1], 0.0);
+		}
+
+		auto suite = [&](const std::string& name, PricerAbstract& pricer)
+			{
+				pricer.set_display(false);
+				pricer.prepare(1);
+				measure("pricer", name + "::process_path", "paths/s", nPaths, [&]()
+					{
+						for (const auto& path : paths)
+							pricer.process_path(path, 0);
+					});
+			};
+
+		EuropeanPricer european(od->K, discounter, 0);
+		suite("EuropeanPricer", european);
+		AsianPricer asian(od->K, discounter, 0);
+		suite("AsianPricer", asian);
+		BarrierPricer barrier(od->K, discounter, 0);
+		barrier.set_barrier_type(BarrierPricer::BarrierType::Down_and_Out);
+		barrier.set_barrier_amount(80.0);
+		suite("BarrierPricer", barrier);
+
+		PortfolioPricer portfolio(discounter, 0);
+		portfolio.add_contract(std::make_shared<EuropeanPricer>(od->K, discounter, 0), "European");
+		portfolio.add_contract(std::make_shared<AsianPricer>(od->K, discounter, 0), "Asian");
+		suite("PortfolioPricer(2)", portfolio);
+
+		std::vector<double> strikes(100);
+		for (std::size_t k = 0; k < strikes.size(); ++k)
+			strikes[k] = 60.0 + 0.8 * k;
+		StrikeGridPricer grid(strikes, StrikeGridPricer::Underlying::Terminal, discounter, 0);
+		suite("StrikeGridPricer(100)", grid);
+	}
+
+	void engine_suite()
+	{
+		const std::size_t nSim = 65'536;
+		const std::size_t NT = 64;
+		const std::size_t maxThreads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+		auto od = benchmark_data();
+		SDEBase<GBM> sde{ GBM(od) };
+		EulerFDM<GBM> fdm(sde, NT);
+		Philox rng{ 1 };
+		EuropeanPricer pricer(od->K, [od]() { return std::exp(-od->r * od->T); }, 0);
+		pricer.set_display(false);
+
+		for (std::size_t nThreads = 1; nThreads <= maxThreads; nThreads = (nThreads == maxThreads ? maxThreads + 1 : std::min(2 * nThreads, maxThreads)))
+		{
+			measure("engine", "MCEngine<GBM, Euler, Philox, European>", "paths/s", nSim, [&]()
+				{
+					MCEngine<GBM, EulerFDM<GBM>, Philox, EuropeanPricer> engine(sde, fdm, rng, pricer, nSim);
+					engine.set_thread_count(nThreads);
+					engine.set_block_size(64);
+					engine.set_progress(false);
+					engine.start();
+					g_sink = pricer.call_price();
+				}, nThreads);
+		}
+	}
+
+	std::string escape(const std::string& s)
+	{
+		std::string escaped;
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	void write_json(std::ostream& out)
+	{
+		out << "{\n";
+		out << "  \"suite\": \"MonteCarloMicroBench\",\n";
+#ifdef __VERSION__
+		out << "  \"compiler\": \"" << escape(__VERSION__) << "\",\n";
+#endif
+		out << "  \"hardware_threads\": " << std::max<unsigned>(1, std::thread::hardware_concurrency()) << ",\n";
+		out << "  \"repetitions\": " << Repetitions << ",\n";
+		out << "  \"results\": [\n";
+		for (std::size_t i = 0; i < g_results.size(); ++i)
+		{
+			const Result& result = g_results[i];
+			out << "    {\"group\": \"" << escape(result.group) << "\", \"name\": \"" << escape(result.name) << "\", \"unit\": \"" << escape(result.unit)
+				<< "\", \"threads\": " << result.threads << ", \"value\": " << std::setprecision(6) << std::scientific << result.rate
+				<< ", \"spread\": " << std::fixed << std::setprecision(4) << result.spread << ", \"items\": " << result.items << "}"
+				<< (i + 1 < g_results.size() ? ",\n" : "\n");
+		}
+		out << "  ]\n";
+		out << "}\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::cerr << std::setw(10) << "group" << std::setw(40) << "benchmark" << std::setw(18) << "rate" << std::setw(21) << "spread\n";
+
+	rng_suite();
+	fdm_suite<GBM>("GBM");
+	fdm_suite<CEV>("CEV");
+	pricer_suite();
+	engine_suite();
+
+	if (argc > 1)
+	{
+		std::ofstream out(argv[1]);
+		if (!out)
+		{
+			std::cerr << "ERROR: cannot open " << argv[1] << std::endl;
+			return 1;
+		}
+		write_json(out);
+	}
+	else
+	{
+		write_json(std::cout);
+	}
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+// AAD.hpp
+//
+// Reverse-mode algorithmic differentiation. aad::Real records every operation on the tape of its thread:
+// an arena of nodes, one per operation with the partial derivatives w.r.t. its (at most two) arguments,
+// that is rewound rather than freed between paths so that its memory stays bounded by the longest path.
+// One backward sweep from a result gives its derivatives w.r.t. every input recorded on the tape.
+// Values that do not depend on an input (doubles, constants) are never recorded.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aad
+{
+	class Tape
+	{
+	public:
+		static constexpr std::uint32_t NoNode = UINT32_MAX; // Index of the values not on the tape
+
+	public:
+		static Tape& local(); // Tape of the calling thread
+
+		// Adds a node of arguments a and b (NoNode if absent) and returns its index
+		std::uint32_t record(std::uint32_t a, double da, std::uint32_t b, double db)
+		{
+			m_nodes.push_back({ { a, b }, { da, db } });
+			return static_cast<std::uint32_t>(m_nodes.size() - 1);
+		}
+
+		void rewind(std::size_t mark = 0) { m_nodes.resize(mark); } // Drops the nodes after mark, keeps the memory
+		std::size_t size() const { return m_nodes.size(); }
+		std::size_t capacity() const { return m_nodes.capacity(); }
+
+		void propagate(std::uint32_t result);	// Adjoints of every node w.r.t. the result (backward sweep)
+		double adjoint(std::uint32_t index) const { return index < m_adjoints.size() ? m_adjoints[index] : 0.0; }
+
+	private:
+		struct Node
+		{
+			std::uint32_t arg[2];
+			double partial[2];
+		};
+
+		std::vector<Node> m_nodes;
+		std::vector<double> m_adjoints;
+	};
+
+	class Real
+	{
+	public:
+		Real(double value = 0.0) : m_value{ value }, m_index{ Tape::NoNode } {} // Constant
+		static Real input(double value) { return { value, Tape::local().record(Tape::NoNode, 0.0, Tape::NoNode, 0.0) }; }
+
+		double value() const { return m_value; }
+		std::uint32_t index() const { return m_index; }
+		bool recorded() const { return m_index != Tape::NoNode; }
+		double adjoint() const { return Tape::local().adjoint(m_index); } // After Tape::propagate
+
+		Real& operator+=(const Real& b) { return *this = *this + b; }
+		Real& operator-=(const Real& b) { return *this = *this - b; }
+		Real& operator*=(const Real& b) { return *this = *this * b; }
+		Real& operator/=(const Real& b) { return *this = *this / b; }
+
+		friend Real operator+(const Real& a, const Real& b) { return node(a.m_value + b.m_value, a, 1.0, b, 1.0); }
+		friend Real operator-(const Real& a, const Real& b) { return node(a.m_value - b.m_value, a, 1.0, b, -1.0); }
+		friend Real operator*(const Real& a, const Real& b) { return node(a.m_value * b.m_value, a, b.m_value, b, a.m_value); }
+		friend Real operator/(const Real& a, const Real& b)
+		{
+			double inv = 1.0 / b.m_value;
+			return node(a.m_value * inv, a, inv, b, -a.m_value * inv * inv);
+		}
+		friend Real operator-(const Real& a) { return node(-a.m_value, a, -1.0); }
+
+		friend Real exp(const Real& a)
+		{
+			double v = std::exp(a.m_value);
+			return node(v, a, v);
+		}
+		friend Real log(const Real& a) { return node(std::log(a.m_value), a, 1.0 / a.m_value); }
+		friend Real sqrt(const Real& a)
+		{
+			double v = std::sqrt(a.m_value);
+			return node(v, a, 0.5 / v);
+		}
+		friend Real pow(const Real& a, const Real& b)
+		{ // The log of the base is only needed (and defined) when the exponent is recorded
+			double v = std::pow(a.m_value, b.m_value);
+			double da = b.m_value * std::pow(a.m_value, b.m_value - 1.0);
+			return node(v, a, da, b, b.recorded() ? v * std::log(a.m_value) : 0.0);
+		}
+		friend Real max(const Real& a, const Real& b) { return a.m_value >= b.m_value ? a : b; }
+		friend Real min(const Real& a, const Real& b) { return a.m_value <= b.m_value ? a : b; }
+
+		friend bool operator<(const Real& a, const Real& b) { return a.m_value < b.m_value; }
+		friend bool operator>(const Real& a, const Real& b) { return a.m_value > b.m_value; }
+		friend bool operator<=(const Real& a, const Real& b) { return a.m_value <= b.m_value; }
+		friend bool operator>=(const Real& a, const Real& b) { return a.m_value >= b.m_value; }
+
+	private:
+		Real(double value, std::uint32_t index) : m_value{ value }, m_index{ index } {}
+
+		static Real node(double value, const Real& a, double da)
+		{
+			if (!a.recorded())
+				return value;
+			return { value, Tape::local().record(a.m_index, da, Tape::NoNode, 0.0) };
+		}
+
+		static Real node(double value, const Real& a, double da, const Real& b, double db)
+		{
+			if (!a.recorded())
+				return node(value, b, db);
+			if (!b.recorded())
+				return node(value, a, da);
+			return { value, Tape::local().record(a.m_index, da, b.m_index, db) };
+		}
+
+	private:
+		double m_value;
+		std::uint32_t m_index;	// Node of the value on the tape of its thread
+	};
+}
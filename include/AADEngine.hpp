@@ -0,0 +1,222 @@
+// AADEngine.hpp
+//
+// Monte Carlo driver for the adjoint (AAD) sensitivities of the prices w.r.t. every model input
+// (S0, vol, r, q, betaCEV) at once. Each path is simulated on aad::Real through the chain
+// SDEBase drift/diffusion -> EulerFDM::advance -> PricerAbstract::adjoint_payoffs -> discounting,
+// then two backward sweeps (call, put) give the pathwise derivatives of both discounted payoffs.
+// The tape of each worker thread is rewound after every path: its memory is that of a single path.
+// Pathwise derivatives need Lipschitz payoffs: barrier indicators are not differentiated this way
+// (see the likelihood ratio Greeks of the pricers).
+// Paths are split into chunks with their own moments, merged in chunk order as in MLMCEngine.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "AAD.hpp"
+#include "ControlVariate.hpp"
+#include "FDMDerived.hpp"
+#include "OptionData.hpp"
+#include "PricerAbstract.hpp"
+#include "RNGAbstract.hpp"
+#include "SDEBase.hpp"
+
+template <typename SDE>
+class AADEngine
+{
+public:
+    enum class Input
+    {
+        S0,
+        Vol,
+        R,
+        Q,
+        BetaCEV
+    };
+    static constexpr std::size_t NInputs = 5;
+
+    struct Result
+    {
+        double callPrice;
+        double putPrice;
+        double callError;                                   // Standard errors of the prices
+        double putError;
+        std::array<double, NInputs> callSensitivities;      // d price / d input, in Input order
+        std::array<double, NInputs> putSensitivities;
+        std::array<double, NInputs> callSensitivityErrors;  // Standard errors of the sensitivities
+        std::array<double, NInputs> putSensitivityErrors;
+        std::size_t tapeNodes;                              // Largest tape of a path
+    };
+
+public:
+    AADEngine(const std::shared_ptr<OptionData>& data, const RNGAbstract& rng, const PricerAbstract& pricer, std::size_t NT);
+
+    Result run(std::size_t nSim);
+    void set_thread_count(std::size_t nThreads);    // Number of worker threads (0 = hardware concurrency)
+
+private:
+    static constexpr std::size_t ChunkSize = 1024;  // Paths per chunk
+
+    struct alignas(64) Moments
+    { // Moments of a chunk
+        ControlMoments call;
+        ControlMoments put;
+        std::array<ControlMoments, NInputs> callSensitivities;
+        std::array<ControlMoments, NInputs> putSensitivities;
+        std::size_t tapeNodes{};
+    };
+
+    void run_chunk(std::size_t first, std::size_t last, Moments& moments) const;
+
+private:
+    std::shared_ptr<OptionData> m_data;
+    SDEBase<SDE> m_sde;
+    EulerFDM<SDE> m_fdm;
+    const RNGAbstract& m_rng;
+    const PricerAbstract& m_pricer;
+    std::size_t m_nThreads;
+};
+
+//------------Implementations------------
+
+template <typename SDE>
+AADEngine<SDE>::AADEngine(const std::shared_ptr<OptionData>& data, const RNGAbstract& rng, const PricerAbstract& pricer, std::size_t NT)
+    : m_data{ data }, m_sde(SDE(data)), m_fdm(m_sde, NT), m_rng(rng), m_pricer(pricer), m_nThreads{ 1 }
+{
+    if (NT < 1)
+        throw std::invalid_argument("At least one time step is needed.");
+    if (rng.low_discrepancy())
+        throw std::invalid_argument("Adjoint sensitivities need a pseudo-random generator.");
+}
+
+template <typename SDE>
+void AADEngine<SDE>::set_thread_count(std::size_t nThreads)
+{
+    m_nThreads = nThreads == 0 ? std::max<std::size_t>(1, std::thread::hardware_concurrency()) : nThreads;
+}
+
+template <typename SDE>
+typename AADEngine<SDE>::Result AADEngine<SDE>::run(std::size_t nSim)
+{
+    if (nSim < 2)
+        throw std::invalid_argument("At least two paths are needed to estimate a variance.");
+
+    std::size_t nChunks = (nSim + ChunkSize - 1) / ChunkSize;
+    std::vector<Moments> slots(nChunks);
+    std::atomic_size_t nextChunk{ 0 };
+
+    auto worker = [&]()
+        {
+            for (std::size_t chunk = nextChunk.fetch_add(1); chunk < nChunks; chunk = nextChunk.fetch_add(1))
+            {
+                std::size_t first = chunk * ChunkSize;
+                run_chunk(first, std::min(first + ChunkSize, nSim), slots[chunk]);
+            }
+        };
+
+    std::size_t nWorkers = std::min(m_nThreads, nChunks);
+    if (nWorkers <= 1)
+    {
+        worker();
+    }
+    else
+    {
+        std::vector<std::jthread> workers;
+        for (std::size_t w = 0; w < nWorkers; ++w)
+            workers.emplace_back(worker);
+    }
+
+    Moments total;
+    for (const Moments& slot : slots)
+    { // Chunk order
+        total.call.merge(slot.call, 0);
+        total.put.merge(slot.put, 0);
+        for (std::size_t i = 0; i < NInputs; ++i)
+        {
+            total.callSensitivities[i].merge(slot.callSensitivities[i], 0);
+            total.putSensitivities[i].merge(slot.putSensitivities[i], 0);
+        }
+        total.tapeNodes = std::max(total.tapeNodes, slot.tapeNodes);
+    }
+
+    // The samples are already discounted
+    double n = static_cast<double>(nSim);
+    auto error = [n](const ControlMoments& moments) { return std::sqrt(moments.estimate(nullptr, 0).variance / n); };
+
+    Result result{};
+    result.callPrice = total.call.mean();
+    result.putPrice = total.put.mean();
+    result.callError = error(total.call);
+    result.putError = error(total.put);
+    for (std::size_t i = 0; i < NInputs; ++i)
+    {
+        result.callSensitivities[i] = total.callSensitivities[i].mean();
+        result.putSensitivities[i] = total.putSensitivities[i].mean();
+        result.callSensitivityErrors[i] = error(total.callSensitivities[i]);
+        result.putSensitivityErrors[i] = error(total.putSensitivities[i]);
+    }
+    result.tapeNodes = total.tapeNodes;
+
+    return result;
+}
+
+template <typename SDE>
+void AADEngine<SDE>::run_chunk(std::size_t first, std::size_t last, Moments& moments) const
+{
+    const std::size_t NT = m_fdm.get_NT();
+    const std::vector<double> mesh = m_fdm.get_mesh();
+    const double dt = m_fdm.get_meshSize();
+    const OptionData& od = *m_data;
+
+    aad::Tape& tape = aad::Tape::local();
+    std::vector<double> normals(NT);
+    std::vector<aad::Real> path(NT + 1);
+    std::array<double, NInputs> callSensitivities{}, putSensitivities{};
+
+    for (std::size_t i = first; i < last; ++i)
+    {
+        // Path i always reads the same stream
+        m_rng.seek(i);
+        m_rng.fill(normals);
+
+        tape.rewind();
+        ModelInputs<aad::Real> inputs{ aad::Real::input(od.S0), aad::Real::input(od.vol), aad::Real::input(od.r),
+            aad::Real::input(od.q), aad::Real::input(od.betaCEV) };
+        const std::array<const aad::Real*, NInputs> leaves{ &inputs.S0, &inputs.vol, &inputs.r, &inputs.q, &inputs.betaCEV };
+
+        path[0] = inputs.S0;
+        for (std::size_t j = 1; j <= NT; ++j)
+            path[j] = m_fdm.advance(path[j - 1], mesh[j - 1], dt, normals[j - 1], inputs);
+
+        auto [callPayoff, putPayoff] = m_pricer.adjoint_payoffs(path);
+        aad::Real discount = exp(-inputs.r * od.T);
+        aad::Real call = discount * callPayoff;
+        aad::Real put = discount * putPayoff;
+
+        tape.propagate(call.index());
+        for (std::size_t k = 0; k < NInputs; ++k)
+            callSensitivities[k] = leaves[k]->adjoint();
+        tape.propagate(put.index());
+        for (std::size_t k = 0; k < NInputs; ++k)
+            putSensitivities[k] = leaves[k]->adjoint();
+
+        moments.call.add(call.value(), nullptr, 0);
+        moments.put.add(put.value(), nullptr, 0);
+        for (std::size_t k = 0; k < NInputs; ++k)
+        {
+            moments.callSensitivities[k].add(callSensitivities[k], nullptr, 0);
+            moments.putSensitivities[k].add(putSensitivities[k], nullptr, 0);
+        }
+        moments.tapeNodes = std::max(moments.tapeNodes, tape.size());
+    }
+}
@@ -0,0 +1,79 @@
+// BatchRunner.hpp
+// 
+// Non-interactive runs: a job file lists the contracts to price (one job per CSV row or per JSON line)
+// with their option data, model, scheme, RNG, pricer, NT, number of paths and seed.
+// The jobs are scheduled on a thread pool, longest first (paths x NT), so the short ones fill the
+// cores while the long ones run; each job runs single-threaded on the statically dispatched engine.
+// One result row per job (prices, standard errors, timing), written in the order of the job file.
+// A line that cannot be parsed or fails validation gets an error row, the other jobs still run.
+// 
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "OptionData.hpp"
+
+struct BatchJob
+{ // Keys of the job file in brackets
+    std::string id;                     // [id] Identifier echoed in the results (line number by default)
+    OptionData data;                    // [S0, K, T, r, vol, q, beta]
+    std::string model{ "gbm" };         // [model] gbm, cev
+    std::string scheme{ "euler" };      // [scheme] euler, milstein, pc (predictor-corrector), logeuler, exact (GBM only)
+    std::string rng{ "philox" };        // [rng] mt, polar, boxmuller, philox, sobol
+    std::string pricer{ "european" };   // [pricer] european, asian, barrier
+    std::string barrierType{ "do" };    // [barrier_type] ui, uo, di, do
+    double barrier{};                   // [barrier] Barrier level, required by barrier jobs
+    std::size_t NT{ 100 };              // [NT] Time steps
+    std::size_t paths{ 100'000 };       // [paths] Number of simulations (cap of an adaptive run)
+    std::uint64_t seed{};               // [seed] Seed of Philox and of the scrambled Sobol sequence
+    bool antithetic{};                  // [antithetic] 0 or 1
+    double targetError{};               // [target_error] Stop once the standard error is met (0 = fixed run)
+    std::string error;                  // Set if the line could not be parsed or validated: the job is reported as failed, not run
+
+    double cost() const;                // Estimated cost used to schedule the jobs
+};
+
+struct BatchResult
+{
+    std::string id;
+    std::string error;                  // Empty if the job succeeded
+    double call{};
+    double callError{};                 // NaN for low-discrepancy runs
+    double put{};
+    double putError{};
+    std::size_t nSim{};                 // Samples used
+    double duration{};                  // Seconds
+};
+
+class BatchRunner
+{
+public:
+    enum class Format
+    {
+        CSV,                            // Header row with the keys, one job per row
+        JSONLines                       // One flat JSON object per line
+    };
+
+public:
+    explicit BatchRunner(std::size_t nThreads = 0); // 0 = hardware concurrency
+
+    static Format format_of(const std::string& path); // From the extension (.csv, .jsonl, .json)
+    static std::vector<BatchJob> read_jobs(std::istream& in, Format format); // Invalid lines give failed jobs
+    static BatchResult run_job(const BatchJob& job); // Errors are reported in the result
+    static void write_results(std::ostream& out, const std::vector<BatchResult>& results);
+
+    std::vector<BatchResult> run(const std::vector<BatchJob>& jobs); // Results in the order of the jobs
+    double duration() const;            // Wall time of the last run (seconds)
+    std::size_t thread_count() const;
+
+private:
+    std::size_t m_nThreads;
+    double m_duration;
+};
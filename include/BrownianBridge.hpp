@@ -0,0 +1,36 @@
+// BrownianBridge.hpp
+//
+// Brownian bridge construction of a discretised Brownian path.
+// The first normal fixes the end point of the path, the next ones the midpoints of the
+// remaining intervals, so that the leading coordinates of a quasi-random point drive the
+// coarse shape of the path.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+class BrownianBridge
+{
+public:
+    explicit BrownianBridge(std::size_t NT); // Uniform mesh with NT steps
+
+    // Maps NT independent normals (ordered by importance) to the NT standardised increments
+    // (W(t_{j+1}) - W(t_j)) / sqrt(dt), which are again independent standard normals.
+    // The two buffers must not overlap.
+    void transform(std::span<const double> normals, std::span<double> increments) const;
+
+    std::size_t size() const;
+
+private:
+    std::size_t m_NT;
+    std::vector<std::size_t> m_bridgeIndex; // Point built at each stage
+    std::vector<std::size_t> m_leftIndex;   // Left neighbour (one past, 0 = origin)
+    std::vector<std::size_t> m_rightIndex;  // Right neighbour
+    std::vector<double> m_leftWeight;
+    std::vector<double> m_rightWeight;
+    std::vector<double> m_stdDev;
+};
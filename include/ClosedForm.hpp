@@ -0,0 +1,35 @@
+// ClosedForm.hpp
+//
+// Closed-form prices under Geometric Brownian Motion, used as benchmarks (control variates)
+// Black-Scholes vanilla options and discretely monitored geometric average Asian options
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <cstddef>
+
+#include "OptionData.hpp"
+
+namespace ClosedForm
+{
+	double normal_cdf(double x);
+
+	// Discounted prices of the vanilla payoffs on S_T
+	double black_scholes_call(const OptionData& od);
+	double black_scholes_put(const OptionData& od);
+
+	// Black-Scholes sensitivities of the call (delta, gamma, vega, rho), as benchmarks of the Monte Carlo Greeks
+	double black_scholes_call_delta(const OptionData& od);
+	double black_scholes_call_gamma(const OptionData& od);
+	double black_scholes_call_vega(const OptionData& od);
+	double black_scholes_call_rho(const OptionData& od);
+
+	// Discounted prices of the payoffs on the geometric average of the NT + 1 points S_0, S_dt, ..., S_T
+	double geometric_asian_call(const OptionData& od, std::size_t NT);
+	double geometric_asian_put(const OptionData& od, std::size_t NT);
+
+	// Discounted expectation of S_T (martingale under the risk-neutral measure, up to dividends)
+	double discounted_terminal(const OptionData& od);
+}
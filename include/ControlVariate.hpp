@@ -0,0 +1,58 @@
+// ControlVariate.hpp
+//
+// Control variates: quantities of a path whose discounted expectation is known in closed form.
+// The pricers regress their payoff on the controls, the coefficients are estimated from running
+// co-moments (one accumulator per slot, merged once the run is over) and applied in post_process.
+// With no control the same accumulators give the plain mean and its standard error.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+struct ControlVariate
+{
+	enum class Kind
+	{
+		Terminal = 1,		// S_T (martingale control)
+		VanillaTerminal,	// Vanilla payoff on S_T (Black-Scholes)
+		GeometricAverage	// Vanilla payoff on the geometric average (closed-form geometric Asian)
+	};
+
+	Kind kind;
+	double strike;		// Strike of the vanilla payoffs (unused for Terminal)
+	double callMean;	// Discounted expectation of the control paired with the call
+	double putMean;		// Discounted expectation of the control paired with the put
+};
+
+inline constexpr std::size_t MaxControls = 3;
+
+class ControlMoments
+{ // Running means and co-moments of a payoff Y and of k controls X (Welford updates, Chan merges)
+public:
+	struct Estimate
+	{
+		double mean;		// Mean of Y - beta (X - E[X])
+		double variance;	// Var[Y - beta X] (per sample)
+		double reduction;	// Var[Y] / Var[Y - beta X]
+	};
+
+public:
+	void add(double y, const double* x, std::size_t k);
+	void merge(const ControlMoments& other, std::size_t k);
+	Estimate estimate(const double* expected, std::size_t k) const; // Optimal beta = Cov[X, X]^-1 Cov[X, Y]
+
+	std::size_t count() const { return m_n; }
+	double mean() const { return m_meanY; }
+
+private:
+	std::size_t m_n{};
+	double m_meanY{};
+	double m_m2Y{};
+	std::array<double, MaxControls> m_meanX{};
+	std::array<double, MaxControls> m_cXY{};
+	std::array<std::array<double, MaxControls>, MaxControls> m_cXX{};
+};
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <concepts>
+#include <span>
+#include <vector>
 
 #include "SDEBase.hpp"
 
@@ -20,6 +22,10 @@ public:
 
 	virtual double advance(double  xn, double  tn, double  dt, double  WienerIncrement, double  WienerIncrement2) const = 0;
 
+    // Advance a block of paths by one step: xn, normals and next hold one value per path.
+    // Defaults to one advance() per path, schemes override it with vectorised kernels.
+    virtual void advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const;
+
     std::size_t get_NT() const;
     std::vector<double> get_mesh() const;
     double get_meshSize() const;
@@ -31,6 +37,14 @@ protected:
     double m_meshSize;			   // Mesh size
 };
 
+// Schemes that can step the logarithm of the process: log S(t + dt) = log S(t) + a + b Z for a whole block.
+// The engine then sums the log-increments and only exponentiates where the pricers need spot values.
+template <typename Scheme>
+concept ILogSpaceScheme = requires (const Scheme s, std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt)
+{
+    s.log_advance_block(x, t, dt, z, next);
+};
+
 //------------Implementations------------
 
 template <typename SDE>
@@ -43,6 +57,15 @@ FDMAbstract<SDE>::FDMAbstract(const SDEBase<SDE>& sde, std::size_t NT)
 	}
 }
 
+template <typename SDE>
+void FDMAbstract<SDE>::advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const
+{
+	for (std::size_t p = 0; p < xn.size(); ++p)
+	{
+		next[p] = advance(xn[p], tn, dt, normals[p], 0.0);
+	}
+}
+
 template <typename SDE>
 std::size_t FDMAbstract<SDE>::get_NT() const
 {
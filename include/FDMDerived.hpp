@@ -1,7 +1,9 @@
 // FDMDerived.hpp
 // 
 // Actual FDM. 
-// Currently supports Euler FDM and Exact FDM.
+// Currently supports Euler, Milstein, predictor-corrector, log-Euler and Exact FDM.
+// Milstein and the predictor-corrector need the derivative of the diffusion (strong order 1 against 1/2 for Euler),
+// log-Euler steps the logarithm of the process (exact for GBM, keeps the paths positive).
 // 
 // Pierre-Yves Sojic
 //
@@ -10,35 +12,94 @@
 
 #include <vector>
 #include <cmath>
+#include <stdexcept>
 
 #include "FDMAbstract.hpp"
 #include "SDEBase.hpp"
+#include "SIMDMath.hpp"
 
 //--------------Euler-----------------
 
 template <typename SDE>
-class EulerFDM : public FDMAbstract<SDE>
+class EulerFDM final : public FDMAbstract<SDE>
 {
 public:
     EulerFDM(const SDEBase<SDE>& sde, std::size_t m_NT);
 
     double advance(double xn, double tn, double dt, double normalVar, double normalVar2) const override;
+    void advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const override;
+
+    // Same step on explicit model inputs (e.g. aad::Real, the step is then recorded on the tape)
+    template <typename Real>
+    Real advance(const Real& xn, double tn, double dt, double normalVar, const ModelInputs<Real>& inputs) const;
 };
 
-//--------------Exact-----------------
+//--------------Milstein-----------------
 
 template <typename SDE>
-class ExactFDM : public FDMAbstract<SDE>
+    requires IDiffusionDerivative<SDE>
+class MilsteinFDM final : public FDMAbstract<SDE>
 {
 public:
-    ExactFDM(const SDEBase<SDE>& sde, std::size_t NT, double S0, double vol, double r);
+    MilsteinFDM(const SDEBase<SDE>& sde, std::size_t NT);
+
+    double advance(double xn, double tn, double dt, double normalVar, double normalVar2) const override;
+    void advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const override;
+};
+
+//--------------Predictor-corrector-----------------
+
+template <typename SDE>
+    requires IDriftCorrected<SDE>
+class PredictorCorrectorFDM final : public FDMAbstract<SDE>
+{ // Euler predictor, then the corrected drift and the diffusion averaged between both ends of the step
+public:
+    PredictorCorrectorFDM(const SDEBase<SDE>& sde, std::size_t NT, double alpha = 0.5, double beta = 0.5); // Weights of the drift and of the diffusion at the predictor
+
+    double advance(double xn, double tn, double dt, double normalVar, double normalVar2) const override;
+    void advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const override;
+
+private:
+    double m_alpha;
+    double m_beta;
+};
+
+//--------------Log-Euler-----------------
+
+template <typename SDE>
+class LogEulerFDM final : public FDMAbstract<SDE>
+{ // Euler step of log S: S exp((mu / S - (sigma / S)^2 / 2) dt + sigma / S sqrt(dt) Z)
+public:
+    LogEulerFDM(const SDEBase<SDE>& sde, std::size_t NT);
+
+    double advance(double xn, double tn, double dt, double normalVar, double normalVar2) const override;
+    void advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const override;
+};
+
+//--------------Exact-----------------
+
+template <typename SDE>
+class ExactFDM final : public FDMAbstract<SDE>
+{ // Exact step of GBM: S(t + dt) = S(t) exp((r - q - vol^2 / 2) dt + vol sqrt(dt) Z)
+public:
+    ExactFDM(const SDEBase<SDE>& sde, std::size_t NT, double vol, double r, double q = 0.0);
 
     double advance(double xn, double tn, double dt, double normalVar, double normalVar2) const override;
+    void advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const override;
+
+    // Same step on log S: one fused multiply-add per path (see ILogSpaceScheme)
+    void log_advance_block(std::span<const double> logx, double tn, double dt, std::span<const double> normals, std::span<double> next) const;
+
+private:
+    double log_drift(double dt) const;      // (r - q - vol^2 / 2) dt
+    double log_diffusion(double dt) const;  // vol sqrt(dt)
 
 private:
-    double m_S0;
     double m_vol;
     double m_r;
+    double m_q;
+    double m_drift;                         // Precomputed on the mesh
+    double m_diffusion;
 };
 
 //------------Implementations------------
@@ -54,17 +115,164 @@ double EulerFDM<SDE>::advance(double xn, double  tn, double  dt, double normalVa
 	return xn + this->m_SDE.drift(xn, tn) * dt + this->m_SDE.diffusion(xn, tn) * std::sqrt(dt) * normalVar;
 }
 
-//--------------Exact-----------------
+template <typename SDE>
+void EulerFDM<SDE>::advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const
+{
+	if constexpr (IEulerBlock<SDE>)
+	{ // Vectorised kernel provided by the SDE
+		this->m_SDE.euler_block(xn, normals, next, tn, dt);
+	}
+	else
+	{
+		FDMAbstract<SDE>::advance_block(xn, tn, dt, normals, next);
+	}
+}
+
+template <typename SDE>
+template <typename Real>
+Real EulerFDM<SDE>::advance(const Real& xn, double tn, double dt, double normalVar, const ModelInputs<Real>& inputs) const
+{
+	return xn + this->m_SDE.drift(xn, tn, inputs) * dt + this->m_SDE.diffusion(xn, tn, inputs) * (std::sqrt(dt) * normalVar);
+}
+
+//--------------Milstein-----------------
+
+template <typename SDE>
+    requires IDiffusionDerivative<SDE>
+MilsteinFDM<SDE>::MilsteinFDM(const SDEBase<SDE>& sde, std::size_t NT)
+	: FDMAbstract<SDE>(sde, NT)
+{}
+
+template <typename SDE>
+    requires IDiffusionDerivative<SDE>
+double MilsteinFDM<SDE>::advance(double xn, double tn, double dt, double normalVar, double normalVar2) const
+{
+	double diffusion = this->m_SDE.diffusion(xn, tn);
+	return xn + this->m_SDE.drift(xn, tn) * dt + diffusion * std::sqrt(dt) * normalVar
+		+ 0.5 * diffusion * this->m_SDE.diffusion_derivative(xn) * dt * (normalVar * normalVar - 1.0);
+}
+
+template <typename SDE>
+    requires IDiffusionDerivative<SDE>
+void MilsteinFDM<SDE>::advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const
+{
+	if constexpr (IMilsteinBlock<SDE>)
+	{ // Vectorised kernel provided by the SDE
+		this->m_SDE.milstein_block(xn, normals, next, tn, dt);
+	}
+	else
+	{
+		for (std::size_t p = 0; p < xn.size(); ++p)
+		{ // Non-virtual call
+			next[p] = MilsteinFDM::advance(xn[p], tn, dt, normals[p], 0.0);
+		}
+	}
+}
+
+//--------------Predictor-corrector-----------------
+
+template <typename SDE>
+    requires IDriftCorrected<SDE>
+PredictorCorrectorFDM<SDE>::PredictorCorrectorFDM(const SDEBase<SDE>& sde, std::size_t NT, double alpha, double beta)
+	: FDMAbstract<SDE>(sde, NT), m_alpha{ alpha }, m_beta{ beta }
+{
+	if (alpha < 0.0 || alpha > 1.0 || beta < 0.0 || beta > 1.0)
+		throw std::invalid_argument("Predictor-corrector weights must be in [0, 1].");
+}
+
+template <typename SDE>
+    requires IDriftCorrected<SDE>
+double PredictorCorrectorFDM<SDE>::advance(double xn, double tn, double dt, double normalVar, double normalVar2) const
+{
+	double dW = std::sqrt(dt) * normalVar;
+	double diffusion = this->m_SDE.diffusion(xn, tn);
+	double predictor = xn + this->m_SDE.drift(xn, tn) * dt + diffusion * dW;
+
+	// The corrected drift a - beta b b' keeps the scheme consistent with the Ito integral
+	double drift = m_alpha * this->m_SDE.drift_corrected(predictor, tn + dt, m_beta) + (1.0 - m_alpha) * this->m_SDE.drift_corrected(xn, tn, m_beta);
+	double averaged = m_beta * this->m_SDE.diffusion(predictor, tn + dt) + (1.0 - m_beta) * diffusion;
+	return xn + drift * dt + averaged * dW;
+}
 
 template <typename SDE>
-ExactFDM<SDE>::ExactFDM(const SDEBase<SDE>& sde, std::size_t NT, double S0, double vol, double r)
-	: FDMAbstract<SDE>(sde, NT), m_S0{ S0 }, m_vol{ vol }, m_r{ r }
+    requires IDriftCorrected<SDE>
+void PredictorCorrectorFDM<SDE>::advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const
+{
+	for (std::size_t p = 0; p < xn.size(); ++p)
+	{ // Non-virtual call
+		next[p] = PredictorCorrectorFDM::advance(xn[p], tn, dt, normals[p], 0.0);
+	}
+}
+
+//--------------Log-Euler-----------------
+
+template <typename SDE>
+LogEulerFDM<SDE>::LogEulerFDM(const SDEBase<SDE>& sde, std::size_t NT)
+	: FDMAbstract<SDE>(sde, NT)
 {}
 
+template <typename SDE>
+double LogEulerFDM<SDE>::advance(double xn, double tn, double dt, double normalVar, double normalVar2) const
+{
+	double mu = this->m_SDE.drift(xn, tn) / xn;
+	double sigma = this->m_SDE.diffusion(xn, tn) / xn;
+	return xn * std::exp((mu - 0.5 * sigma * sigma) * dt + sigma * std::sqrt(dt) * normalVar);
+}
+
+template <typename SDE>
+void LogEulerFDM<SDE>::advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const
+{
+	for (std::size_t p = 0; p < xn.size(); ++p)
+	{ // Non-virtual call
+		next[p] = LogEulerFDM::advance(xn[p], tn, dt, normals[p], 0.0);
+	}
+}
+
+//--------------Exact-----------------
+
+template <typename SDE>
+ExactFDM<SDE>::ExactFDM(const SDEBase<SDE>& sde, std::size_t NT, double vol, double r, double q)
+	: FDMAbstract<SDE>(sde, NT), m_vol{ vol }, m_r{ r }, m_q{ q }, m_drift{}, m_diffusion{}
+{
+	m_drift = (m_r - m_q - 0.5 * m_vol * m_vol) * this->m_meshSize;
+	m_diffusion = m_vol * std::sqrt(this->m_meshSize);
+}
+
+template <typename SDE>
+double ExactFDM<SDE>::log_drift(double dt) const
+{
+	return dt == this->m_meshSize ? m_drift : (m_r - m_q - 0.5 * m_vol * m_vol) * dt;
+}
+
+template <typename SDE>
+double ExactFDM<SDE>::log_diffusion(double dt) const
+{
+	return dt == this->m_meshSize ? m_diffusion : m_vol * std::sqrt(dt);
+}
+
 template <typename SDE>
 double ExactFDM<SDE>::advance(double xn, double  tn, double  dt, double normalVar, double normalVar2) const
 {
-	// Compute exact value at tn + dt.
-	double alpha = 0.5 * m_vol * m_vol;
-	return m_S0 * std::exp((m_r - alpha) * (tn + dt) + m_vol * std::sqrt(tn + dt) * normalVar);
+	// Compute exact value at tn + dt from the value at tn
+	return xn * std::exp(log_drift(dt) + log_diffusion(dt) * normalVar);
+}
+
+template <typename SDE>
+void ExactFDM<SDE>::advance_block(std::span<const double> xn, double tn, double dt, std::span<const double> normals, std::span<double> next) const
+{
+	// Log-increments, then a single vectorised exp over the block
+	double a = log_drift(dt), b = log_diffusion(dt);
+	for (std::size_t p = 0; p < xn.size(); ++p)
+		next[p] = a + b * normals[p];
+	simd::exp(next.data(), next.data(), xn.size());
+	for (std::size_t p = 0; p < xn.size(); ++p)
+		next[p] *= xn[p];
+}
+
+template <typename SDE>
+void ExactFDM<SDE>::log_advance_block(std::span<const double> logx, double tn, double dt, std::span<const double> normals, std::span<double> next) const
+{
+	double a = log_drift(dt), b = log_diffusion(dt);
+	for (std::size_t p = 0; p < logx.size(); ++p)
+		next[p] = logx[p] + a + b * normals[p];
 }
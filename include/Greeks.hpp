@@ -0,0 +1,74 @@
+// Greeks.hpp
+//
+// Sensitivities of the prices to S0 (delta, gamma), vol (vega) and r (rho) under GBM, estimated in
+// the same pass as the prices. The stored path is enough to rebuild the driving normals and the
+// pathwise tangents dS/dvol and dS/dr, so the engine does not change: the pricers combine them into
+// pathwise estimators where the payoff is Lipschitz, and into likelihood ratio weights (score of the
+// path density) where it is not. The steps are those of the scheme that simulated the path (Gaussian
+// Euler steps, or the lognormal steps of the exact and log-Euler schemes), so the estimators are
+// unbiased for the discretised price, the one bump-and-revalue differentiates. Milstein and the
+// predictor-corrector have no closed-form step density and are not supported.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "PathBlock.hpp"
+
+enum class GreekScheme
+{
+	Euler,		// S_{j+1} = S_j (1 + (r - q) dt + vol sqrt(dt) Z_j)
+	Exact		// S_{j+1} = S_j exp((r - q - vol^2 / 2) dt + vol sqrt(dt) Z_j), also log-Euler under GBM
+};
+
+struct GreekModel
+{ // GBM parameters the sensitivities are taken with respect to
+	double S0;
+	double vol;
+	double r;
+	double q;
+	double T;
+	GreekScheme scheme = GreekScheme::Euler; // Scheme that simulated the paths
+};
+
+enum class Greek
+{
+	Delta,
+	Gamma,
+	Vega,
+	Rho
+};
+
+inline constexpr std::size_t NGreeks = 4;
+
+struct PathTangents
+{ // Quantities of a path of GBM the Greek estimators are built from
+	double terminal;		// S_T
+	double average;			// Arithmetic average of the NT + 1 points
+	double vegaTerminal;	// dS_T / dvol
+	double vegaAverage;		// d average / dvol
+	double rhoTerminal;		// dS_T / dr
+	double rhoAverage;		// d average / dr
+	double brownian;		// W_T, sum of sqrt(dt) Z
+	double deltaScore;		// d log density / dS0 (only the first step depends on S0)
+	double gammaScore;		// Second derivative of the density over the density, w.r.t. S0
+	double vegaScore;		// d log density / dvol of the whole path
+	double rhoScore;		// d log density / dr = W_T / vol
+	double min;				// Extrema of the path
+	double max;
+	std::size_t nPoints;	// NT + 1, S0 included
+};
+
+// Undiscounted per-path samples of every Greek, rho including the -T payoff of the discounting
+struct GreekSample
+{
+	std::array<double, NGreeks> call{};
+	std::array<double, NGreeks> put{};
+};
+
+// Tangents of path p of a block, stepped with model.scheme
+PathTangents path_tangents(const PathBlock& block, std::size_t p, const GreekModel& model);
@@ -0,0 +1,123 @@
+// Instrumentation.hpp
+// 
+// Low-overhead counters of the engine hot path: time (time stamp counter ticks) and number of calls
+// per stage (random generation, advance, pricer callbacks, synchronisation, reduction), plus the chunks
+// and paths run by every thread to expose load imbalance. Each worker writes its own cache line,
+// the counters are only read once the run is over.
+// Built with MC_INSTRUMENTATION=1 (CMake option MC_INSTRUMENTATION), otherwise the probes are empty
+// objects and compile out of the hot path entirely.
+// 
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef MC_INSTRUMENTATION
+#define MC_INSTRUMENTATION 0
+#endif
+
+namespace profiling
+{
+    inline constexpr bool Enabled = MC_INSTRUMENTATION != 0;
+
+    enum class Stage
+    {
+        Random,         // Normals (RNG, Brownian bridge)
+        Advance,        // Scheme steps (and the streamed statistics)
+        Pricer,         // Pricer callbacks
+        Sync,           // Waits on the engine locks (merge of the slots)
+        Reduction       // Merge of the slots (adaptive runs) and post-processing
+    };
+    inline constexpr std::size_t NStages = 5;
+
+    // Time stamp counter, or the virtual counter on ARM, or a steady clock elsewhere
+    inline std::uint64_t ticks()
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        std::uint64_t value;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    struct alignas(64) ThreadCounters
+    { // Written by a single thread
+        std::array<std::uint64_t, NStages> ticks{};
+        std::array<std::uint64_t, NStages> calls{};
+        std::uint64_t busy{};       // Ticks spent in the worker loop
+        std::uint64_t chunks{};
+        std::uint64_t paths{};
+    };
+
+    class StageTimer
+    { // Adds the ticks of its lifetime to one stage of the counters
+    public:
+        StageTimer(ThreadCounters* counters, Stage stage)
+        {
+            if constexpr (Enabled)
+            {
+                m_counters = counters;
+                m_stage = static_cast<std::size_t>(stage);
+                m_start = ticks();
+            }
+        }
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+        ~StageTimer()
+        {
+            if constexpr (Enabled)
+            {
+                m_counters->ticks[m_stage] += ticks() - m_start;
+                ++m_counters->calls[m_stage];
+            }
+        }
+
+    private:
+        ThreadCounters* m_counters{};   // Unused (and optimised away) when the instrumentation is compiled out
+        std::size_t m_stage{};
+        std::uint64_t m_start{};
+    };
+
+    class StageProfile
+    { // Counters of one run, one set per thread
+    public:
+        void reset(std::size_t nThreads);
+        void begin();                               // Calibrates the ticks against the steady clock over the run
+        void end();
+        ThreadCounters* thread(std::size_t t) { return &m_threads[t]; }
+
+        std::size_t thread_count() const;
+        double seconds(Stage stage) const;          // Summed over the threads
+        std::uint64_t calls(Stage stage) const;
+        double wall_time() const;                   // Seconds between begin() and end()
+        double imbalance() const;                   // Largest number of chunks of a thread over the average
+
+        void write_table(std::ostream& out) const;
+        void write_json(std::ostream& out) const;
+
+    private:
+        double to_seconds(std::uint64_t t) const;
+
+    private:
+        std::vector<ThreadCounters> m_threads;
+        std::uint64_t m_beginTicks{};
+        std::uint64_t m_endTicks{};
+        std::chrono::steady_clock::time_point m_beginTime;
+        std::chrono::steady_clock::time_point m_endTime;
+    };
+}
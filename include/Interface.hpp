@@ -7,6 +7,12 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Greeks.hpp"
 #include "OptionData.hpp"
 #include "Singleton.hpp"
 
@@ -16,6 +22,12 @@ public:
 	void display_european(double callprice, double putprice, std::size_t nSim, double duration) const;
 	void display_asian(double callprice, double putprice, double geomcallprice, double geomputprice, std::size_t nSim, double duration) const;
 	void display_barrier(double callprice, double putprice, double barrierAmount, std::size_t nSim, double duration) const;
+	void display_portfolio(const std::vector<std::string>& labels, const std::vector<double>& callprices, const std::vector<double>& putprices,
+		const std::vector<double>& callerrors, const std::vector<double>& puterrors, std::size_t nSim, double duration, bool quasirandom) const;
+	void display_standard_errors(double callerror, double puterror, bool quasirandom) const;
+	void display_control_variates(double plaincallprice, double plainputprice, double callreduction, double putreduction) const;
+	void display_greeks(const std::array<double, NGreeks>& callgreeks, const std::array<double, NGreeks>& putgreeks,
+		const std::array<double, NGreeks>& callerrors, const std::array<double, NGreeks>& puterrors, bool quasirandom) const;
 
 public:
 	std::shared_ptr<OptionData> m_data;
@@ -8,11 +8,15 @@
 #pragma once
 
 #include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 #include <tuple>
 #include <functional>
 #include <iostream>
 #include <exception>
 
+#include "ClosedForm.hpp"
 #include "OptionData.hpp"
 #include "SDEBase.hpp"
 #include "SDEConcrete.hpp"
@@ -31,27 +35,52 @@ public:
     using RNGPointer = std::unique_ptr<RNGAbstract>;
     using PricerPointer = std::shared_ptr<PricerAbstract>;
     using PartsTuple = std::tuple<SDEBase<SDE>, FDMPointer, RNGPointer>;
-    using OptionPath = std::function<void(const std::vector<double>& path)>;
+    using Prepare = std::function<void(std::size_t nSlots)>;
+    using OptionPath = std::function<void(const std::vector<double>& path, std::size_t slot)>;
+    using OptionBlock = std::function<void(const PathBlock& block, std::size_t slot)>;
     using Finish = std::function<void(double)>;
+    using MergeSlot = std::function<double(std::size_t slot)>;
+    using Truncate = std::function<void(std::size_t nSlots)>;
 
 public:
     MCBuilder(const std::shared_ptr<OptionData>& optionData);
 
     PartsTuple parts(const SDEBase<SDE>& sde, const FDMAbstract<SDE>& fdm, const RNGAbstract& rng) const;
     PartsTuple parts(); // Takes user input in the console for the different option
+    Prepare get_prepare() const;
     OptionPath get_path() const;
+    OptionBlock get_block() const;
     Finish get_finish() const;
+    MergeSlot get_merge() const;
+    Truncate get_truncate() const;
+    PricerPointer pricer() const;       // Pricer created by parts(), for the statically dispatched engine
 
 private:
     SDEBase<SDE> get_SDE() const;
     FDMPointer get_FDM(const SDEBase<SDE>& sde) const;
-    RNGPointer get_RNG() const;
-    PricerPointer get_pricer();
+    RNGPointer get_RNG(std::size_t dimension) const;
+    PricerPointer get_pricer(const FDMAbstract<SDE>& fdm);
+    PricerPointer get_contract(unsigned short choice, double strike, std::string& label) const; // One contract and its label
+
+private:
+    enum class PricerChoice
+    {
+        European = 1,
+        Asian,
+        Barrier,
+        Portfolio,
+        StrikeGrid
+    };
 
 private:
     std::shared_ptr<OptionData> m_data; // Option data
+    PricerPointer m_pricer;             // Pricer created by parts()
+    Prepare m_prepare;                  // Function used to size the pricer accumulators
     OptionPath m_path;                  // Function used to generate the path
+    OptionBlock m_block;                // Function used to send a block of paths
     Finish m_finish;                    // Function used to signal pricer to wrap up
+    MergeSlot m_merge;                  // Function used to merge a finished slot (adaptive runs)
+    Truncate m_truncate;                // Function used to drop the slots after the stopping point
 }; 
 
 //--------------Default Builder-----------------
@@ -64,15 +93,23 @@ public:
     using RNGPointer = std::unique_ptr<RNGAbstract>;
     using PricerPointer = std::shared_ptr<PricerAbstract>;
     using PartsTuple = std::tuple<SDEBase<SDE>, FDMPointer, RNGPointer>;
-    using OptionPath = std::function<void(const std::vector<double>& path)>;
+    using Prepare = std::function<void(std::size_t nSlots)>;
+    using OptionPath = std::function<void(const std::vector<double>& path, std::size_t slot)>;
+    using OptionBlock = std::function<void(const PathBlock& block, std::size_t slot)>;
     using Finish = std::function<void(double)>;
+    using MergeSlot = std::function<double(std::size_t slot)>;
+    using Truncate = std::function<void(std::size_t nSlots)>;
 
 public:
     MCDefaultBuilder(const std::shared_ptr<OptionData>& optionData);
 
     PartsTuple parts(); // Takes user input in the console for the different param
+    Prepare get_prepare() const;
     OptionPath get_path() const;
+    OptionBlock get_block() const;
     Finish get_finish() const;
+    MergeSlot get_merge() const;
+    Truncate get_truncate() const;
 
 private:
     SDEBase<SDE> get_SDE() const;
@@ -82,15 +119,19 @@ private:
 
 private:
     std::shared_ptr<OptionData> m_data; // Option data
+    Prepare m_prepare;                  // Function used to size the pricer accumulators
     OptionPath m_path;                  // Function used to generate the path
+    OptionBlock m_block;                // Function used to send a block of paths
     Finish m_finish;                    // Function used to signal pricer to wrap up
+    MergeSlot m_merge;                  // Function used to merge a finished slot (adaptive runs)
+    Truncate m_truncate;                // Function used to drop the slots after the stopping point
 };
 
 // ---------------Implementations---------------
 
 template <typename SDE>
 MCBuilder<SDE>::MCBuilder(const std::shared_ptr<OptionData>& optionData)
-	: m_data{ optionData }, m_path{ nullptr }, m_finish { nullptr }
+	: m_data{ optionData }, m_pricer{ nullptr }, m_prepare{ nullptr }, m_path{ nullptr }, m_block{ nullptr }, m_finish { nullptr }, m_merge{ nullptr }, m_truncate{ nullptr }
 {}
 
 template <typename SDE>
@@ -107,18 +148,30 @@ MCBuilder<SDE>::PartsTuple MCBuilder<SDE>::parts()
 {
     SDEBase<SDE> sde = std::move(get_SDE());
 	FDMPointer fdm = std::move(get_FDM(sde));
-	RNGPointer rng = std::move(get_RNG());
-	PricerPointer pricer = std::move(get_pricer());
+	RNGPointer rng = std::move(get_RNG(fdm->get_NT())); // One dimension per time step
+	m_pricer = get_pricer(*fdm);
 
     return std::make_tuple(std::move(sde), std::move(fdm), std::move(rng));
 }
 
+template <typename SDE>
+MCBuilder<SDE>::Prepare MCBuilder<SDE>::get_prepare() const
+{
+    return m_prepare;
+}
+
 template <typename SDE>
 MCBuilder<SDE>::OptionPath MCBuilder<SDE>::get_path() const
 {
     return m_path;
 }
 
+template <typename SDE>
+MCBuilder<SDE>::OptionBlock MCBuilder<SDE>::get_block() const
+{
+    return m_block;
+}
+
 template <typename SDE>
 MCBuilder<SDE>::Finish MCBuilder<SDE>::get_finish() const
 {
@@ -126,6 +179,25 @@ MCBuilder<SDE>::Finish MCBuilder<SDE>::get_finish() const
     return m_finish;
 }
 
+template <typename SDE>
+MCBuilder<SDE>::MergeSlot MCBuilder<SDE>::get_merge() const
+{
+    return m_merge;
+}
+
+template <typename SDE>
+MCBuilder<SDE>::Truncate MCBuilder<SDE>::get_truncate() const
+{
+    return m_truncate;
+}
+
+template <typename SDE>
+MCBuilder<SDE>::PricerPointer MCBuilder<SDE>::pricer() const
+{
+    Interface::instance()->m_data = m_data;
+    return m_pricer;
+}
+
 template <typename SDE>
 SDEBase<SDE> MCBuilder<SDE>::get_SDE() const
 {
@@ -146,12 +218,15 @@ MCBuilder<SDE>::FDMPointer MCBuilder<SDE>::get_FDM(const SDEBase<SDE>& sde) cons
     {
         Euler = 1,
         Exact,
+        Milstein,
+        PredictorCorrector,
+        LogEuler,
         
         FINISH // Add an addition choice that throw errors if chosen or above
     };
 
     std::cout << "Create FDM:\n";
-    std::cout << "Choose a FDM: 1. Euler, 2. Exact\n";
+    std::cout << "Choose a FDM: 1. Euler, 2. Exact, 3. Milstein, 4. Predictor-corrector, 5. Log-Euler\n";
 
 	short choice;
     std::cin >> choice;
@@ -173,7 +248,16 @@ MCBuilder<SDE>::FDMPointer MCBuilder<SDE>::get_FDM(const SDEBase<SDE>& sde) cons
         return std::make_unique<EulerFDM<SDE>>(sde, NT);
 
     case FDMChoice::Exact:
-        return std::make_unique<ExactFDM<SDE>>(sde, NT, m_data->S0, m_data->vol, m_data->r);
+        return std::make_unique<ExactFDM<SDE>>(sde, NT, m_data->vol, m_data->r, m_data->q);
+
+    case FDMChoice::Milstein:
+        return std::make_unique<MilsteinFDM<SDE>>(sde, NT);
+
+    case FDMChoice::PredictorCorrector:
+        return std::make_unique<PredictorCorrectorFDM<SDE>>(sde, NT);
+
+    case FDMChoice::LogEuler:
+        return std::make_unique<LogEulerFDM<SDE>>(sde, NT);
         
     default:
         return nullptr;
@@ -181,17 +265,19 @@ MCBuilder<SDE>::FDMPointer MCBuilder<SDE>::get_FDM(const SDEBase<SDE>& sde) cons
 }
 
 template <typename SDE>
-MCBuilder<SDE>::RNGPointer MCBuilder<SDE>::get_RNG() const
+MCBuilder<SDE>::RNGPointer MCBuilder<SDE>::get_RNG(std::size_t dimension) const
 {
     enum class RNGChoice
     {
         MersenneTwister = 1,
         PolarMarsagliaNet,
-        BoxMuller
+        BoxMuller,
+        Philox,
+        Sobol
     };
 
     std::cout << "Create RNG:\n";
-    std::cout << "Choose a RNG: 1. MersenneTwister, 2. PolarMarsagliaNet, 3. Box-Muller\n";
+    std::cout << "Choose a RNG: 1. MersenneTwister, 2. PolarMarsagliaNet, 3. Box-Muller, 4. Philox (reproducible), 5. Sobol (quasi-random)\n";
 
     short choice;
     std::cin >> choice;
@@ -208,41 +294,58 @@ MCBuilder<SDE>::RNGPointer MCBuilder<SDE>::get_RNG() const
     case RNGChoice::BoxMuller:
         return std::make_unique<BoxMuller>();
 
+    case RNGChoice::Philox:
+        {
+            std::uint64_t seed;
+            std::cout << "Enter the seed:\n";
+            std::cin >> seed;
+            return std::make_unique<Philox>(seed);
+        }
+
+    case RNGChoice::Sobol:
+        {
+            unsigned short schoice;
+            std::uint64_t seed = 0;
+            std::cout << "Choose the scrambling: 1. None, 2. Digital shift, 3. Owen\n";
+            std::cin >> schoice;
+            if (schoice < 1 || schoice > 3)
+                throw std::invalid_argument("Invalid scrambling. Make sure you enter a valid number.");
+
+            Sobol::Scrambling scrambling = static_cast<Sobol::Scrambling>(schoice - 1);
+            if (scrambling != Sobol::Scrambling::None)
+            {
+                std::cout << "Enter the seed:\n";
+                std::cin >> seed;
+            }
+            return std::make_unique<Sobol>(dimension, scrambling, seed);
+        }
+
     default:
         throw std::invalid_argument("Invalid RNG. Make sure you enter a valid number.");
     }
 }
 
 template <typename SDE>
-MCBuilder<SDE>::PricerPointer MCBuilder<SDE>::get_pricer()
+MCBuilder<SDE>::PricerPointer MCBuilder<SDE>::get_contract(unsigned short choice, double strike, std::string& label) const
 {
-    enum class PricerChoice
-    {
-        European = 1,
-        Asian, 
-        Barrier
-    };
-
-    std::cout << "Create Pricer:\n";
-    std::cout << "Choose an option pricer: 1. European, 2. Asian, 3. Barrier\n";
-    unsigned short choice;
-    std::cin >> choice;
-    PricerChoice pricerChoice = static_cast<PricerChoice>(choice);
-
-    auto callPayoff = [this](double a) { return std::max(a - m_data->K, 0.0); };
-    auto putPayoff = [this](double a) { return std::max(m_data->K - a, 0.0); };
-    auto discounter = [this]() { return std::exp(-m_data->r * m_data->T); };
-    PricerPointer p = nullptr;
+    auto discounter = [data = m_data]() { return std::exp(-data->r * data->T); };
+    auto number = [](double x)
+        {
+            std::ostringstream os;
+            os << x;
+            return os.str();
+        };
+    std::string K = " K = " + number(strike);
 
-    switch (pricerChoice)
+    switch (static_cast<PricerChoice>(choice))
     {
     case PricerChoice::European:
-        p = std::make_shared<EuropeanPricer>(callPayoff, putPayoff, discounter, 0);
-        break;
+        label = "European" + K;
+        return std::make_shared<EuropeanPricer>(strike, discounter, 0);
 
     case PricerChoice::Asian:
-        p = std::make_shared<AsianPricer>(callPayoff, putPayoff, discounter, 0);
-        break;
+        label = "Asian" + K;
+        return std::make_shared<AsianPricer>(strike, discounter, 0);
 
     case PricerChoice::Barrier:
         {
@@ -254,25 +357,155 @@ MCBuilder<SDE>::PricerPointer MCBuilder<SDE>::get_pricer()
             std::cin >> barrierAmount;
             BarrierPricer::BarrierType barrierType = static_cast<BarrierPricer::BarrierType>(bchoice);
 
-            p = std::make_shared<BarrierPricer>(callPayoff, putPayoff, discounter, 0);
-            auto barrier = std::dynamic_pointer_cast<BarrierPricer>(p);
+            auto barrier = std::make_shared<BarrierPricer>(strike, discounter, 0);
             barrier->set_barrier_type(barrierType);
             barrier->set_barrier_amount(barrierAmount);
-            break;
+            const char* types[] = { "Up-and-In", "Up-and-Out", "Down-and-In", "Down-and-Out" };
+            label = std::string("Barrier ") + (bchoice >= 1 && bchoice <= 4 ? types[bchoice - 1] : "?") + " " + number(barrierAmount) + K;
+            return barrier;
         }
 
     default:
         throw std::invalid_argument("Invalid option type. Make sure you enter a valid number.");
     }
+}
+
+template <typename SDE>
+MCBuilder<SDE>::PricerPointer MCBuilder<SDE>::get_pricer(const FDMAbstract<SDE>& fdm)
+{
+    std::size_t NT = fdm.get_NT();
+    std::cout << "Create Pricer:\n";
+    std::cout << "Choose an option pricer: 1. European, 2. Asian, 3. Barrier, 4. Portfolio, 5. Strike grid\n";
+    unsigned short choice;
+    std::cin >> choice;
+
+    // Contracts to price: the pricer itself, or the contracts of the portfolio
+    struct Contract
+    {
+        unsigned short choice;
+        double strike;
+        PricerPointer pricer;
+    };
+    std::vector<Contract> contracts;
+    PricerPointer p = nullptr;
+    std::string label;
+
+    if (static_cast<PricerChoice>(choice) == PricerChoice::Portfolio)
+    { // All the contracts are priced off the same paths
+        auto portfolio = std::make_shared<PortfolioPricer>([data = m_data]() { return std::exp(-data->r * data->T); }, 0);
+        std::size_t nContracts;
+        std::cout << "Number of contracts:\n";
+        std::cin >> nContracts;
+
+        for (std::size_t i = 0; i < nContracts; ++i)
+        {
+            unsigned short cchoice;
+            double strike;
+            std::cout << "Contract " << i + 1 << ": 1. European, 2. Asian, 3. Barrier\n";
+            std::cin >> cchoice;
+            std::cout << "Enter the strike:\n";
+            std::cin >> strike;
+            if (static_cast<PricerChoice>(cchoice) == PricerChoice::Portfolio)
+                throw std::invalid_argument("Invalid option type. Make sure you enter a valid number.");
+
+            PricerPointer contract = get_contract(cchoice, strike, label);
+            portfolio->add_contract(contract, label);
+            contracts.push_back({ cchoice, strike, contract });
+        }
+        p = portfolio;
+    }
+    else if (static_cast<PricerChoice>(choice) == PricerChoice::StrikeGrid)
+    { // Evenly spaced strikes, no control variates nor Greeks
+        unsigned short gchoice;
+        std::size_t nStrikes;
+        double lowest, highest;
+        std::cout << "Choose the underlying of the grid: 1. Terminal value (European), 2. Average (Asian)\n";
+        std::cin >> gchoice;
+        std::cout << "Enter the number of strikes, the lowest and the highest strike:\n";
+        std::cin >> nStrikes >> lowest >> highest;
+        if (nStrikes == 0 || highest < lowest)
+            throw std::invalid_argument("Invalid strike grid.");
+
+        std::vector<double> strikes(nStrikes, lowest);
+        for (std::size_t k = 1; k < nStrikes; ++k)
+            strikes[k] = lowest + (highest - lowest) * k / (nStrikes - 1);
+        p = std::make_shared<StrikeGridPricer>(strikes, static_cast<StrikeGridPricer::Underlying>(gchoice), [data = m_data]() { return std::exp(-data->r * data->T); }, 0);
+    }
+    else
+    {
+        p = get_contract(choice, m_data->K, label);
+        contracts.push_back({ choice, m_data->K, p });
+    }
+
+    if constexpr (std::is_same_v<SDE, GBM>)
+    { // The closed-form benchmarks only hold under GBM
+        unsigned short cchoice;
+        std::cout << "Use control variates? 1. No, 2. Yes\n";
+        std::cin >> cchoice;
 
-    m_path = [p](const std::vector<double>& path)
+        for (const Contract& contract : contracts)
+        {
+            if (cchoice != 2)
+                break;
+
+            OptionData od = *m_data;
+            od.K = contract.strike;
+            if (static_cast<PricerChoice>(contract.choice) == PricerChoice::Asian)
+            { // Closed-form geometric Asian for the arithmetic average
+                contract.pricer->add_control({ ControlVariate::Kind::GeometricAverage, od.K, ClosedForm::geometric_asian_call(od, NT), ClosedForm::geometric_asian_put(od, NT) });
+            }
+            else
+            { // Black-Scholes for the vanilla payoffs on S_T
+                contract.pricer->add_control({ ControlVariate::Kind::VanillaTerminal, od.K, ClosedForm::black_scholes_call(od), ClosedForm::black_scholes_put(od) });
+            }
+            // Discounted S_T is a martingale
+            contract.pricer->add_control({ ControlVariate::Kind::Terminal, 0.0, ClosedForm::discounted_terminal(od), ClosedForm::discounted_terminal(od) });
+        }
+
+        // The Greeks are rebuilt from the steps of the scheme: Milstein and the predictor-corrector have no closed-form step density
+        bool euler = dynamic_cast<const EulerFDM<SDE>*>(&fdm) != nullptr;
+        bool exact = dynamic_cast<const ExactFDM<SDE>*>(&fdm) != nullptr || dynamic_cast<const LogEulerFDM<SDE>*>(&fdm) != nullptr;
+        unsigned short gchoice = 1;
+        if (euler || exact)
+        {
+            std::cout << "Compute Greeks? 1. No, 2. Yes\n";
+            std::cin >> gchoice;
+        }
+
+        for (const Contract& contract : contracts)
+        {
+            if (gchoice != 2)
+                break;
+
+            const OptionData& od = *m_data;
+            contract.pricer->set_greeks({ od.S0, od.vol, od.r, od.q, od.T, exact ? GreekScheme::Exact : GreekScheme::Euler });
+        }
+    }
+
+    m_prepare = [p](std::size_t nSlots)
+        {
+            p->prepare(nSlots);
+        };
+    m_path = [p](const std::vector<double>& path, std::size_t slot)
+        {
+            p->process_path(path, slot);
+        };
+    m_block = [p](const PathBlock& block, std::size_t slot)
         {
-            p->process_path(path);
+            p->process_block(block, slot);
         };
     m_finish = [p](double duration)
         {
             p->post_process(duration);
         };
+    m_merge = [p](std::size_t slot)
+        {
+            return p->merge_slot(slot);
+        };
+    m_truncate = [p](std::size_t nSlots)
+        {
+            p->truncate(nSlots);
+        };
     
     return p;
 }
@@ -282,7 +515,7 @@ MCBuilder<SDE>::PricerPointer MCBuilder<SDE>::get_pricer()
 // Default builder with Euler FDM, MersenneTwister RNG, and European option
 template <typename SDE>
 MCDefaultBuilder<SDE>::MCDefaultBuilder(const std::shared_ptr<OptionData>& optionData)
-    : m_data{ optionData }, m_path{ nullptr }, m_finish{ nullptr }
+    : m_data{ optionData }, m_prepare{ nullptr }, m_path{ nullptr }, m_block{ nullptr }, m_finish{ nullptr }, m_merge{ nullptr }, m_truncate{ nullptr }
 {}
 
 template <typename SDE>
@@ -296,12 +529,24 @@ MCDefaultBuilder<SDE>::PartsTuple MCDefaultBuilder<SDE>::parts()
     return std::make_tuple(std::move(sde), std::move(fdm), std::move(rng));
 }
 
+template <typename SDE>
+MCDefaultBuilder<SDE>::Prepare MCDefaultBuilder<SDE>::get_prepare() const
+{
+    return m_prepare;
+}
+
 template <typename SDE>
 MCDefaultBuilder<SDE>::OptionPath MCDefaultBuilder<SDE>::get_path() const
 {
     return m_path;
 }
 
+template <typename SDE>
+MCDefaultBuilder<SDE>::OptionBlock MCDefaultBuilder<SDE>::get_block() const
+{
+    return m_block;
+}
+
 template <typename SDE>
 MCDefaultBuilder<SDE>::Finish MCDefaultBuilder<SDE>::get_finish() const
 {
@@ -309,6 +554,18 @@ MCDefaultBuilder<SDE>::Finish MCDefaultBuilder<SDE>::get_finish() const
     return m_finish;
 }
 
+template <typename SDE>
+MCDefaultBuilder<SDE>::MergeSlot MCDefaultBuilder<SDE>::get_merge() const
+{
+    return m_merge;
+}
+
+template <typename SDE>
+MCDefaultBuilder<SDE>::Truncate MCDefaultBuilder<SDE>::get_truncate() const
+{
+    return m_truncate;
+}
+
 template <typename SDE>
 SDEBase<SDE> MCDefaultBuilder<SDE>::get_SDE() const
 {
@@ -337,18 +594,32 @@ MCDefaultBuilder<SDE>::RNGPointer MCDefaultBuilder<SDE>::get_RNG() const
 template <typename SDE>
 MCDefaultBuilder<SDE>::PricerPointer MCDefaultBuilder<SDE>::get_pricer()
 {
-    auto callPayoff = [this](double a) { return std::max(a - m_data->K, 0.0); };
-    auto putPayoff = [this](double a) { return std::max(m_data->K - a, 0.0); };
     auto discounter = [this]() { return std::exp(-m_data->r * m_data->T); };
 
-    PricerPointer p = std::make_shared<EuropeanPricer>(callPayoff, putPayoff, discounter, 0);
-    m_path = [p](const std::vector<double>& path)
+    PricerPointer p = std::make_shared<EuropeanPricer>(m_data->K, discounter, 0);
+    m_prepare = [p](std::size_t nSlots)
+        {
+            p->prepare(nSlots);
+        };
+    m_path = [p](const std::vector<double>& path, std::size_t slot)
+        {
+            p->process_path(path, slot);
+        };
+    m_block = [p](const PathBlock& block, std::size_t slot)
         {
-            p->process_path(path);
+            p->process_block(block, slot);
         };
     m_finish = [p](double duration)
         {
             p->post_process(duration);
         };
+    m_merge = [p](std::size_t slot)
+        {
+            return p->merge_slot(slot);
+        };
+    m_truncate = [p](std::size_t nSlots)
+        {
+            p->truncate(nSlots);
+        };
     return p;
 }
@@ -0,0 +1,97 @@
+// MCDispatch.hpp
+// 
+// Thin runtime dispatch layer over a fixed set of MCEngine instantiations.
+// The parts chosen at runtime (e.g. through MCBuilder) are matched against the concrete
+// schemes, RNGs and pricers, and the engine compiled for that combination is run: every call
+// of the inner loop is then resolved at compile time. If any part is not in the lists, the
+// run falls back to the single engine instantiated with the abstract base classes.
+// The exact scheme is only listed for GBM, the only model it simulates.
+// 
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <type_traits>
+
+#include "MCEngine.hpp"
+#include "FDMAbstract.hpp"
+#include "FDMDerived.hpp"
+#include "PricerAbstract.hpp"
+#include "PricerDerived.hpp"
+#include "RNGAbstract.hpp"
+#include "RNGDerived.hpp"
+#include "SDEConcrete.hpp"
+
+template <typename... Types>
+struct TypeList
+{};
+
+// Calls f with base downcast to the first matching type of the list.
+// Returns false if no type matches, or what f returns when it reports a match itself
+template <typename Base, typename F, typename First, typename... Rest>
+bool dispatch_as(Base& base, F&& f, TypeList<First, Rest...>)
+{
+    using Target = std::conditional_t<std::is_const_v<Base>, const First, First>;
+
+    if (Target* derived = dynamic_cast<Target*>(&base))
+    {
+        if constexpr (std::is_void_v<decltype(f(*derived))>)
+        {
+            f(*derived);
+            return true;
+        }
+        else
+            return f(*derived);
+    }
+    return dispatch_as(base, std::forward<F>(f), TypeList<Rest...>{});
+}
+
+template <typename Base, typename F>
+bool dispatch_as(Base&, F&&, TypeList<>)
+{
+    return false;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer, typename Configure>
+void run_engine(const SDEBase<SDE>& sde, const Scheme& scheme, const RNG& generator, Pricer& optionPricer,
+    std::size_t numberSimulations, Configure& configure)
+{
+    MCEngine<SDE, Scheme, RNG, Pricer> engine(sde, scheme, generator, optionPricer, numberSimulations);
+    configure(engine); // Chunk size, threads, block mode...
+    engine.start();
+}
+
+template <typename SDE, typename Configure>
+void run_dispatched(const SDEBase<SDE>& sde, const FDMAbstract<SDE>& fdm, const RNGAbstract& rng, PricerAbstract& pricer, 
+    std::size_t numberSimulations, Configure&& configure)
+{
+    using Schemes = std::conditional_t<std::is_same_v<SDE, GBM>,
+        TypeList<EulerFDM<SDE>, MilsteinFDM<SDE>, PredictorCorrectorFDM<SDE>, LogEulerFDM<SDE>, ExactFDM<SDE>>,
+        TypeList<EulerFDM<SDE>, MilsteinFDM<SDE>, PredictorCorrectorFDM<SDE>, LogEulerFDM<SDE>>>;
+    using RNGs = TypeList<MersenneTwister, PolarMarsagliaNet, BoxMuller, Philox, Sobol>;
+    using Pricers = TypeList<EuropeanPricer, AsianPricer, BarrierPricer, PortfolioPricer, StrikeGridPricer>;
+
+    // Only the concrete combinations are instantiated: a part missing from a list sends the
+    // whole run to the abstract engine instead of one engine per partial match
+    const bool matched = dispatch_as(fdm, [&](const auto& scheme)
+        {
+            return dispatch_as(rng, [&](const auto& generator)
+                {
+                    return dispatch_as(pricer, [&](auto& optionPricer)
+                        {
+                            run_engine(sde, scheme, generator, optionPricer, numberSimulations, configure);
+                        }, Pricers{});
+                }, RNGs{});
+        }, Schemes{});
+
+    if (!matched)
+        run_engine(sde, fdm, rng, pricer, numberSimulations, configure);
+}
+
+template <typename SDE>
+void run_dispatched(const SDEBase<SDE>& sde, const FDMAbstract<SDE>& fdm, const RNGAbstract& rng, PricerAbstract& pricer,
+    std::size_t numberSimulations)
+{
+    run_dispatched(sde, fdm, rng, pricer, numberSimulations, [](auto&) {});
+}
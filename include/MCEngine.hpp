@@ -0,0 +1,967 @@
+// MCEngine.hpp
+// 
+// Simulation engine shared by the mediator and the statically dispatched pipeline.
+// The scheme, the RNG and the pricer are template parameters: with the abstract base classes
+// every call is virtual, with the concrete (final) classes the whole inner loop can be inlined.
+// The simulations are split into chunks that are distributed to a set of worker threads,
+// each worker owning its own preallocated buffers. The chunk index is passed to the
+// pricers as the accumulation slot, so results do not depend on the number of threads.
+// Pricers that only need some statistics of the paths (see PathStatistics.hpp) get them
+// updated while the engine steps, and the paths themselves are never stored.
+// In antithetic mode every set of draws also drives the mirrored path (-Z): both are advanced in
+// the same block and handed to the pricers as a pair, which counts as a single sample.
+// In adaptive mode the number of simulations is a cap: finished chunks are merged in chunk order
+// and the run stops at the first prefix of chunks whose standard error meets the target, so the
+// result still does not depend on the number of threads. It needs pseudo-random draws: the standard
+// error of low-discrepancy points is not the i.i.d. one, so it is neither a stopping rule nor reported as such.
+// Progress is counted per worker without any lock and reported by a separate thread (see ProgressReporter.hpp).
+// Schemes that step log S (see ILogSpaceScheme) advance blocks in log space, with a single FMA per step,
+// and the spot values are only computed where the pricers need them.
+// In pipeline mode dedicated generator threads draw the normals ahead of the workers and hand them over
+// through lock-free rings (see RNGPipeline.hpp). The generators pick the chunks and draw exactly what the
+// workers would have drawn, so the results are the same as in the inline mode.
+// An exception thrown by a worker (e.g. a pricer rejecting the blocks it is sent) stops the run and is
+// rethrown by start() once every thread has joined.
+// Built with MC_INSTRUMENTATION=1 the hot path records the time and calls of every stage per thread
+// (see Instrumentation.hpp), and the profile is dumped at the end of start().
+// 
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "StopWatch.hpp"
+#include "BrownianBridge.hpp"
+#include "PathBlock.hpp"
+#include "PathStatistics.hpp"
+#include "SDEBase.hpp"
+#include "FDMAbstract.hpp"
+#include "SIMDMath.hpp"
+#include "Instrumentation.hpp"
+#include "ProgressReporter.hpp"
+#include "RNGAbstract.hpp"
+#include "RNGDerived.hpp"
+#include "RNGPipeline.hpp"
+
+// Interface contract of the object receiving the paths
+
+template<typename Pricer>
+concept IPathPricer = requires (Pricer p, const std::vector<double>& path, const PathBlock& block, const PathStatistics& stats, std::size_t n, double d)
+{
+    p.prepare(n);
+    p.process_path(path, n);
+    p.process_block(block, n);
+    p.process_statistics(stats, n);
+    { p.required_statistics() } -> std::convertible_to<unsigned>;
+    { p.merge_slot(n) } -> std::convertible_to<double>;
+    p.truncate(n);
+    p.post_process(d);
+};
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+class MCEngine
+{
+public:
+    using ProgressCallback = ProgressReporter::Callback;
+    using Ring = SPSCRing<NormalTile>;
+
+public:
+    MCEngine(const SDEBase<SDE>& sde, const Scheme& scheme, const RNG& rng, Pricer& pricer, std::size_t numberSimulations);
+
+    void start();
+
+    void set_chunk_size(std::size_t chunkSize);     // Number of paths handed to a worker at once
+    void set_thread_count(std::size_t nThreads);    // Number of worker threads (0 = hardware concurrency)
+    void set_brownian_bridge(bool bridge);          // Build the paths with a Brownian bridge (default for QMC)
+    void set_block_size(std::size_t blockSize);     // Advance blockSize paths at once (0 = one path at a time)
+    void set_streaming(bool streaming);             // Stream path statistics to the pricers that support it (default)
+    void set_antithetic(bool antithetic);           // Pair every path with its mirrored path (NSim paths = NSim / 2 pairs)
+    void set_target_error(double standardError, std::size_t maxSimulations); // Stop once the standard error is met (0 = fixed run)
+    void set_target_width(double width, double confidence, std::size_t maxSimulations); // Same, for a confidence interval width
+    void set_progress(bool progress);               // Print the progress on the console while running (default)
+    void set_progress_callback(const ProgressCallback& callback, ProgressReporter::Interval interval = ProgressReporter::Interval{ 200 }); // Called every interval (nullptr = no report)
+    void set_profile_output(std::ostream* out);     // Instrumented builds: stage profile dump after each run (nullptr = none)
+    void set_pipeline(std::size_t nGenerators);     // Threads drawing the normals ahead of the workers (0 = inline draws)
+    const PipelineStats& get_pipeline_stats() const; // Starvation and stall counts of the last pipelined run
+    const profiling::StageProfile& get_profile() const; // Stage profile of the last run (empty unless instrumented)
+    std::size_t get_simulation_count() const;       // Simulations of the last run (samples used by the pricer)
+    std::size_t get_chunk_size() const;
+    std::size_t get_thread_count() const;
+
+private:
+    static constexpr std::size_t StreamTile = 64; // Time steps of normals drawn at once when streaming blocks
+    static constexpr std::size_t MinAdaptiveChunks = 2; // Chunks merged before the standard error is trusted
+    static constexpr std::size_t PipelineDepth = 8; // Tiles of normals per ring
+
+    struct Buffers
+    { // Preallocated buffers owned by a worker
+        std::vector<double> path;           // Single path (NT + 1)
+        std::vector<double> normals;        // Normals of a single path (NT)
+        std::vector<double> draws;          // Raw draws fed to the Brownian bridge (NT)
+        std::vector<double> block;          // Block of paths, structure of arrays ((NT + 1) x blockSize)
+        std::vector<double> blockNormals;   // Normals of the block, structure of arrays (NT or tile x blockSize)
+        std::vector<double> rows;           // Current and next level when streaming, then the spot values (log-space schemes) or their logarithms (3 x blockSize)
+        std::vector<double> stats;          // Running statistics when streaming (4 x blockSize)
+        profiling::ThreadCounters* counters;    // Stage counters of the worker
+        std::size_t worker;                     // Index of the worker (progress counter)
+        Ring* ring;                             // Normals drawn by a generator thread (pipeline mode), nullptr otherwise
+        std::size_t waits;                      // Pipeline mode: waits on the ring
+    };
+
+    void worker(std::size_t index);                 // Pulls chunks until all the simulations are done
+    void run_chunk(std::size_t chunk, Buffers& buffers);
+    void run_chunk_blocks(std::size_t chunk, Buffers& buffers);
+    void stream_chunk(std::size_t chunk, Buffers& buffers);
+    void stream_chunk_blocks(std::size_t chunk, Buffers& buffers);
+    void generator(std::stop_token token, std::size_t index, std::size_t nGenerators); // Fills the rings of workers index, index + nGenerators, ...
+    void draw_normals(std::size_t i, Buffers& buffers); // Normals of path i into buffers.normals
+    void draw_tile(std::size_t b, std::size_t nDraws, std::size_t j0, std::size_t nSteps, Buffers& buffers, double* tile); // See next_normals
+    const double* next_normals(std::size_t b, std::size_t nDraws, std::size_t j0, std::size_t nSteps, Buffers& buffers); // Normals of draws [b, b + nDraws), steps [j0, j0 + nSteps)
+    void release_normals(Buffers& buffers);     // The tile returned by next_normals is no longer used
+    void generate_chunk(std::size_t chunk, Ring& ring, Buffers& buffers, std::stop_token token);
+    void complete_chunk(std::size_t chunk, profiling::ThreadCounters* counters); // Adaptive runs: merges the finished prefix, checks the target
+    void report_progress(std::size_t n, const Buffers& buffers); // n more simulations done by the worker
+    void store_normals(const Buffers& buffers, double* blockNormals, std::size_t p, std::size_t nDraws, std::size_t nSteps) const;
+    std::size_t group_size() const;                 // Draws per block (pairs in antithetic mode)
+    std::size_t tile_steps() const;                 // Time steps of the normals drawn at once
+    std::size_t block_width() const;                // Paths per block (stride of the structure of arrays)
+
+private:
+    // Main components
+    SDEBase<SDE> m_sde;
+    const Scheme& m_fdm;
+    const RNG& m_rng;
+    Pricer& m_pricer;
+    // Other MC-related data 
+    std::size_t m_NSim;                 // Number of simulations
+    std::size_t m_nSamples;             // Number of independent samples for the current run (pairs in antithetic mode)
+    std::size_t m_chunkSize;            // Number of simulations per chunk
+    std::size_t m_nThreads;             // Number of worker threads
+    std::size_t m_nChunks;              // Number of chunks for the current run
+    std::atomic_size_t m_nextChunk;     // Next chunk to be picked up by a worker
+    double m_targetError;               // Target standard error (0 = run every simulation)
+    std::vector<char> m_chunkDone;      // Finished chunks (adaptive runs)
+    std::size_t m_mergedChunks;         // Length of the finished prefix merged into the running estimate
+    std::atomic_bool m_stop;            // Set once the target is met
+    std::vector<double> m_mesh;         // Cached mesh of the FDM
+    double m_dt;                        // Cached mesh size of the FDM
+    std::optional<BrownianBridge> m_bridge; // Brownian bridge used to build the increments, if any
+    std::size_t m_blockSize;            // Number of paths advanced together in block mode (0 = scalar)
+    bool m_streaming;                   // Whether statistics may be streamed instead of paths
+    bool m_antithetic;                  // Whether every path is paired with its mirrored path
+    unsigned m_statistics;              // Statistics required by the pricer for the current run
+    ProgressCallback m_progress;        // Receives the progress of the run (nullptr = no report)
+    ProgressReporter::Interval m_progressInterval; // Time between two reports
+    ProgressReporter* m_reporter;       // Reporter of the current run, if any
+    profiling::StageProfile m_profile;  // Per-thread stage counters (instrumented builds)
+    std::ostream* m_profileOutput;      // Where the profile is dumped after a run
+    std::size_t m_nGenerators;          // Generator threads in pipeline mode (0 = the workers draw their normals)
+    std::vector<std::unique_ptr<Ring>> m_rings; // One ring per worker for the current run (pipeline mode)
+    std::vector<std::size_t> m_waits;   // Waits of the workers, then of the generators, on the rings
+    PipelineStats m_pipelineStats;      // Balance of the last pipelined run
+    std::mutex m_mergeMutex;            // Guards the running estimate (adaptive runs) and m_error
+    std::exception_ptr m_error;         // First exception thrown by a worker of the current run
+};
+
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+MCEngine<SDE, Scheme, RNG, Pricer>::MCEngine(const SDEBase<SDE>& sde, const Scheme& scheme, const RNG& rng, Pricer& pricer, std::size_t numberSimulations)
+    : m_sde(sde), m_fdm(scheme), m_rng(rng), m_pricer(pricer), m_NSim(numberSimulations), m_nSamples{},
+    m_chunkSize{ 1024 }, m_nThreads{ std::max<std::size_t>(1, std::thread::hardware_concurrency()) }, m_nChunks{}, m_nextChunk{},
+    m_targetError{}, m_mergedChunks{}, m_stop{ false },
+    m_mesh(m_fdm.get_mesh()), m_dt{ m_fdm.get_meshSize() }, m_blockSize{}, m_streaming{ true }, m_antithetic{ false }, m_statistics{ PathStatistic::FullPath },
+    m_progressInterval{ 200 }, m_reporter{ nullptr }, m_profileOutput{ &std::cout }, m_nGenerators{}
+{
+    set_brownian_bridge(m_rng.low_discrepancy());
+    set_progress(true);
+    if constexpr (requires { m_pricer.set_quasi_random(true); })
+        m_pricer.set_quasi_random(m_rng.low_discrepancy());
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_chunk_size(std::size_t chunkSize)
+{
+    if (chunkSize < 1)
+        throw std::invalid_argument("Chunk size must be a strictly positive integer.");
+
+    m_chunkSize = chunkSize;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_thread_count(std::size_t nThreads)
+{
+    m_nThreads = nThreads == 0 ? std::max<std::size_t>(1, std::thread::hardware_concurrency()) : nThreads;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_brownian_bridge(bool bridge)
+{
+    if (bridge)
+        m_bridge.emplace(m_fdm.get_NT());
+    else
+        m_bridge.reset();
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_block_size(std::size_t blockSize)
+{
+    m_blockSize = blockSize;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_streaming(bool streaming)
+{
+    m_streaming = streaming;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_antithetic(bool antithetic)
+{
+    m_antithetic = antithetic;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_target_error(double standardError, std::size_t maxSimulations)
+{
+    if (standardError < 0.0)
+        throw std::invalid_argument("Target standard error must be positive (0 = fixed run).");
+    if (maxSimulations < 1)
+        throw std::invalid_argument("Maximum number of simulations must be a strictly positive integer.");
+    // The stopping rule relies on the i.i.d. standard error, which quasi-random points do not have
+    if (standardError > 0.0 && m_rng.low_discrepancy())
+        throw std::invalid_argument("Adaptive runs need a pseudo-random generator, not a low-discrepancy sequence.");
+
+    m_targetError = standardError;
+    m_NSim = maxSimulations;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_target_width(double width, double confidence, std::size_t maxSimulations)
+{
+    if (confidence <= 0.0 || confidence >= 1.0)
+        throw std::invalid_argument("Confidence level must be in (0, 1).");
+
+    // Two-sided interval: width = 2 z standard error
+    double z = inverse_normal_cdf(0.5 + 0.5 * confidence);
+    set_target_error(width / (2.0 * z), maxSimulations);
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_progress(bool progress)
+{
+    m_progress = progress ? ProgressReporter::console() : nullptr;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_progress_callback(const ProgressCallback& callback, ProgressReporter::Interval interval)
+{
+    m_progress = callback;
+    m_progressInterval = interval;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_profile_output(std::ostream* out)
+{
+    m_profileOutput = out;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::set_pipeline(std::size_t nGenerators)
+{
+    m_nGenerators = nGenerators;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+const PipelineStats& MCEngine<SDE, Scheme, RNG, Pricer>::get_pipeline_stats() const
+{
+    return m_pipelineStats;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+const profiling::StageProfile& MCEngine<SDE, Scheme, RNG, Pricer>::get_profile() const
+{
+    return m_profile;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+std::size_t MCEngine<SDE, Scheme, RNG, Pricer>::get_simulation_count() const
+{
+    std::size_t nChunks = m_targetError > 0.0 ? m_mergedChunks : m_nChunks;
+    return std::min(nChunks * m_chunkSize, m_nSamples);
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+std::size_t MCEngine<SDE, Scheme, RNG, Pricer>::get_chunk_size() const
+{
+    return m_chunkSize;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+std::size_t MCEngine<SDE, Scheme, RNG, Pricer>::get_thread_count() const
+{
+    return m_nThreads;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::start()
+{
+    StopWatch sw;
+
+    sw.Start();
+
+    // A pair of antithetic paths costs a single set of draws: chunks are made of samples
+    m_nSamples = m_antithetic ? (m_NSim + 1) / 2 : m_NSim;
+    m_nChunks = (m_nSamples + m_chunkSize - 1) / m_chunkSize;
+    m_nextChunk.store(0, std::memory_order_relaxed);
+    m_stop.store(false, std::memory_order_relaxed);
+    m_mergedChunks = 0;
+    m_error = nullptr;
+    m_chunkDone.assign(m_targetError > 0.0 ? m_nChunks : 0, 0);
+
+    // Pricers keep one accumulator per chunk, merged in chunk order once the run is over
+    m_pricer.prepare(m_nChunks);
+    m_statistics = m_streaming ? m_pricer.required_statistics() : static_cast<unsigned>(PathStatistic::FullPath);
+
+    // No point in spawning more workers than there are chunks, nor more generators than workers
+    std::size_t nWorkers = std::min(m_nThreads, m_nChunks);
+    std::size_t nGenerators = std::min(m_nGenerators, nWorkers);
+
+    // One set of counters per worker, then per generator, the last one for the calling thread
+    if constexpr (profiling::Enabled)
+    {
+        m_profile.reset(std::max<std::size_t>(nWorkers, 1) + nGenerators + 1);
+        m_profile.begin();
+    }
+
+    // One ring per worker, each fed by a single generator
+    m_rings.clear();
+    m_waits.assign(std::max<std::size_t>(nWorkers, 1) + nGenerators, 0);
+    if (nGenerators > 0)
+    {
+        NormalTile prototype{ 0, std::vector<double>(std::max<std::size_t>(block_width(), 1) * tile_steps()) };
+        for (std::size_t w = 0; w < nWorkers; ++w)
+            m_rings.push_back(std::make_unique<Ring>(PipelineDepth, prototype));
+    }
+
+    // Samples the per-worker counters while the workers run
+    std::optional<ProgressReporter> reporter;
+    if (m_progress)
+        reporter.emplace(m_nSamples, std::max<std::size_t>(nWorkers, 1), m_progressInterval, m_progress);
+    m_reporter = reporter ? &*reporter : nullptr;
+
+    {
+        std::vector<std::jthread> generators;
+        for (std::size_t g = 0; g < nGenerators; ++g)
+            generators.emplace_back([this, g, nGenerators](std::stop_token token) { generator(token, g, nGenerators); });
+
+        if (nWorkers <= 1)
+        {
+            worker(0);
+        }
+        else
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(nWorkers);
+
+            for (std::size_t w = 0; w < nWorkers; ++w)
+            {
+                workers.emplace_back([this, w]() { worker(w); });
+            }
+            // jthreads join on destruction
+        }
+    }
+
+    if (m_error)
+    { // Every thread has joined, the run is abandoned
+        m_rings.clear();
+        m_reporter = nullptr;
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+
+    m_pipelineStats = PipelineStats{ nGenerators, nGenerators > 0 ? nWorkers : 0 };
+    if (nGenerators > 0)
+    {
+        std::size_t tilesPerGroup = (m_fdm.get_NT() + tile_steps() - 1) / tile_steps();
+        std::size_t group = std::max<std::size_t>(group_size(), 1);
+        for (std::size_t chunk = 0; chunk < m_nChunks; ++chunk)
+        { // Tiles of the chunks actually run (adaptive runs stop early)
+            std::size_t nSamples = std::min(m_chunkSize, m_nSamples - chunk * m_chunkSize);
+            m_pipelineStats.tiles += (chunk < m_nextChunk.load() ? tilesPerGroup * ((nSamples + group - 1) / group) : 0);
+        }
+        for (std::size_t w = 0; w < nWorkers + nGenerators; ++w)
+            (w < nWorkers ? m_pipelineStats.starved : m_pipelineStats.stalled) += m_waits[w];
+    }
+    m_rings.clear();
+
+    if (reporter)
+        reporter->stop(); // Last report before the results
+    m_reporter = nullptr;
+
+    {
+        profiling::StageTimer timer(profiling::Enabled ? m_profile.thread(m_profile.thread_count() - 1) : nullptr, profiling::Stage::Reduction);
+
+        // Chunks finished after the target was met are dropped, whichever thread ran them
+        if (m_stop.load())
+            m_pricer.truncate(m_mergedChunks);
+
+        sw.Stop();
+
+        // Inform pricer to finish, pass the duration of the process
+        m_pricer.post_process(sw.GetTime());
+    }
+
+    if constexpr (profiling::Enabled)
+    {
+        m_profile.end();
+        if (m_profileOutput)
+        {
+            m_profile.write_table(*m_profileOutput);
+            m_profile.write_json(*m_profileOutput);
+        }
+    }
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::worker(std::size_t index)
+{
+    // Buffers owned by the worker, allocated once and reused for every path
+    std::size_t NT = m_fdm.get_NT();
+    bool streaming = !(m_statistics & PathStatistic::FullPath);
+    bool blocks = m_blockSize > 0 || m_antithetic; // The two paths of a pair are always advanced together
+    std::size_t width = block_width();
+    Buffers buffers;
+    buffers.counters = profiling::Enabled ? m_profile.thread(index) : nullptr;
+    buffers.worker = index;
+    buffers.ring = m_rings.empty() ? nullptr : m_rings[index].get();
+    buffers.waits = 0;
+    buffers.normals.assign(NT, 0.0);
+    buffers.draws.assign(m_bridge ? NT : 0, 0.0);
+    buffers.blockNormals.assign(width * (streaming && !m_bridge ? std::min(NT, StreamTile) : NT), 0.0);
+    if (streaming)
+    { // O(blockSize) memory, whatever NT
+        buffers.rows.assign(3 * std::max<std::size_t>(width, 1), 0.0);
+        buffers.stats.assign(4 * std::max<std::size_t>(width, 1), 0.0);
+    }
+    else
+    {
+        buffers.path.assign(NT + 1, 0.0);
+        buffers.block.assign(width * (NT + 1), 0.0);
+        buffers.path[0] = m_sde.initial_condition();
+    }
+
+    auto next = [this, &buffers]()
+        {
+            if (buffers.ring)
+            { // The generator feeding the worker picks the chunks
+                std::size_t chunk = buffers.ring->front(buffers.waits)->chunk;
+                if (chunk >= m_nChunks)
+                    buffers.ring->pop(); // End of the run
+                return chunk;
+            }
+            return m_stop.load(std::memory_order_relaxed) ? m_nChunks : m_nextChunk.fetch_add(1, std::memory_order_relaxed);
+        };
+
+    std::uint64_t start = profiling::Enabled ? profiling::ticks() : 0;
+    try
+    {
+        for (std::size_t chunk = next(); chunk < m_nChunks; chunk = next())
+        {
+            if (streaming)
+                blocks ? stream_chunk_blocks(chunk, buffers) : stream_chunk(chunk, buffers);
+            else
+                blocks ? run_chunk_blocks(chunk, buffers) : run_chunk(chunk, buffers);
+
+            if (m_targetError > 0.0)
+                complete_chunk(chunk, buffers.counters);
+
+            if constexpr (profiling::Enabled)
+            {
+                ++buffers.counters->chunks;
+                buffers.counters->paths += std::min((chunk + 1) * m_chunkSize, m_nSamples) - chunk * m_chunkSize;
+            }
+        }
+    }
+    catch (...)
+    { // The other workers stop picking chunks, start() rethrows once they have joined
+        {
+            std::lock_guard<std::mutex> lock(m_mergeMutex);
+            if (!m_error)
+                m_error = std::current_exception();
+        }
+        m_stop.store(true, std::memory_order_relaxed);
+
+        if (buffers.ring)
+        { // Drains the ring up to the end of the run, so that its generator is not left blocked
+            while (buffers.ring->front(buffers.waits)->chunk < m_nChunks)
+                buffers.ring->pop();
+            buffers.ring->pop();
+        }
+    }
+    if constexpr (profiling::Enabled)
+        buffers.counters->busy += profiling::ticks() - start;
+    m_waits[index] = buffers.waits;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::generator(std::stop_token token, std::size_t index, std::size_t nGenerators)
+{
+    std::size_t NT = m_fdm.get_NT();
+    Buffers buffers;
+    buffers.counters = profiling::Enabled ? m_profile.thread(m_rings.size() + index) : nullptr;
+    buffers.worker = index;
+    buffers.ring = nullptr;
+    buffers.waits = 0;
+    buffers.normals.assign(NT, 0.0);
+    buffers.draws.assign(m_bridge ? NT : 0, 0.0);
+
+    std::vector<Ring*> rings;
+    for (std::size_t w = index; w < m_rings.size(); w += nGenerators)
+        rings.push_back(m_rings[w].get());
+
+    std::uint64_t start = profiling::Enabled ? profiling::ticks() : 0;
+    for (std::size_t chunk = m_nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < m_nChunks && !m_stop.load(std::memory_order_relaxed)
+        && !token.stop_requested(); chunk = m_nextChunk.fetch_add(1, std::memory_order_relaxed))
+    {
+        // The emptiest ring gets the chunk
+        Ring* ring = *std::min_element(rings.begin(), rings.end(), [](const Ring* a, const Ring* b) { return a->size() < b->size(); });
+        generate_chunk(chunk, *ring, buffers, token);
+    }
+
+    for (Ring* ring : rings)
+    { // End of the run
+        if (NormalTile* tile = ring->back(buffers.waits, token))
+        {
+            tile->chunk = m_nChunks;
+            ring->push();
+        }
+    }
+    if constexpr (profiling::Enabled)
+        buffers.counters->busy += profiling::ticks() - start;
+    m_waits[m_rings.size() + index] = buffers.waits;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::generate_chunk(std::size_t chunk, Ring& ring, Buffers& buffers, std::stop_token token)
+{
+    // Same tiles, in the same order, as the worker consumes them
+    std::size_t first = chunk * m_chunkSize;
+    std::size_t last = std::min(first + m_chunkSize, m_nSamples);
+    std::size_t NT = m_fdm.get_NT();
+    std::size_t group = std::max<std::size_t>(group_size(), 1);
+    std::size_t tile = tile_steps();
+
+    for (std::size_t b = first; b < last; b += group)
+    {
+        std::size_t nDraws = std::min(group, last - b);
+        for (std::size_t j0 = 0; j0 < NT; j0 += tile)
+        {
+            NormalTile* slot = ring.back(buffers.waits, token);
+            if (!slot)
+                return; // Run abandoned
+            slot->chunk = chunk;
+            draw_tile(b, nDraws, j0, std::min(tile, NT - j0), buffers, slot->normals.data());
+            ring.push();
+        }
+    }
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::complete_chunk(std::size_t chunk, profiling::ThreadCounters* counters)
+{
+    std::unique_lock<std::mutex> lock(m_mergeMutex, std::defer_lock);
+    {
+        profiling::StageTimer timer(counters, profiling::Stage::Sync);
+        lock.lock();
+    }
+    profiling::StageTimer timer(counters, profiling::Stage::Reduction);
+    m_chunkDone[chunk] = 1;
+
+    // Chunks are merged in chunk order: the stopping point is the same whatever the threads
+    while (!m_stop.load(std::memory_order_relaxed) && m_mergedChunks < m_nChunks && m_chunkDone[m_mergedChunks])
+    {
+        double error = m_pricer.merge_slot(m_mergedChunks++);
+        if (m_mergedChunks >= MinAdaptiveChunks && error <= m_targetError)
+            m_stop.store(true, std::memory_order_relaxed);
+    }
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::report_progress(std::size_t n, const Buffers& buffers)
+{
+    if (m_reporter)
+        m_reporter->add(buffers.worker, n);
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::draw_normals(std::size_t i, Buffers& buffers)
+{
+    profiling::StageTimer timer(buffers.counters, profiling::Stage::Random);
+    // All the normals of the path in a single call. Path i always reads stream i,
+    // whichever worker or chunk runs it (for the counter-based generators)
+    m_rng.seek(i);
+    if (m_bridge)
+    { // Leading draws fix the coarse shape of the path
+        m_rng.fill(buffers.draws);
+        m_bridge->transform(buffers.draws, buffers.normals);
+    }
+    else
+    {
+        m_rng.fill(buffers.normals);
+    }
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::draw_tile(std::size_t b, std::size_t nDraws, std::size_t j0, std::size_t nSteps, Buffers& buffers, double* tile)
+{
+    if (m_blockSize == 0 && !m_antithetic)
+    { // Single path: the normals as they are
+        draw_normals(b, buffers);
+        std::copy(buffers.normals.begin(), buffers.normals.end(), tile);
+        return;
+    }
+
+    // Same normals as in scalar mode, transposed into the structure of arrays
+    for (std::size_t p = 0; p < nDraws; ++p)
+    {
+        if (m_bridge)
+        { // The bridge needs every draw of the path (tile = NT)
+            draw_normals(b + p, buffers);
+        }
+        else
+        { // Steps [j0, j0 + nSteps) of stream b + p
+            profiling::StageTimer timer(buffers.counters, profiling::Stage::Random);
+            m_rng.seek(b + p, j0);
+            m_rng.fill({ buffers.normals.data(), nSteps });
+        }
+        store_normals(buffers, tile, p, nDraws, nSteps);
+    }
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+const double* MCEngine<SDE, Scheme, RNG, Pricer>::next_normals(std::size_t b, std::size_t nDraws, std::size_t j0, std::size_t nSteps, Buffers& buffers)
+{
+    // Structure of arrays (stride block_width()), or the normals of the path in scalar mode
+    if (buffers.ring)
+        return buffers.ring->front(buffers.waits)->normals.data();
+
+    if (m_blockSize == 0 && !m_antithetic)
+    {
+        draw_normals(b, buffers);
+        return buffers.normals.data();
+    }
+    draw_tile(b, nDraws, j0, nSteps, buffers, buffers.blockNormals.data());
+    return buffers.blockNormals.data();
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::release_normals(Buffers& buffers)
+{
+    if (buffers.ring)
+        buffers.ring->pop();
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::store_normals(const Buffers& buffers, double* blockNormals, std::size_t p, std::size_t nDraws, std::size_t nSteps) const
+{
+    // Column p of the structure of arrays, and column nDraws + p for the mirrored path
+    const std::size_t stride = block_width();
+    for (std::size_t j = 0; j < nSteps; ++j)
+        blockNormals[j * stride + p] = buffers.normals[j];
+    if (m_antithetic)
+        for (std::size_t j = 0; j < nSteps; ++j)
+            blockNormals[j * stride + nDraws + p] = -buffers.normals[j];
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+std::size_t MCEngine<SDE, Scheme, RNG, Pricer>::group_size() const
+{
+    return m_antithetic ? std::max<std::size_t>(m_blockSize, 1) : m_blockSize;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+std::size_t MCEngine<SDE, Scheme, RNG, Pricer>::tile_steps() const
+{
+    // Only the streamed blocks draw their normals a tile at a time (the bridge needs the whole path)
+    bool streaming = !(m_statistics & PathStatistic::FullPath);
+    bool blocks = m_blockSize > 0 || m_antithetic;
+    std::size_t NT = m_fdm.get_NT();
+    return streaming && blocks && !m_bridge ? std::min(NT, StreamTile) : NT;
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+std::size_t MCEngine<SDE, Scheme, RNG, Pricer>::block_width() const
+{
+    return m_antithetic ? 2 * group_size() : group_size();
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::run_chunk(std::size_t chunk, Buffers& buffers)
+{
+    std::size_t first = chunk * m_chunkSize;
+    std::size_t last = std::min(first + m_chunkSize, m_nSamples);
+    std::vector<double>& path = buffers.path;
+
+    for (std::size_t i = first; i < last; ++i)
+    { // Calculate a path at each iteration
+        report_progress(1, buffers);
+
+        const double* normals = next_normals(i, 1, 0, path.size() - 1, buffers);
+
+        {
+            profiling::StageTimer timer(buffers.counters, profiling::Stage::Advance);
+            for (std::size_t j = 1; j < path.size(); ++j)
+            {
+                // Compute the solution at level n+1 (the second increment is not used by the current schemes)
+                path[j] = m_fdm.advance(path[j - 1], m_mesh[j - 1], m_dt, normals[j - 1], 0.0);
+            }
+        }
+        release_normals(buffers);
+        // Send path data to the Pricers
+        profiling::StageTimer timer(buffers.counters, profiling::Stage::Pricer);
+        m_pricer.process_path(path, chunk);
+    }
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::run_chunk_blocks(std::size_t chunk, Buffers& buffers)
+{
+    std::size_t first = chunk * m_chunkSize;
+    std::size_t last = std::min(first + m_chunkSize, m_nSamples);
+    std::size_t NT = m_fdm.get_NT();
+    std::size_t group = group_size();
+    std::size_t stride = block_width();
+    double* block = buffers.block.data();
+
+    for (std::size_t b = first; b < last; b += group)
+    {
+        std::size_t nDraws = std::min(group, last - b);
+        std::size_t nPaths = m_antithetic ? 2 * nDraws : nDraws;
+        report_progress(nDraws, buffers);
+
+        const double* blockNormals = next_normals(b, nDraws, 0, NT, buffers);
+
+        {
+            profiling::StageTimer timer(buffers.counters, profiling::Stage::Advance);
+            if constexpr (ILogSpaceScheme<Scheme>)
+            { // Running sums of the log-increments, then the spot values of the whole block at once
+                std::fill(block, block + nPaths, std::log(m_sde.initial_condition()));
+                for (std::size_t j = 1; j <= NT; ++j)
+                {
+                    m_fdm.log_advance_block({ block + (j - 1) * stride, nPaths }, m_mesh[j - 1], m_dt,
+                        { blockNormals + (j - 1) * stride, nPaths }, { block + j * stride, nPaths });
+                }
+                for (std::size_t j = 1; j <= NT; ++j)
+                    simd::exp(block + j * stride, block + j * stride, nPaths);
+                std::fill(block, block + nPaths, m_sde.initial_condition());
+            }
+            else
+            {
+                std::fill(block, block + nPaths, m_sde.initial_condition());
+                for (std::size_t j = 1; j <= NT; ++j)
+                {
+                    // Advance every path of the block from level j-1 to level j
+                    m_fdm.advance_block({ block + (j - 1) * stride, nPaths }, m_mesh[j - 1], m_dt,
+                        { blockNormals + (j - 1) * stride, nPaths }, { block + j * stride, nPaths });
+                }
+            }
+        }
+        release_normals(buffers);
+
+        // Send the whole block to the Pricers
+        profiling::StageTimer timer(buffers.counters, profiling::Stage::Pricer);
+        m_pricer.process_block(PathBlock{ block, nPaths, stride, NT + 1, m_antithetic }, chunk);
+    }
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::stream_chunk(std::size_t chunk, Buffers& buffers)
+{
+    std::size_t first = chunk * m_chunkSize;
+    std::size_t last = std::min(first + m_chunkSize, m_nSamples);
+    const unsigned flags = m_statistics;
+    const std::size_t NT = m_fdm.get_NT();
+
+    for (std::size_t i = first; i < last; ++i)
+    {
+        report_progress(1, buffers);
+
+        const double* normals = next_normals(i, 1, 0, NT, buffers);
+
+        // The statistics include the initial point, as the stored path does
+        std::optional<profiling::StageTimer> timer(std::in_place, buffers.counters, profiling::Stage::Advance);
+        double x = m_sde.initial_condition();
+        double sum = x, logSum = (flags & PathStatistic::LogSum) ? std::log(x) : 0.0, min = x, max = x;
+
+        for (std::size_t j = 1; j <= NT; ++j)
+        {
+            x = m_fdm.advance(x, m_mesh[j - 1], m_dt, normals[j - 1], 0.0);
+
+            if (flags & PathStatistic::Sum)
+                sum += x;
+            if (flags & PathStatistic::LogSum)
+                logSum += std::log(x);
+            if (flags & PathStatistic::Min)
+                min = std::min(min, x);
+            if (flags & PathStatistic::Max)
+                max = std::max(max, x);
+        }
+        release_normals(buffers);
+
+        timer.emplace(buffers.counters, profiling::Stage::Pricer);
+        PathStatistics stats{ 1, NT + 1, &x, (flags & PathStatistic::Sum) ? &sum : nullptr, (flags & PathStatistic::LogSum) ? &logSum : nullptr,
+            (flags & PathStatistic::Min) ? &min : nullptr, (flags & PathStatistic::Max) ? &max : nullptr };
+        m_pricer.process_statistics(stats, chunk);
+    }
+}
+
+template <typename SDE, typename Scheme, typename RNG, typename Pricer>
+    requires std::derived_from<Scheme, FDMAbstract<SDE>> && std::derived_from<RNG, RNGAbstract> && IPathPricer<Pricer>
+void MCEngine<SDE, Scheme, RNG, Pricer>::stream_chunk_blocks(std::size_t chunk, Buffers& buffers)
+{
+    std::size_t first = chunk * m_chunkSize;
+    std::size_t last = std::min(first + m_chunkSize, m_nSamples);
+    const std::size_t NT = m_fdm.get_NT();
+    const std::size_t group = group_size();
+    const std::size_t stride = block_width();
+    const unsigned flags = m_statistics;
+    const std::size_t tile = tile_steps();
+    double* current = buffers.rows.data();
+    double* next = current + stride;
+    double* spot = next + stride;
+    double* sum = buffers.stats.data();
+    double* logSum = sum + stride;
+    double* min = logSum + stride;
+    double* max = min + stride;
+
+    for (std::size_t b = first; b < last; b += group)
+    {
+        std::size_t nDraws = std::min(group, last - b);
+        std::size_t nPaths = m_antithetic ? 2 * nDraws : nDraws;
+        report_progress(nDraws, buffers);
+
+        // Log-space schemes keep log S in current, next, min and max (the logarithm is monotone)
+        double S0 = m_sde.initial_condition();
+        double x0 = ILogSpaceScheme<Scheme> ? std::log(S0) : S0;
+        std::fill(current, current + nPaths, x0);
+        std::fill(sum, sum + nPaths, S0);
+        double logS0 = 0.0;
+        if (flags & PathStatistic::LogSum)
+            simd::log(&S0, &logS0, 1);  // As the pricers take the logarithms of the stored rows
+        std::fill(logSum, logSum + nPaths, logS0);
+        std::fill(min, min + nPaths, x0);
+        std::fill(max, max + nPaths, x0);
+
+        // The normals are drawn one tile of time steps at a time, so that they stay in cache too
+        for (std::size_t j0 = 0; j0 < NT; j0 += tile)
+        {
+            std::size_t nSteps = std::min(tile, NT - j0);
+            const double* blockNormals = next_normals(b, nDraws, j0, nSteps, buffers);
+
+            profiling::StageTimer timer(buffers.counters, profiling::Stage::Advance);
+            for (std::size_t j = j0 + 1; j <= j0 + nSteps; ++j)
+            {
+                // Only two levels are kept, the statistics are updated row by row
+                if constexpr (ILogSpaceScheme<Scheme>)
+                { // Spot values only for the arithmetic sum
+                    m_fdm.log_advance_block({ current, nPaths }, m_mesh[j - 1], m_dt, { blockNormals + (j - 1 - j0) * stride, nPaths }, { next, nPaths });
+                    if (flags & PathStatistic::Sum)
+                    {
+                        simd::exp(next, spot, nPaths);
+                        for (std::size_t p = 0; p < nPaths; ++p)
+                            sum[p] += spot[p];
+                    }
+                    if (flags & PathStatistic::LogSum)
+                        for (std::size_t p = 0; p < nPaths; ++p)
+                            logSum[p] += next[p];
+                }
+                else
+                {
+                    m_fdm.advance_block({ current, nPaths }, m_mesh[j - 1], m_dt, { blockNormals + (j - 1 - j0) * stride, nPaths }, { next, nPaths });
+                    if (flags & PathStatistic::Sum)
+                        for (std::size_t p = 0; p < nPaths; ++p)
+                            sum[p] += next[p];
+                    if (flags & PathStatistic::LogSum)
+                    {
+                        simd::log(next, spot, nPaths);
+                        for (std::size_t p = 0; p < nPaths; ++p)
+                            logSum[p] += spot[p];
+                    }
+                }
+                if (flags & PathStatistic::Min)
+                    for (std::size_t p = 0; p < nPaths; ++p)
+                        min[p] = std::min(min[p], next[p]);
+                if (flags & PathStatistic::Max)
+                    for (std::size_t p = 0; p < nPaths; ++p)
+                        max[p] = std::max(max[p], next[p]);
+
+                std::swap(current, next);
+            }
+            release_normals(buffers);
+        }
+
+        if constexpr (ILogSpaceScheme<Scheme>)
+        { // Back to spot values
+            profiling::StageTimer timer(buffers.counters, profiling::Stage::Advance);
+            simd::exp(current, current, nPaths);
+            if (flags & PathStatistic::Min)
+                simd::exp(min, min, nPaths);
+            if (flags & PathStatistic::Max)
+                simd::exp(max, max, nPaths);
+        }
+
+        profiling::StageTimer timer(buffers.counters, profiling::Stage::Pricer);
+        PathStatistics stats{ nPaths, NT + 1, current, (flags & PathStatistic::Sum) ? sum : nullptr, (flags & PathStatistic::LogSum) ? logSum : nullptr,
+            (flags & PathStatistic::Min) ? min : nullptr, (flags & PathStatistic::Max) ? max : nullptr, m_antithetic };
+        m_pricer.process_statistics(stats, chunk);
+    }
+}
@@ -1,6 +1,8 @@
 // Mediator.hpp
 // 
 // Mediator used to orchestrate the different part of the MC Simulator
+// The parts are owned through their abstract base classes and the pricer is reached through
+// callbacks, the simulation itself is run by MCEngine.
 // 
 // Pierre-Yves Sojic
 //
@@ -8,17 +10,18 @@
 #pragma once
 
 #include <functional>
-#include <algorithm>
-#include <atomic>
-#include <chrono>
-#include <execution>
-#include <mutex>
-#include <ranges>
+#include <memory>
+#include <stdexcept>
 #include <tuple>
+#include <vector>
 
-#include "StopWatch.hpp"
+#include "MCEngine.hpp"
+#include "PathBlock.hpp"
+#include "PathStatistics.hpp"
+#include "ProgressReporter.hpp"
 #include "SDEBase.hpp"
 #include "FDMAbstract.hpp"
+#include "Instrumentation.hpp"
 #include "RNGAbstract.hpp"
 
 template<typename SDE>
@@ -28,77 +31,167 @@ public:
     using FDMPointer = std::unique_ptr<FDMAbstract<SDE>>;
     using RNGPointer = std::unique_ptr<RNGAbstract>;
     using PartsTuple = std::tuple<SDEBase<SDE>, FDMPointer, RNGPointer>;
-    using OptionPath = std::function<void(const std::vector<double>& path)>;
+    using Prepare = std::function<void(std::size_t nSlots)>;
+    using OptionPath = std::function<void(const std::vector<double>& path, std::size_t slot)>;
+    using OptionBlock = std::function<void(const PathBlock& block, std::size_t slot)>;
     using Finish = std::function<void(double)>;
-    using NSimDisplay = std::function<void(std::size_t)>;
+    using MergeSlot = std::function<double(std::size_t slot)>;
+    using Truncate = std::function<void(std::size_t nSlots)>;
 
 public:
-    MCMediator(PartsTuple& parts, const OptionPath& optionPath, const Finish& finish, std::size_t numberSimulations);
+    MCMediator(PartsTuple& parts, const Prepare& prepare, const OptionPath& optionPath, const Finish& finish, std::size_t numberSimulations);
 
     void start();
 
+    void set_chunk_size(std::size_t chunkSize);     // Number of paths handed to a worker at once
+    void set_thread_count(std::size_t nThreads);    // Number of worker threads (0 = hardware concurrency)
+    void set_brownian_bridge(bool bridge);          // Build the paths with a Brownian bridge (default for QMC)
+    void set_block_mode(const OptionBlock& optionBlock, std::size_t blockSize); // Advance blockSize paths at once (0 = off)
+    void set_antithetic(bool antithetic);           // Pair every path with its mirrored path (pairs go through the block function)
+    // Stop once the standard error returned by mergeSlot meets the target, numberSimulations becoming maxSimulations
+    void set_target_error(double standardError, std::size_t maxSimulations, const MergeSlot& mergeSlot, const Truncate& truncate);
+    void set_progress(bool progress);               // Print the progress on the console while running (default)
+    void set_progress_callback(const ProgressReporter::Callback& callback, ProgressReporter::Interval interval = ProgressReporter::Interval{ 200 });
+    void set_profile_output(std::ostream* out);     // Instrumented builds: stage profile dump after each run (nullptr = none)
+    void set_pipeline(std::size_t nGenerators);     // Threads drawing the normals ahead of the workers (0 = inline draws)
+    const PipelineStats& get_pipeline_stats() const; // Starvation and stall counts of the last pipelined run
+    const profiling::StageProfile& get_profile() const; // Stage profile of the last run (empty unless instrumented)
+    std::size_t get_chunk_size() const;
+    std::size_t get_thread_count() const;
+
+private:
+    struct Callbacks
+    { // Forwards the engine notifications to the pricer callbacks
+        Prepare m_prepare;                  // Function that tells the pricer how many slots (chunks) will be filled
+        OptionPath m_path;                  // Function that sends the generated path to the pricer
+        OptionBlock m_block;                // Function that sends a block of paths to the pricer
+        Finish m_finish;                    // Function that notifies the pricer to finish and output the option price
+        MergeSlot m_merge;                  // Function that merges a finished slot and returns the standard error
+        Truncate m_truncate;                // Function that drops the slots after the stopping point
+
+        void prepare(std::size_t nSlots) { m_prepare(nSlots); }
+        void process_path(const std::vector<double>& path, std::size_t slot) { m_path(path, slot); }
+        void process_block(const PathBlock& block, std::size_t slot) { m_block(block, slot); }
+        void post_process(double duration) { m_finish(duration); }
+        unsigned required_statistics() const { return PathStatistic::FullPath; } // Callbacks always take whole paths
+        void process_statistics(const PathStatistics&, std::size_t) {}
+        double merge_slot(std::size_t slot) { return m_merge(slot); }
+        void truncate(std::size_t nSlots) { m_truncate(nSlots); }
+    };
+
 private:
     // Three main components
-    SDEBase<SDE> m_sde;
     FDMPointer m_fdm;
     RNGPointer m_rng;
-    // Other MC-related data 
-    std::size_t m_NSim;         // Number of simulations
-    std::vector<double> m_res;  // Generated path
-    OptionPath m_path;          // Function that sends the generated path to the pricer
-    Finish m_finish;            // Function that notifies the pricer to finish and output the option price
-    NSimDisplay m_mis;          // Function to display the count of simulations
-    std::mutex m_mutex;
+    Callbacks m_callbacks;
+    MCEngine<SDE, FDMAbstract<SDE>, RNGAbstract, Callbacks> m_engine;
 };
 
 
 template <typename SDE>
-MCMediator<SDE>::MCMediator(PartsTuple& parts, const OptionPath& optionPath, const Finish& finish, std::size_t numberSimulations)
-    : m_sde(std::get<0>(parts)), m_fdm(std::move(std::get<1>(parts))), m_rng(std::move(std::get<2>(parts))), m_NSim(numberSimulations),
-    m_res(m_fdm->get_NT() + 1, 0), m_path(optionPath), m_finish(finish)
+MCMediator<SDE>::MCMediator(PartsTuple& parts, const Prepare& prepare, const OptionPath& optionPath, const Finish& finish, std::size_t numberSimulations)
+    : m_fdm(std::move(std::get<1>(parts))), m_rng(std::move(std::get<2>(parts))), m_callbacks{ prepare, optionPath, nullptr, finish, nullptr, nullptr },
+    m_engine(std::get<0>(parts), *m_fdm, *m_rng, m_callbacks, numberSimulations)
+{}
+
+template <typename SDE>
+void MCMediator<SDE>::start()
 {
-    m_mis = [](std::size_t i)
-        {
-            if (i % 10000 == 0)
-            {
-                std::cout << "\rSimulation Count: #" << i << std::flush; // Use \r to overwrite the line
-            }
-        };
+    m_engine.start();
 }
 
 template <typename SDE>
-void MCMediator<SDE>::start()
+void MCMediator<SDE>::set_chunk_size(std::size_t chunkSize)
+{
+    m_engine.set_chunk_size(chunkSize);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_thread_count(std::size_t nThreads)
+{
+    m_engine.set_thread_count(nThreads);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_brownian_bridge(bool bridge)
+{
+    m_engine.set_brownian_bridge(bridge);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_block_mode(const OptionBlock& optionBlock, std::size_t blockSize)
+{
+    if (blockSize > 0 && !optionBlock)
+        throw std::invalid_argument("Block mode needs a function to send the blocks to the pricer.");
+
+    m_callbacks.m_block = optionBlock;
+    m_engine.set_block_size(blockSize);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_antithetic(bool antithetic)
+{
+    if (antithetic && !m_callbacks.m_block)
+        throw std::invalid_argument("Antithetic mode needs a function to send the pairs of paths to the pricer (see set_block_mode).");
+
+    m_engine.set_antithetic(antithetic);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_target_error(double standardError, std::size_t maxSimulations, const MergeSlot& mergeSlot, const Truncate& truncate)
+{
+    if (standardError > 0.0 && (!mergeSlot || !truncate))
+        throw std::invalid_argument("Adaptive runs need functions to merge the slots and to drop the unused ones.");
+
+    m_callbacks.m_merge = mergeSlot;
+    m_callbacks.m_truncate = truncate;
+    m_engine.set_target_error(standardError, maxSimulations);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_progress(bool progress)
+{
+    m_engine.set_progress(progress);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_progress_callback(const ProgressReporter::Callback& callback, ProgressReporter::Interval interval)
+{
+    m_engine.set_progress_callback(callback, interval);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_profile_output(std::ostream* out)
+{
+    m_engine.set_profile_output(out);
+}
+
+template <typename SDE>
+void MCMediator<SDE>::set_pipeline(std::size_t nGenerators)
+{
+    m_engine.set_pipeline(nGenerators);
+}
+
+template <typename SDE>
+const PipelineStats& MCMediator<SDE>::get_pipeline_stats() const
+{
+    return m_engine.get_pipeline_stats();
+}
+
+template <typename SDE>
+const profiling::StageProfile& MCMediator<SDE>::get_profile() const
+{
+    return m_engine.get_profile();
+}
+
+template <typename SDE>
+std::size_t MCMediator<SDE>::get_chunk_size() const
+{
+    return m_engine.get_chunk_size();
+}
+
+template <typename SDE>
+std::size_t MCMediator<SDE>::get_thread_count() const
 {
-    StopWatch sw;
-
-    sw.Start();
-
-    m_res[0] = m_sde.initial_condition();
-
-    // Usina a iota range to iterate over in the for_each loop
-    auto iota = std::ranges::views::iota(1, (int)m_NSim + 1);
-    std::for_each(std::execution::par, iota.begin(), iota.end(), [&](std::size_t i)
-        { // Calculate a path at each iteration
-         //   if ((i / 5000) * 5000 == i)
-          // Give status after a given numbers of iterations
-            {
-                std::lock_guard<std::mutex> lock(m_mutex);
-                m_mis(i);
-            }
-
-            std::atomic_size_t j = 1;
-            std::for_each(m_res.begin() + 1, m_res.end(), [&](double a)
-                {
-                    // Compute the solution at level n+1
-                    m_res[j] = m_fdm->advance(m_res[j - 1], m_fdm->get_mesh()[j - 1], m_fdm->get_meshSize(), m_rng->generate_rn(), m_rng->generate_rn());
-                    j.fetch_add(1, std::memory_order_relaxed); // Advance to the next time step
-                });
-            // Send path data to the Pricers
-            m_path(m_res);
-            
-        });
-    sw.Stop();
-
-    // Inform pricer to finish, pass the duration of the process
-    m_finish(sw.GetTime());
+    return m_engine.get_thread_count();
 }
@@ -0,0 +1,446 @@
+// MLMC.hpp
+//
+// Multilevel Monte Carlo driver over a hierarchy of Euler meshes NT_l = NT_0 M^l.
+// Level 0 estimates E[P_0], level l > 0 estimates E[P_l - P_{l-1}] from coupled paths: the fine path
+// takes one normal per step and the coarse path the sum of the M fine increments of each of its steps.
+// The number of levels and of paths per level are chosen from online variance estimates (Giles 2008),
+// so that the RMS error meets the target at a cost O(eps^-2) instead of the O(eps^-3) of standard MC.
+// The payoffs come from the existing pricers, path by path, through PricerAbstract::payoffs.
+// The paths of a level are split into chunks run by a set of worker threads, each chunk keeping its own
+// moments merged in chunk order: results do not depend on the number of threads.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ControlVariate.hpp"
+#include "FDMDerived.hpp"
+#include "PathBlock.hpp"
+#include "PricerAbstract.hpp"
+#include "RNGAbstract.hpp"
+#include "SDEBase.hpp"
+
+template <typename SDE>
+class MLMCEngine
+{
+public:
+    struct Level
+    {
+        std::size_t NT;         // Time steps of the fine paths
+        std::size_t nSamples;   // Paths (coupled pairs of paths for l > 0)
+        double callMean;        // Mean of P_l - P_{l-1} (undiscounted)
+        double putMean;
+        double callVariance;    // Variance of P_l - P_{l-1}
+        double putVariance;
+        double fineVariance;    // Largest variance of P_l (call or put)
+        double cost;            // Time steps per sample
+    };
+
+    struct Result
+    {
+        double callPrice;
+        double putPrice;
+        double callError;       // Standard errors of the estimators
+        double putError;
+        double cost;            // Time steps simulated
+        double standardCost;    // Time steps standard MC on the finest mesh would need for the same error
+        bool converged;         // False if the bias test still failed at the finest level allowed
+        std::vector<Level> levels;
+    };
+
+public:
+    MLMCEngine(const SDEBase<SDE>& sde, const RNGAbstract& rng, const PricerAbstract& pricer, std::size_t coarseNT);
+
+    Result run(double epsilon);                     // Target root mean square error of the prices
+
+    void set_refinement(std::size_t M);             // Refinement factor between two levels (default 2)
+    void set_initial_samples(std::size_t N0);       // Paths of the first pass on a new level (default 1000)
+    void set_max_level(std::size_t maxLevel);       // Finest level allowed (default 10)
+    void set_thread_count(std::size_t nThreads);    // Number of worker threads (0 = hardware concurrency)
+    void set_block_size(std::size_t blockSize);     // Paths advanced together (default 64)
+
+private:
+    static constexpr std::size_t MinLevel = 2;      // Levels 0..2 are always sampled
+    static constexpr std::size_t ChunkSize = 1024;  // Paths per chunk
+
+    struct alignas(64) Moments
+    { // Moments of a chunk
+        ControlMoments call;    // P_l - P_{l-1}
+        ControlMoments put;
+        ControlMoments fineCall;// P_l
+        ControlMoments finePut;
+    };
+
+    struct Buffers
+    { // Preallocated buffers owned by a worker
+        std::vector<double> normals;        // Normals of a single path (fine NT)
+        std::vector<double> fineNormals;    // Structure of arrays (fine NT x blockSize)
+        std::vector<double> coarseNormals;  // Structure of arrays (coarse NT x blockSize)
+        std::vector<double> finePaths;      // Structure of arrays ((fine NT + 1) x blockSize)
+        std::vector<double> coarsePaths;    // Structure of arrays ((coarse NT + 1) x blockSize)
+        std::vector<double> payoffs;        // Fine and coarse call and put payoffs (4 x blockSize)
+    };
+
+    std::size_t level_NT(std::size_t level) const;
+    double level_cost(std::size_t level) const;
+    void add_level();
+    void sample_level(std::size_t level, std::size_t nSamples);    // Adds nSamples paths to a level
+    void run_chunk(std::size_t level, std::size_t first, std::size_t last, Moments& moments, Buffers& buffers) const;
+    Level level_statistics(std::size_t level) const;
+
+private:
+    SDEBase<SDE> m_sde;
+    const RNGAbstract& m_rng;
+    const PricerAbstract& m_pricer;
+    std::size_t m_coarseNT;             // Time steps of level 0
+    std::size_t m_M;                    // Refinement factor
+    std::size_t m_N0;                   // Paths of the first pass on a level
+    std::size_t m_maxLevel;
+    std::size_t m_nThreads;
+    std::size_t m_blockSize;
+    std::vector<EulerFDM<SDE>> m_fdms;  // Mesh hierarchy, one scheme per level
+    std::vector<Moments> m_moments;     // Merged moments, one per level
+};
+
+//------------Implementations------------
+
+template <typename SDE>
+MLMCEngine<SDE>::MLMCEngine(const SDEBase<SDE>& sde, const RNGAbstract& rng, const PricerAbstract& pricer, std::size_t coarseNT)
+    : m_sde(sde), m_rng(rng), m_pricer(pricer), m_coarseNT{ coarseNT }, m_M{ 2 }, m_N0{ 1000 }, m_maxLevel{ 10 },
+    m_nThreads{ std::max<std::size_t>(1, std::thread::hardware_concurrency()) }, m_blockSize{ 64 }
+{
+    if (coarseNT < 1)
+        throw std::invalid_argument("Level 0 needs at least one time step.");
+    if (rng.low_discrepancy())
+        throw std::invalid_argument("Multilevel Monte Carlo needs a pseudo-random generator.");
+}
+
+template <typename SDE>
+void MLMCEngine<SDE>::set_refinement(std::size_t M)
+{
+    if (M < 2)
+        throw std::invalid_argument("Refinement factor must be at least 2.");
+
+    m_M = M;
+}
+
+template <typename SDE>
+void MLMCEngine<SDE>::set_initial_samples(std::size_t N0)
+{
+    if (N0 < 2)
+        throw std::invalid_argument("At least two paths are needed to estimate a variance.");
+
+    m_N0 = N0;
+}
+
+template <typename SDE>
+void MLMCEngine<SDE>::set_max_level(std::size_t maxLevel)
+{
+    if (maxLevel < MinLevel)
+        throw std::invalid_argument("Finest level must be at least 2.");
+
+    m_maxLevel = maxLevel;
+}
+
+template <typename SDE>
+void MLMCEngine<SDE>::set_thread_count(std::size_t nThreads)
+{
+    m_nThreads = nThreads == 0 ? std::max<std::size_t>(1, std::thread::hardware_concurrency()) : nThreads;
+}
+
+template <typename SDE>
+void MLMCEngine<SDE>::set_block_size(std::size_t blockSize)
+{
+    if (blockSize < 1)
+        throw std::invalid_argument("Block size must be a strictly positive integer.");
+
+    m_blockSize = blockSize;
+}
+
+template <typename SDE>
+std::size_t MLMCEngine<SDE>::level_NT(std::size_t level) const
+{
+    std::size_t NT = m_coarseNT;
+    for (std::size_t l = 0; l < level; ++l)
+        NT *= m_M;
+
+    return NT;
+}
+
+template <typename SDE>
+double MLMCEngine<SDE>::level_cost(std::size_t level) const
+{
+    // The fine path, plus the coarse one it is coupled with
+    return static_cast<double>(level_NT(level) + (level > 0 ? level_NT(level - 1) : 0));
+}
+
+template <typename SDE>
+void MLMCEngine<SDE>::add_level()
+{
+    m_fdms.emplace_back(m_sde, level_NT(m_fdms.size()));
+    m_moments.emplace_back();
+}
+
+template <typename SDE>
+typename MLMCEngine<SDE>::Result MLMCEngine<SDE>::run(double epsilon)
+{
+    if (epsilon <= 0.0)
+        throw std::invalid_argument("Target error must be strictly positive.");
+
+    m_fdms.clear();
+    m_moments.clear();
+    for (std::size_t l = 0; l <= MinLevel; ++l)
+        add_level();
+
+    const double M = static_cast<double>(m_M);
+    std::vector<std::size_t> dN(m_fdms.size(), m_N0);
+    std::vector<double> V(m_fdms.size());
+    bool converged = true;
+
+    // Decay rates of |E[P_l - P_{l-1}]| (alpha) and of Var[P_l - P_{l-1}] (beta), as powers of M,
+    // fitted on the levels l >= 1 and floored at 0.5
+    auto rate = [&](auto&& value)
+        {
+            double n{}, sx{}, sy{}, sxx{}, sxy{};
+            for (std::size_t l = 1; l < m_fdms.size(); ++l)
+            {
+                double y = std::log(std::max(value(l), 1e-300)) / std::log(M);
+                n += 1.0; sx += l; sy += y; sxx += double(l) * l; sxy += l * y;
+            }
+            return std::max(0.5, -(n * sxy - sx * sy) / (n * sxx - sx * sx));
+        };
+
+    // Optimal number of paths per level for a variance of eps^2 / 2 (the other half goes to the bias)
+    auto optimal = [&]()
+        {
+            double sum{};
+            for (std::size_t l = 0; l < m_fdms.size(); ++l)
+                sum += std::sqrt(V[l] * level_cost(l));
+
+            for (std::size_t l = 0; l < m_fdms.size(); ++l)
+            {
+                std::size_t N = static_cast<std::size_t>(std::ceil(2.0 / (epsilon * epsilon) * std::sqrt(V[l] / level_cost(l)) * sum));
+                std::size_t done = m_moments[l].call.count();
+                dN[l] = N > done ? N - done : 0;
+            }
+        };
+
+    while (std::any_of(dN.begin(), dN.end(), [](std::size_t n) { return n > 0; }))
+    {
+        for (std::size_t l = 0; l < m_fdms.size(); ++l)
+        {
+            if (dN[l] > 0)
+                sample_level(l, dN[l]);
+        }
+
+        for (std::size_t l = 0; l < m_fdms.size(); ++l)
+        {
+            Level stats = level_statistics(l);
+            V[l] = std::max(stats.callVariance, stats.putVariance);
+        }
+        double beta = rate([&](std::size_t l) { return V[l]; });
+        for (std::size_t l = 2; l < m_fdms.size(); ++l)
+        { // Guards against levels whose few paths happen to agree (e.g. a barrier never crossed)
+            V[l] = std::max(V[l], 0.5 * V[l - 1] / std::pow(M, beta));
+        }
+        optimal();
+
+        bool settled = true;
+        for (std::size_t l = 0; l < m_fdms.size(); ++l)
+        {
+            if (static_cast<double>(dN[l]) > 0.01 * static_cast<double>(m_moments[l].call.count()))
+                settled = false;
+        }
+        if (!settled)
+            continue;
+
+        // Weak convergence test: remaining bias ~ |E[P_L - P_{L-1}]| / (M^alpha - 1)
+        std::size_t L = m_fdms.size() - 1;
+        auto mean = [&](std::size_t l) { return std::max(std::abs(m_moments[l].call.mean()), std::abs(m_moments[l].put.mean())); };
+        double alpha = rate(mean);
+        double bias = std::max(mean(L), mean(L - 1) / std::pow(M, alpha)) / (std::pow(M, alpha) - 1.0);
+        if (bias <= epsilon / std::sqrt(2.0))
+            continue;
+
+        if (L == m_maxLevel)
+        {
+            converged = false;
+            continue;
+        }
+
+        // One more level, its variance extrapolated until it is sampled
+        add_level();
+        dN.push_back(0);
+        V.push_back(V[L] / std::pow(M, beta));
+        optimal();
+    }
+
+    Result result{};
+    double discount = m_pricer.discount_factor()();
+    double callVariance{}, putVariance{};
+    for (std::size_t l = 0; l < m_fdms.size(); ++l)
+    {
+        Level stats = level_statistics(l);
+        result.callPrice += stats.callMean;
+        result.putPrice += stats.putMean;
+        callVariance += stats.callVariance / stats.nSamples;
+        putVariance += stats.putVariance / stats.nSamples;
+        result.cost += stats.cost * stats.nSamples;
+        result.levels.push_back(stats);
+    }
+    result.callPrice *= discount;
+    result.putPrice *= discount;
+    result.callError = discount * std::sqrt(callVariance);
+    result.putError = discount * std::sqrt(putVariance);
+    result.standardCost = 2.0 / (epsilon * epsilon) * result.levels.back().fineVariance * result.levels.back().NT;
+    result.converged = converged;
+
+    return result;
+}
+
+template <typename SDE>
+void MLMCEngine<SDE>::sample_level(std::size_t level, std::size_t nSamples)
+{
+    // Paths first..first + nSamples - 1 of the level, whatever was sampled before
+    std::size_t first = m_moments[level].call.count();
+    std::size_t nChunks = (nSamples + ChunkSize - 1) / ChunkSize;
+    std::vector<Moments> slots(nChunks);
+    std::atomic_size_t nextChunk{ 0 };
+
+    auto worker = [&]()
+        {
+            Buffers buffers;
+            for (std::size_t chunk = nextChunk.fetch_add(1); chunk < nChunks; chunk = nextChunk.fetch_add(1))
+            {
+                std::size_t begin = first + chunk * ChunkSize;
+                run_chunk(level, begin, std::min(begin + ChunkSize, first + nSamples), slots[chunk], buffers);
+            }
+        };
+
+    std::size_t nWorkers = std::min(m_nThreads, nChunks);
+    if (nWorkers <= 1)
+    {
+        worker();
+    }
+    else
+    {
+        std::vector<std::jthread> workers;
+        for (std::size_t w = 0; w < nWorkers; ++w)
+            workers.emplace_back(worker);
+    }
+
+    Moments& moments = m_moments[level];
+    for (const Moments& slot : slots)
+    { // Chunk order
+        moments.call.merge(slot.call, 0);
+        moments.put.merge(slot.put, 0);
+        moments.fineCall.merge(slot.fineCall, 0);
+        moments.finePut.merge(slot.finePut, 0);
+    }
+}
+
+template <typename SDE>
+void MLMCEngine<SDE>::run_chunk(std::size_t level, std::size_t first, std::size_t last, Moments& moments, Buffers& buffers) const
+{
+    const EulerFDM<SDE>& fine = m_fdms[level];
+    const std::size_t fineNT = fine.get_NT();
+    const std::size_t coarseNT = level > 0 ? fineNT / m_M : 0;
+    const std::size_t stride = m_blockSize;
+    const std::vector<double> fineMesh = fine.get_mesh();
+    const double fineDt = fine.get_meshSize();
+    const double scale = 1.0 / std::sqrt(static_cast<double>(m_M));
+
+    buffers.normals.resize(fineNT);
+    buffers.fineNormals.resize(fineNT * stride);
+    buffers.coarseNormals.resize(coarseNT * stride);
+    buffers.finePaths.resize((fineNT + 1) * stride);
+    buffers.coarsePaths.resize((coarseNT + 1) * stride);
+    buffers.payoffs.resize(4 * stride);
+    double* fineCall = buffers.payoffs.data();
+    double* finePut = fineCall + stride;
+    double* coarseCall = finePut + stride;
+    double* coarsePut = coarseCall + stride;
+
+    for (std::size_t b = first; b < last; b += m_blockSize)
+    {
+        std::size_t nPaths = std::min(m_blockSize, last - b);
+
+        // Path i of level l always reads the same stream
+        for (std::size_t p = 0; p < nPaths; ++p)
+        {
+            m_rng.seek((static_cast<std::uint64_t>(level) << 40) + b + p);
+            m_rng.fill(buffers.normals);
+            for (std::size_t j = 0; j < fineNT; ++j)
+                buffers.fineNormals[j * stride + p] = buffers.normals[j];
+        }
+
+        std::fill(buffers.finePaths.begin(), buffers.finePaths.begin() + nPaths, m_sde.initial_condition());
+        for (std::size_t j = 1; j <= fineNT; ++j)
+        {
+            fine.advance_block({ buffers.finePaths.data() + (j - 1) * stride, nPaths }, fineMesh[j - 1], fineDt,
+                { buffers.fineNormals.data() + (j - 1) * stride, nPaths }, { buffers.finePaths.data() + j * stride, nPaths });
+        }
+        m_pricer.payoffs(PathBlock{ buffers.finePaths.data(), nPaths, stride, fineNT + 1 }, { fineCall, nPaths }, { finePut, nPaths });
+
+        if (level > 0)
+        { // Coarse increment = sum of the M fine increments, i.e. normal = sum / sqrt(M)
+            const EulerFDM<SDE>& coarse = m_fdms[level - 1];
+            const std::vector<double>& coarseMesh = coarse.get_mesh();
+            const double coarseDt = coarse.get_meshSize();
+
+            for (std::size_t jc = 0; jc < coarseNT; ++jc)
+            {
+                double* z = buffers.coarseNormals.data() + jc * stride;
+                std::fill(z, z + nPaths, 0.0);
+                for (std::size_t m = 0; m < m_M; ++m)
+                {
+                    const double* zf = buffers.fineNormals.data() + (jc * m_M + m) * stride;
+                    for (std::size_t p = 0; p < nPaths; ++p)
+                        z[p] += zf[p];
+                }
+                for (std::size_t p = 0; p < nPaths; ++p)
+                    z[p] *= scale;
+            }
+
+            std::fill(buffers.coarsePaths.begin(), buffers.coarsePaths.begin() + nPaths, m_sde.initial_condition());
+            for (std::size_t j = 1; j <= coarseNT; ++j)
+            {
+                coarse.advance_block({ buffers.coarsePaths.data() + (j - 1) * stride, nPaths }, coarseMesh[j - 1], coarseDt,
+                    { buffers.coarseNormals.data() + (j - 1) * stride, nPaths }, { buffers.coarsePaths.data() + j * stride, nPaths });
+            }
+            m_pricer.payoffs(PathBlock{ buffers.coarsePaths.data(), nPaths, stride, coarseNT + 1 }, { coarseCall, nPaths }, { coarsePut, nPaths });
+        }
+        else
+        {
+            std::fill(coarseCall, coarseCall + nPaths, 0.0);
+            std::fill(coarsePut, coarsePut + nPaths, 0.0);
+        }
+
+        for (std::size_t p = 0; p < nPaths; ++p)
+        {
+            moments.call.add(fineCall[p] - coarseCall[p], nullptr, 0);
+            moments.put.add(finePut[p] - coarsePut[p], nullptr, 0);
+            moments.fineCall.add(fineCall[p], nullptr, 0);
+            moments.finePut.add(finePut[p], nullptr, 0);
+        }
+    }
+}
+
+template <typename SDE>
+typename MLMCEngine<SDE>::Level MLMCEngine<SDE>::level_statistics(std::size_t level) const
+{
+    const Moments& moments = m_moments[level];
+    auto variance = [](const ControlMoments& m) { return m.estimate(nullptr, 0).variance; };
+
+    return Level{ m_fdms[level].get_NT(), moments.call.count(), moments.call.mean(), moments.put.mean(),
+        variance(moments.call), variance(moments.put), std::max(variance(moments.fineCall), variance(moments.finePut)), level_cost(level) };
+}
@@ -49,3 +49,15 @@ struct OptionData
 		}
 	}
 };
+
+// Model parameters of OptionData as a separate set of inputs, of any number type: with aad::Real
+// the SDEs record their drift and diffusion on a tape and the prices can be differentiated w.r.t. them
+template <typename Real>
+struct ModelInputs
+{
+	Real S0;
+	Real vol;
+	Real r;
+	Real q;
+	Real betaCEV;
+};
@@ -0,0 +1,25 @@
+// PathBlock.hpp
+//
+// Non-owning view of a block of paths stored as a structure of arrays:
+// row j holds the value of every path of the block at time step j.
+// In antithetic mode path p and path p + nPaths / 2 are driven by opposite draws.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <span>
+
+struct PathBlock
+{
+	const double* data;		// First value of row 0
+	std::size_t nPaths;		// Number of paths in the block
+	std::size_t stride;		// Distance between two consecutive rows (>= nPaths)
+	std::size_t nRows;		// Number of time points (NT + 1)
+	bool antithetic{};		// Paths p and p + nPaths / 2 form an antithetic pair
+
+	std::span<const double> row(std::size_t j) const { return { data + j * stride, nPaths }; }
+	std::span<const double> back() const { return row(nRows - 1); }
+	std::size_t samples() const { return antithetic ? nPaths / 2 : nPaths; } // Independent samples in the block
+};
@@ -0,0 +1,39 @@
+// PathStatistics.hpp
+//
+// Statistics of a path that the engine can maintain while it steps, so that pricers which do
+// not need the whole path never have it stored. A pricer requests a combination of the flags
+// below, the engine fills the matching arrays and leaves the others null.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace PathStatistic
+{
+	enum Flags : unsigned
+	{
+		Terminal = 1 << 0,	// Value at expiry
+		Sum = 1 << 1,		// Sum of the NT + 1 points
+		LogSum = 1 << 2,	// Sum of the logarithms of the NT + 1 points
+		Min = 1 << 3,		// Running minimum
+		Max = 1 << 4,		// Running maximum
+		FullPath = 1 << 5	// Whole path (no streaming)
+	};
+}
+
+struct PathStatistics
+{ // Statistics of nPaths paths, one value per path in each array (structure of arrays)
+	std::size_t nPaths;		// Number of paths (1 in scalar mode)
+	std::size_t nPoints;	// Number of points per path (NT + 1)
+	const double* terminal;
+	const double* sum;
+	const double* logSum;
+	const double* min;
+	const double* max;
+	bool antithetic{};		// Paths p and p + nPaths / 2 form an antithetic pair
+
+	std::size_t samples() const { return antithetic ? nPaths / 2 : nPaths; } // Independent samples
+};
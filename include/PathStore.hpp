@@ -0,0 +1,191 @@
+// PathStore.hpp
+// 
+// Binary store of simulated paths, to re-price the same scenario set with new payoffs without
+// simulating again. PathRecorder is plugged into the engine as the pricer (optionally pricing
+// another pricer on the fly) and copies every block of paths, or of per-path statistics (terminal,
+// sum, log sum, min, max), to a memory-mapped file whose header records the option data, the model,
+// the scheme, the RNG, the seed, NT and the chunking of the run. PathReplay maps the file and hands the
+// blocks to the pricers straight from the mapping (no copy), in parallel chunks. The chunks are the
+// slots of the recorded run, so a replay gives the same results as the run itself.
+// Blocks are stored as in the engine (structure of arrays, one row per time step or statistic):
+// block k holds the samples [k blockSize, (k + 1) blockSize) and its place in the file only depends on k,
+// so the workers of the recording run write without any synchronisation.
+// 
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OptionData.hpp"
+#include "PathBlock.hpp"
+#include "PathStatistics.hpp"
+#include "PricerAbstract.hpp"
+#include "StopWatch.hpp"
+
+struct PathFileInfo
+{ // How the paths were simulated (header of the file)
+    OptionData data;
+    std::string model;                  // e.g. "GBM" (at most 15 characters)
+    std::string scheme;                 // e.g. "Euler"
+    std::string rng;                    // e.g. "Philox"
+    std::uint64_t seed{};
+    std::size_t NT{};
+    std::size_t nSim{};                 // Simulations of the run (NSim paths = NSim / 2 pairs in antithetic mode)
+    std::size_t chunkSize{ 1024 };      // Chunk size of the engine (samples)
+    std::size_t blockSize{ 64 };        // Block size of the engine (samples), divides chunkSize
+    bool antithetic{};
+    bool statistics{};                  // Per-path statistics instead of whole paths
+
+    std::size_t samples() const;        // Independent samples (pairs in antithetic mode)
+    std::size_t width() const;          // Paths per stored block (stride of the rows)
+    std::size_t rows() const;           // Rows per stored block (NT + 1, or the 5 statistics)
+};
+
+class MappedFile
+{ // File mapped in memory (POSIX), read-only or read-write
+public:
+    static MappedFile create(const std::string& path, std::size_t size);   // Creates (or overwrites) a file of 'size' bytes
+    static MappedFile open(const std::string& path);                        // Maps an existing file read-only
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    std::byte* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    void resize(std::size_t size);      // Read-write mappings only
+    void close();
+
+private:
+    MappedFile() = default;
+
+private:
+    int m_fd{ -1 };
+    std::byte* m_data{};
+    std::size_t m_size{};
+    bool m_writable{};
+};
+
+class PathRecorder final : public PricerAbstract
+{ // Records the blocks the engine sends (block mode, with the block and chunk sizes of the file info)
+public:
+    PathRecorder(const std::string& path, const PathFileInfo& info, const std::shared_ptr<PricerAbstract>& pricer = nullptr);
+
+    const PathFileInfo& info() const;
+
+    void prepare(std::size_t nSlots) override;                          // Creates the file
+    double merge_slot(std::size_t slot) override;
+    void truncate(std::size_t nSlots) override;                         // Adaptive runs: only the merged chunks are kept
+    void process_path(const std::vector<double>& path, std::size_t slot) override; // Not supported: block mode only
+    void process_block(const PathBlock& block, std::size_t slot) override;
+    unsigned required_statistics() const override;                      // Whole paths, or every statistic
+    void process_statistics(const PathStatistics& stats, std::size_t slot) override;
+    void post_process(double duration) override;                        // Writes the header and closes the file
+    bool supports_control(ControlVariate::Kind kind) const override;
+
+private:
+    double* block_data(std::size_t slot, std::size_t nSamples);         // Next block of the slot in the file
+
+private:
+    std::string m_path;
+    PathFileInfo m_info;
+    std::shared_ptr<PricerAbstract> m_pricer;   // Priced on the fly, if any
+    std::unique_ptr<MappedFile> m_file;
+    std::vector<std::size_t> m_slotSamples;     // Samples recorded in every slot so far
+};
+
+class PathReplay
+{
+public:
+    explicit PathReplay(const std::string& path);
+
+    const PathFileInfo& info() const;
+
+    // Streams the recorded paths to the pricer, one worker per thread (0 = hardware concurrency)
+    template <typename Pricer>
+    void run(Pricer& pricer, std::size_t nThreads = 0) const;
+
+private:
+    PathBlock block(std::size_t k) const;
+    PathStatistics statistics(std::size_t k) const;
+
+private:
+    MappedFile m_file;
+    PathFileInfo m_info;
+    std::size_t m_nBlocks;
+};
+
+//------------Implementations------------
+
+template <typename Pricer>
+void PathReplay::run(Pricer& pricer, std::size_t nThreads) const
+{
+    StopWatch sw;
+    sw.Start();
+
+    std::size_t nChunks = (m_info.samples() + m_info.chunkSize - 1) / m_info.chunkSize;
+    std::size_t blocksPerChunk = m_info.chunkSize / m_info.blockSize;
+    pricer.prepare(nChunks);
+    if (m_info.statistics && (pricer.required_statistics() & PathStatistic::FullPath))
+        throw std::invalid_argument("The pricer needs whole paths, the file only holds their statistics.");
+
+    std::atomic_size_t nextChunk{};
+    std::exception_ptr error;           // First exception thrown by a worker, rethrown once they have joined
+    std::mutex errorMutex;
+    auto worker = [&]()
+        {
+            try
+            {
+                for (std::size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < nChunks; chunk = nextChunk.fetch_add(1, std::memory_order_relaxed))
+                {
+                    std::size_t last = std::min((chunk + 1) * blocksPerChunk, m_nBlocks);
+                    for (std::size_t k = chunk * blocksPerChunk; k < last; ++k)
+                    {
+                        if (m_info.statistics)
+                            pricer.process_statistics(statistics(k), chunk);
+                        else
+                            pricer.process_block(block(k), chunk);
+                    }
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                    error = std::current_exception();
+                nextChunk.store(nChunks, std::memory_order_relaxed); // The other workers stop picking chunks
+            }
+        };
+
+    if (nThreads == 0)
+        nThreads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    nThreads = std::min(nThreads, nChunks);
+    if (nThreads <= 1)
+    {
+        worker();
+    }
+    else
+    {
+        std::vector<std::jthread> workers;
+        for (std::size_t w = 0; w < nThreads; ++w)
+            workers.emplace_back(worker);
+        // jthreads join on destruction
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    sw.Stop();
+    pricer.post_process(sw.GetTime());
+}
@@ -1,11 +1,20 @@
 #pragma once
 
-#include <atomic>
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <functional>
-#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
+#include "AAD.hpp"
+#include "ControlVariate.hpp"
+#include "Greeks.hpp"
 #include "Interface.hpp"
+#include "PathBlock.hpp"
+#include "PathStatistics.hpp"
 
 class PricerAbstract
 {
@@ -13,20 +22,385 @@ public:
     using PayoffFunc = std::function<double(double)>;
     using DiscounterFunc = std::function<double()>;
 
+    // Partial sums owned by a single slot (chunk of simulations). Padded to a cache line
+    // so that workers filling neighbouring slots never share one.
+    struct alignas(64) PartialSums
+    {
+        double callSum{};
+        double putSum{};
+        std::size_t count{};
+    };
+
+    // Control moments of the call and of the put owned by a single slot
+    struct alignas(64) ControlPartials
+    {
+        ControlMoments call;
+        ControlMoments put;
+    };
+
+    // Moments of the per-path Greek samples of the call and of the put owned by a single slot
+    struct alignas(64) GreekPartials
+    {
+        std::array<ControlMoments, NGreeks> call;
+        std::array<ControlMoments, NGreeks> put;
+    };
+
+    // Payoffs of a path, and the quantities the controls are built from
+    struct PathSample
+    {
+        double call;
+        double put;
+        double terminal{};  // S_T
+        double geometric{}; // Geometric average of the path
+    };
+
 public: 
     PricerAbstract(const PayoffFunc& callpayoff, const PayoffFunc& putpayoff, const DiscounterFunc& discounter, std::size_t nSim)
         : m_callPayoff{ callpayoff }, m_putPayoff{ putpayoff }, m_discounter{discounter}, m_putPrice{}, m_callPrice{}, 
-        m_callSum{}, m_putSum{}, m_NSim{nSim}
+        m_callSum{}, m_putSum{}, m_NSim{nSim}, m_display{ true }, m_quasiRandom{ false }, m_vanilla{ false }, m_strike{}, m_partials(1),
+        m_plainCallPrice{}, m_plainPutPrice{}, m_callReduction{ 1.0 }, m_putReduction{ 1.0 }, m_callError{}, m_putError{},
+        m_greeks{ false }, m_greekModel{}, m_callGreeks{}, m_putGreeks{}, m_callGreekErrors{}, m_putGreekErrors{}
     {}
+    // Vanilla payoffs max(S - K, 0) and max(K - S, 0), evaluated inline instead of through a std::function
+    PricerAbstract(double strike, const DiscounterFunc& discounter, std::size_t nSim)
+        : PricerAbstract([strike](double S) { return std::max(S - strike, 0.0); }, [strike](double S) { return std::max(strike - S, 0.0); },
+            discounter, nSim)
+    {
+        m_vanilla = true;
+        m_strike = strike;
+    }
     virtual ~PricerAbstract() = default;
 
     DiscounterFunc discount_factor() const { return m_discounter; }         // Discounting
     virtual double call_price() const { return m_callPrice; }               // Call price
     virtual double put_price() const { return m_putPrice; }                 // Put price
+    void set_display(bool display) { m_display = display; }                 // Print the results in post_process
+    void set_quasi_random(bool quasiRandom) { m_quasiRandom = quasiRandom; } // Low-discrepancy draws: the i.i.d. errors do not apply
+    std::size_t simulation_count() const { return m_NSim; }                 // Samples of the last run
+
+    // Control variates, applied to the prices in post_process
+    void add_control(const ControlVariate& control)
+    {
+        if (m_controls.size() == MaxControls)
+            throw std::invalid_argument("Too many control variates.");
+        if (!supports_control(control.kind))
+            throw std::invalid_argument("Control variate not supported by this pricer.");
+
+        m_controls.push_back(control);
+    }
+    void clear_controls() { m_controls.clear(); }
+    virtual bool supports_control(ControlVariate::Kind kind) const { return kind != ControlVariate::Kind::GeometricAverage; }
+    double plain_call_price() const { return m_plainCallPrice; }            // Prices before the control variates
+    double plain_put_price() const { return m_plainPutPrice; }
+    double call_variance_reduction() const { return m_callReduction; }      // Var[plain] / Var[controlled]
+    double put_variance_reduction() const { return m_putReduction; }
+    double call_standard_error() const { return m_callError; }              // Standard errors of the prices
+    double put_standard_error() const { return m_putError; }
+
+    // Greeks under GBM, estimated from the stored Euler paths in the same pass as the prices
+    void set_greeks(const GreekModel& model)
+    {
+        if (!m_vanilla)
+            throw std::invalid_argument("Greeks need the vanilla payoffs.");
+
+        m_greekModel = model;
+        m_greeks = true;
+    }
+    bool greeks_enabled() const { return m_greeks; }
+    double call_greek(Greek greek) const { return m_callGreeks[static_cast<std::size_t>(greek)]; }   // Discounted
+    double put_greek(Greek greek) const { return m_putGreeks[static_cast<std::size_t>(greek)]; }
+    double call_greek_error(Greek greek) const { return m_callGreekErrors[static_cast<std::size_t>(greek)]; } // Standard errors
+    double put_greek_error(Greek greek) const { return m_putGreekErrors[static_cast<std::size_t>(greek)]; }
+
+    virtual void prepare(std::size_t nSlots)                                // Notify start of simulation
+    {
+        m_partials.assign(nSlots, PartialSums{});
+        m_controlPartials.assign(nSlots, ControlPartials{});
+        m_greekPartials.assign(m_greeks ? nSlots : 0, GreekPartials{});
+        m_runningCall = ControlMoments{};
+        m_runningPut = ControlMoments{};
+    }
+    // Adaptive runs: adds a finished slot to the running estimate (slots in order) and returns
+    // the largest standard error of the prices so far
+    virtual double merge_slot(std::size_t slot)
+    {
+        m_runningCall.merge(m_controlPartials[slot].call, m_controls.size());
+        m_runningPut.merge(m_controlPartials[slot].put, m_controls.size());
 
-    virtual void process_path(const std::vector<double>& path) = 0;         // Create a single path
+        double discount = m_discounter();
+        auto [callMeans, putMeans] = control_means(discount);
+        ControlMoments::Estimate call = m_runningCall.estimate(callMeans.data(), m_controls.size());
+        ControlMoments::Estimate put = m_runningPut.estimate(putMeans.data(), m_controls.size());
+        double n = static_cast<double>(m_runningCall.count());
+
+        return discount * std::sqrt(std::max(call.variance, put.variance) / n);
+    }
+    virtual void truncate(std::size_t nSlots)                               // Keep the first nSlots slots only
+    {
+        m_partials.resize(nSlots);
+        m_controlPartials.resize(nSlots);
+        if (m_greeks)
+            m_greekPartials.resize(nSlots);
+    }
+    virtual void process_path(const std::vector<double>& path, std::size_t slot) = 0;      // Process a single path
+    virtual void process_block(const PathBlock& block, std::size_t slot)                   // Process a block of paths
+    { // Default: gather each path and process it on its own
+        if (block.antithetic)
+            throw std::logic_error("Pricer does not support antithetic pairs.");
+
+        thread_local std::vector<double> path;
+        path.resize(block.nRows);
+        for (std::size_t p = 0; p < block.nPaths; ++p)
+        {
+            for (std::size_t j = 0; j < block.nRows; ++j)
+                path[j] = block.data[j * block.stride + p];
+            process_path(path, slot);
+        }
+    }
     virtual void post_process(double duration) = 0;                         // Notify end of simulation
 
+    // Undiscounted payoffs of every path of a block, without accumulating them (multilevel estimators)
+    virtual void payoffs(const PathBlock& block, std::span<double> calls, std::span<double> puts) const
+    {
+        throw std::logic_error("Pricer does not expose its payoffs.");
+    }
+
+    // Undiscounted {call, put} payoffs of a path recorded on the AAD tape (adjoint sensitivities)
+    virtual std::pair<aad::Real, aad::Real> adjoint_payoffs(std::span<const aad::Real> path) const
+    {
+        throw std::logic_error("Pricer does not expose differentiable payoffs.");
+    }
+
+    // Streaming protocol: the statistics the pricer needs (PathStatistic flags). With anything but
+    // FullPath the engine does not store the paths and calls process_statistics instead.
+    // The Greeks are rebuilt from the whole paths.
+    virtual unsigned required_statistics() const { return PathStatistic::FullPath; }
+    virtual void process_statistics(const PathStatistics& stats, std::size_t slot)
+    {
+        throw std::logic_error("Pricer does not support streaming statistics.");
+    }
+
+protected:
+    double call_payoff(double S) const { return m_vanilla ? std::max(S - m_strike, 0.0) : m_callPayoff(S); }
+    double put_payoff(double S) const { return m_vanilla ? std::max(m_strike - S, 0.0) : m_putPayoff(S); }
+
+    // Adds nPaths paths to the accumulators of the slot, sample(p) returning the PathSample of path p.
+    // The two paths of an antithetic pair (p, p + nPaths / 2) are averaged first and count as one sample
+    template <typename Samples>
+    void accumulate(std::size_t slot, std::size_t nPaths, bool antithetic, Samples&& sample)
+    {
+        PartialSums& partial = m_partials[slot];
+        ControlPartials& moments = m_controlPartials[slot];
+        std::size_t k = m_controls.size();
+        std::size_t nSamples = antithetic ? nPaths / 2 : nPaths;
+        for (std::size_t p = 0; p < nSamples; ++p)
+        {
+            std::array<double, MaxControls> callX{}, putX{};
+            PathSample s = sample(p);
+            control_values(s, callX, putX);
+            if (antithetic)
+            { // Controls are averaged over the pair, as the payoffs
+                std::array<double, MaxControls> mirrorCallX{}, mirrorPutX{};
+                PathSample mirror = sample(p + nSamples);
+                control_values(mirror, mirrorCallX, mirrorPutX);
+                s.call = 0.5 * (s.call + mirror.call);
+                s.put = 0.5 * (s.put + mirror.put);
+                for (std::size_t i = 0; i < k; ++i)
+                {
+                    callX[i] = 0.5 * (callX[i] + mirrorCallX[i]);
+                    putX[i] = 0.5 * (putX[i] + mirrorPutX[i]);
+                }
+            }
+
+            partial.callSum += s.call;
+            partial.putSum += s.put;
+            moments.call.add(s.call, callX.data(), k);
+            moments.put.add(s.put, putX.data(), k);
+        }
+        partial.count += nSamples;
+    }
+
+    // Undiscounted Greek samples of a path (vanilla payoffs on m_strike)
+    virtual GreekSample greek_sample(const PathTangents& tangents) const
+    {
+        throw std::logic_error("Pricer does not support Greeks.");
+    }
+
+    // Adds the Greek samples of every path of a block to the moments of the slot (pairs averaged as in accumulate)
+    void accumulate_greeks(std::size_t slot, const PathBlock& block)
+    {
+        if (!m_greeks)
+            return;
+
+        GreekPartials& moments = m_greekPartials[slot];
+        std::size_t nSamples = block.samples();
+        for (std::size_t p = 0; p < nSamples; ++p)
+        {
+            GreekSample s = greek_sample(path_tangents(block, p, m_greekModel));
+            if (block.antithetic)
+            {
+                GreekSample mirror = greek_sample(path_tangents(block, p + nSamples, m_greekModel));
+                for (std::size_t g = 0; g < NGreeks; ++g)
+                {
+                    s.call[g] = 0.5 * (s.call[g] + mirror.call[g]);
+                    s.put[g] = 0.5 * (s.put[g] + mirror.put[g]);
+                }
+            }
+
+            for (std::size_t g = 0; g < NGreeks; ++g)
+            {
+                moments.call[g].add(s.call[g], nullptr, 0);
+                moments.put[g].add(s.put[g], nullptr, 0);
+            }
+        }
+    }
+
+    // Same as accumulate for a secondary partial sum, payoffs(p) returning the {call, put} payoffs of path p
+    template <typename Payoffs>
+    static void accumulate_sums(PartialSums& partial, std::size_t nPaths, bool antithetic, Payoffs&& payoffs)
+    {
+        if (!antithetic)
+        {
+            for (std::size_t p = 0; p < nPaths; ++p)
+            {
+                auto [call, put] = payoffs(p);
+                partial.callSum += call;
+                partial.putSum += put;
+            }
+            partial.count += nPaths;
+            return;
+        }
+
+        std::size_t nPairs = nPaths / 2;
+        for (std::size_t p = 0; p < nPairs; ++p)
+        {
+            auto [call, put] = payoffs(p);
+            auto [mirrorCall, mirrorPut] = payoffs(p + nPairs);
+            partial.callSum += 0.5 * (call + mirrorCall);
+            partial.putSum += 0.5 * (put + mirrorPut);
+        }
+        partial.count += nPairs;
+    }
+
+    // Merge the partial sums in slot order: the result does not depend on which thread filled which slot
+    void merge()
+    {
+        m_callSum = 0.0;
+        m_putSum = 0.0;
+        m_NSim = 0;
+        for (const PartialSums& partial : m_partials)
+        {
+            m_callSum += partial.callSum;
+            m_putSum += partial.putSum;
+            m_NSim += partial.count;
+        }
+
+        m_callMoments = ControlMoments{};
+        m_putMoments = ControlMoments{};
+        for (const ControlPartials& moments : m_controlPartials)
+        {
+            m_callMoments.merge(moments.call, m_controls.size());
+            m_putMoments.merge(moments.put, m_controls.size());
+        }
+
+        m_callGreekMoments = {};
+        m_putGreekMoments = {};
+        for (const GreekPartials& moments : m_greekPartials)
+        {
+            for (std::size_t g = 0; g < NGreeks; ++g)
+            {
+                m_callGreekMoments[g].merge(moments.call[g], 0);
+                m_putGreekMoments[g].merge(moments.put[g], 0);
+            }
+        }
+    }
+
+    // Standard errors, and control variate estimates in place of the plain prices (already discounted)
+    void apply_estimates()
+    {
+        m_plainCallPrice = m_callPrice;
+        m_plainPutPrice = m_putPrice;
+        m_callReduction = 1.0;
+        m_putReduction = 1.0;
+        m_callError = 0.0;
+        m_putError = 0.0;
+        if (m_NSim < 2)
+            return;
+
+        double discount = m_discounter();
+        if (m_greeks)
+        {
+            for (std::size_t g = 0; g < NGreeks; ++g)
+            {
+                ControlMoments::Estimate call = m_callGreekMoments[g].estimate(nullptr, 0);
+                ControlMoments::Estimate put = m_putGreekMoments[g].estimate(nullptr, 0);
+                m_callGreeks[g] = discount * call.mean;
+                m_putGreeks[g] = discount * put.mean;
+                m_callGreekErrors[g] = discount * std::sqrt(call.variance / m_NSim);
+                m_putGreekErrors[g] = discount * std::sqrt(put.variance / m_NSim);
+            }
+        }
+
+        auto [callMeans, putMeans] = control_means(discount);
+        ControlMoments::Estimate call = m_callMoments.estimate(callMeans.data(), m_controls.size());
+        ControlMoments::Estimate put = m_putMoments.estimate(putMeans.data(), m_controls.size());
+        m_callError = discount * std::sqrt(call.variance / m_NSim);
+        m_putError = discount * std::sqrt(put.variance / m_NSim);
+        if (m_controls.empty())
+            return;
+
+        m_callPrice = discount * call.mean;
+        m_putPrice = discount * put.mean;
+        m_callReduction = call.reduction;
+        m_putReduction = put.reduction;
+    }
+
+    void display_statistics() const
+    {
+        Interface::instance()->display_standard_errors(m_callError, m_putError, m_quasiRandom);
+        if (!m_controls.empty())
+            Interface::instance()->display_control_variates(m_plainCallPrice, m_plainPutPrice, m_callReduction, m_putReduction);
+        if (m_greeks)
+            Interface::instance()->display_greeks(m_callGreeks, m_putGreeks, m_callGreekErrors, m_putGreekErrors, m_quasiRandom);
+    }
+
+private:
+    // Undiscounted expectations of the controls, as the moments are
+    std::pair<std::array<double, MaxControls>, std::array<double, MaxControls>> control_means(double discount) const
+    {
+        std::array<double, MaxControls> callMeans{}, putMeans{};
+        for (std::size_t i = 0; i < m_controls.size(); ++i)
+        {
+            callMeans[i] = m_controls[i].callMean / discount;
+            putMeans[i] = m_controls[i].putMean / discount;
+        }
+
+        return { callMeans, putMeans };
+    }
+
+    // Value of every control for the call and for the put
+    void control_values(const PathSample& s, std::array<double, MaxControls>& callX, std::array<double, MaxControls>& putX) const
+    {
+        for (std::size_t i = 0; i < m_controls.size(); ++i)
+        {
+            const ControlVariate& control = m_controls[i];
+            switch (control.kind)
+            {
+            case ControlVariate::Kind::Terminal:
+                callX[i] = putX[i] = s.terminal;
+                break;
+            case ControlVariate::Kind::VanillaTerminal:
+                callX[i] = std::max(s.terminal - control.strike, 0.0);
+                putX[i] = std::max(control.strike - s.terminal, 0.0);
+                break;
+            case ControlVariate::Kind::GeometricAverage:
+                callX[i] = std::max(s.geometric - control.strike, 0.0);
+                putX[i] = std::max(control.strike - s.geometric, 0.0);
+                break;
+            }
+        }
+    }
+
 protected:
     PayoffFunc m_callPayoff;
     PayoffFunc m_putPayoff;
@@ -35,6 +409,31 @@ protected:
     double m_putPrice;
     double m_callSum;
     double m_putSum;
-    std::atomic_size_t m_NSim; // Atomic to prevent data races
-    std::mutex m_mutex;
-};
\ No newline at end of file
+    std::size_t m_NSim;
+    bool m_display;
+    bool m_quasiRandom;
+    bool m_vanilla;                      // Payoffs are the vanilla ones on m_strike
+    double m_strike;
+    std::vector<PartialSums> m_partials; // One accumulator per slot, written without synchronization
+    std::vector<ControlVariate> m_controls;
+    std::vector<ControlPartials> m_controlPartials; // Moments of the payoffs and of the controls, one per slot
+    ControlMoments m_callMoments;        // Merged moments
+    ControlMoments m_putMoments;
+    ControlMoments m_runningCall;        // Moments of the slots merged so far (adaptive runs)
+    ControlMoments m_runningPut;
+    double m_plainCallPrice;
+    double m_plainPutPrice;
+    double m_callReduction;
+    double m_putReduction;
+    double m_callError;
+    double m_putError;
+    bool m_greeks;                       // Greeks estimated next to the prices
+    GreekModel m_greekModel;
+    std::vector<GreekPartials> m_greekPartials; // Moments of the Greek samples, one per slot
+    std::array<ControlMoments, NGreeks> m_callGreekMoments; // Merged moments
+    std::array<ControlMoments, NGreeks> m_putGreekMoments;
+    std::array<double, NGreeks> m_callGreeks;
+    std::array<double, NGreeks> m_putGreeks;
+    std::array<double, NGreeks> m_callGreekErrors;
+    std::array<double, NGreeks> m_putGreekErrors;
+};
@@ -1,13 +1,16 @@
 // PricerDerived.hpp
 // 
 // Pricers used to calculate the price of an option based on the paths generated by the simulation
-// Currently supports European, Barrier and Asian options
+// Currently supports European, Barrier and Asian options, portfolios of them priced off the same paths
+// and strike grids of European or Asian options
 // 
 // Pierre-Yves Sojic
 //
 
 #pragma once
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "PricerAbstract.hpp"
@@ -15,31 +18,51 @@
 
 //--------------European Option-----------------
 
-class EuropeanPricer : public PricerAbstract
+class EuropeanPricer final : public PricerAbstract
 {
 public:
     EuropeanPricer(const PayoffFunc& callpayoff, const PayoffFunc& putpayoff, const DiscounterFunc& discounter, std::size_t nSim);
-
-    void process_path(const std::vector<double>& path) override;
+    EuropeanPricer(double strike, const DiscounterFunc& discounter, std::size_t nSim);
+
+    void process_path(const std::vector<double>& path, std::size_t slot) override;
+    void process_block(const PathBlock& block, std::size_t slot) override;
+    void payoffs(const PathBlock& block, std::span<double> calls, std::span<double> puts) const override;
+    std::pair<aad::Real, aad::Real> adjoint_payoffs(std::span<const aad::Real> path) const override;
+    unsigned required_statistics() const override;
+    void process_statistics(const PathStatistics& stats, std::size_t slot) override;
     void post_process(double duration) override;
+
+private:
+    GreekSample greek_sample(const PathTangents& tangents) const override; // Pathwise, LR-pathwise gamma
 };
 
 //--------------Asian Option-----------------
 
-class AsianPricer : public PricerAbstract
+class AsianPricer final : public PricerAbstract
 { // e.g. arithmetic Asian average of the asset price taken on a set of observations (fixings) of the asset price
 public:
     AsianPricer(const PayoffFunc& callpayoff, const PayoffFunc& putpayoff, const DiscounterFunc& discounter, std::size_t nSim);
-
-    void process_path(const std::vector<double>& path) override;
+    AsianPricer(double strike, const DiscounterFunc& discounter, std::size_t nSim);
+
+    void prepare(std::size_t nSlots) override;
+    void truncate(std::size_t nSlots) override;
+    void process_path(const std::vector<double>& path, std::size_t slot) override;
+    void process_block(const PathBlock& block, std::size_t slot) override;
+    void payoffs(const PathBlock& block, std::span<double> calls, std::span<double> puts) const override;
+    std::pair<aad::Real, aad::Real> adjoint_payoffs(std::span<const aad::Real> path) const override;
+    unsigned required_statistics() const override;
+    void process_statistics(const PathStatistics& stats, std::size_t slot) override;
     void post_process(double duration) override;
+    bool supports_control(ControlVariate::Kind kind) const override;
 
 private:
+    GreekSample greek_sample(const PathTangents& tangents) const override; // Pathwise, LR-pathwise gamma
     double Average(const std::vector<double>& path);
     double GeometricAverage(const std::vector<double>& path);
     double Max(const std::vector<double>& path);
 
 private:
+    std::vector<PartialSums> m_geomPartials; // Geometric average sums, one per slot
     double m_geom_callSum;
     double m_geom_putSum;
     double m_geom_callPrice;
@@ -48,7 +71,7 @@ private:
 
 //--------------Barrier Option-----------------
 
-class BarrierPricer : public PricerAbstract
+class BarrierPricer final : public PricerAbstract
 {
 public:
     enum class BarrierType
@@ -61,13 +84,114 @@ public:
 
 public:
     BarrierPricer(const PayoffFunc& callpayoff, const PayoffFunc& putpayoff, const DiscounterFunc& discounter, std::size_t nSim);
+    BarrierPricer(double strike, const DiscounterFunc& discounter, std::size_t nSim);
 
-    void process_path(const std::vector<double>& path) override;
+    void process_path(const std::vector<double>& path, std::size_t slot) override;
+    void process_block(const PathBlock& block, std::size_t slot) override;
+    void payoffs(const PathBlock& block, std::span<double> calls, std::span<double> puts) const override;
+    unsigned required_statistics() const override;
+    void process_statistics(const PathStatistics& stats, std::size_t slot) override;
     void post_process(double duration) override;
     void set_barrier_type(BarrierType barrierType);
     void set_barrier_amount(double barrierAmount);
 
+private:
+    bool is_active(double min, double max) const; // Whether the barrier condition holds on the path
+    GreekSample greek_sample(const PathTangents& tangents) const override; // Likelihood ratio (discontinuous payoff)
+
 private:
     BarrierType m_barrierType; // Type of barrier options
     double m_barrierAmount;    // The dollar amount of the barrier
 };
+
+//--------------Portfolio-----------------
+
+class PortfolioPricer final : public PricerAbstract
+{ // Contracts (European, Asian, Barrier with their own strikes, barriers, controls...) priced off one set
+  // of paths, each with its own accumulators. The statistics the contracts need are computed once per
+  // block of paths and each contract then evaluates its payoffs over the block.
+public:
+    PortfolioPricer(const DiscounterFunc& discounter, std::size_t nSim);
+
+    void add_contract(const std::shared_ptr<PricerAbstract>& contract, const std::string& label);
+    std::size_t size() const;                                           // Number of contracts
+    const PricerAbstract& contract(std::size_t i) const;
+
+    void prepare(std::size_t nSlots) override;
+    double merge_slot(std::size_t slot) override;                       // Largest standard error of all the contracts
+    void truncate(std::size_t nSlots) override;
+    void process_path(const std::vector<double>& path, std::size_t slot) override;
+    void process_block(const PathBlock& block, std::size_t slot) override;
+    unsigned required_statistics() const override;                      // Union of the contracts' statistics
+    void process_statistics(const PathStatistics& stats, std::size_t slot) override;
+    void post_process(double duration) override;                        // Prices are the sums over the contracts
+    bool supports_control(ControlVariate::Kind kind) const override;    // Controls are set on the contracts
+
+private:
+    std::vector<std::shared_ptr<PricerAbstract>> m_contracts;
+    std::vector<std::string> m_labels;
+    std::vector<bool> m_fullPath;   // Contracts that need the whole paths
+    unsigned m_statistics;          // Statistics needed by the other contracts
+};
+
+//--------------Strike Grid-----------------
+
+class StrikeGridPricer final : public PricerAbstract
+{ // Vanilla calls and puts on a sorted grid of strikes, on S_T (European) or on the average (Asian).
+  // Each path value is binned by the strikes around it (binary search): per bin moments are enough to
+  // rebuild the sums and sums of squares of the payoffs of every strike, once at the end of the run.
+public:
+    enum class Underlying
+    {
+        Terminal = 1,   // European
+        Average         // Arithmetic average Asian
+    };
+
+public:
+    StrikeGridPricer(const std::vector<double>& strikes, Underlying underlying, const DiscounterFunc& discounter, std::size_t nSim);
+
+    const std::vector<double>& strikes() const;
+    const std::vector<double>& call_prices() const;     // One price per strike (discounted)
+    const std::vector<double>& put_prices() const;
+    const std::vector<double>& call_errors() const;     // Standard errors
+    const std::vector<double>& put_errors() const;
+
+    void prepare(std::size_t nSlots) override;
+    double merge_slot(std::size_t slot) override;       // Largest standard error over the grid
+    void truncate(std::size_t nSlots) override;
+    void process_path(const std::vector<double>& path, std::size_t slot) override;
+    void process_block(const PathBlock& block, std::size_t slot) override;
+    unsigned required_statistics() const override;
+    void process_statistics(const PathStatistics& stats, std::size_t slot) override;
+    void post_process(double duration) override;
+    bool supports_control(ControlVariate::Kind kind) const override;
+
+private:
+    struct Bin
+    { // Path values X between two consecutive strikes
+        double count;
+        double sum;             // Sum of X
+        double sumSq;           // Sum of X^2
+        // Antithetic pairs, binned by the smaller value (calls) or by the larger one (puts)
+        double callPairs;
+        double callPairSum;     // Sum of X1 + X2
+        double callPairProduct; // Sum of X1 X2
+        double putPairs;
+        double putPairSum;
+        double putPairProduct;
+    };
+
+    std::size_t bin(double x) const;                    // Number of strikes below x
+    void add(std::size_t slot, std::size_t nPaths, bool antithetic, const double* values);
+    void estimate(const std::vector<Bin>& bins, std::size_t nSamples);
+
+private:
+    std::vector<double> m_strikes;
+    Underlying m_underlying;
+    std::vector<std::vector<Bin>> m_bins;   // Bins of every slot
+    std::vector<Bin> m_runningBins;         // Bins of the slots merged so far (adaptive runs)
+    std::vector<double> m_callPrices;
+    std::vector<double> m_putPrices;
+    std::vector<double> m_callErrors;
+    std::vector<double> m_putErrors;
+};
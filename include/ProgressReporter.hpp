@@ -0,0 +1,75 @@
+// ProgressReporter.hpp
+// 
+// Progress of a run, reported off the simulation hot path. Each worker counts its own simulations
+// in a relaxed counter on its own cache line (a single uncontended store per path or block), and a
+// reporter thread samples the counters at a fixed interval: simulations done, simulations/sec and ETA
+// go to a callback, the console line by default (or e.g. a job dashboard).
+// 
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct ProgressSnapshot
+{
+    std::size_t done;       // Simulations done so far
+    std::size_t total;      // Simulations of the run (cap of an adaptive run)
+    double elapsed;         // Seconds since the start of the run
+    double rate;            // Simulations per second since the start of the run
+    double eta;             // Seconds left at the current rate
+    bool finished;          // Last report of the run
+};
+
+class ProgressReporter
+{
+public:
+    using Callback = std::function<void(const ProgressSnapshot&)>;
+    using Interval = std::chrono::milliseconds;
+
+public:
+    ProgressReporter(std::size_t total, std::size_t nThreads, Interval interval, Callback callback);
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+    ~ProgressReporter();                            // Stops the reporter (see stop())
+
+    // Hot path: only thread 'thread' writes its counter, no read-modify-write needed
+    void add(std::size_t thread, std::size_t n)
+    {
+        std::atomic_size_t& counter = m_counters[thread].value;
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void stop();                                    // Joins the reporter and sends the last report (once the workers are done)
+    ProgressSnapshot snapshot(bool finished = false) const;
+
+    static Callback console();                      // Overwrites a single console line
+
+private:
+    struct alignas(64) Counter
+    {
+        std::atomic_size_t value{};
+    };
+
+    void run(std::stop_token token);
+
+private:
+    std::size_t m_total;
+    std::size_t m_nThreads;
+    Interval m_interval;
+    Callback m_callback;
+    std::unique_ptr<Counter[]> m_counters;          // One per worker thread
+    std::chrono::steady_clock::time_point m_start;
+    std::mutex m_mutex;
+    std::condition_variable_any m_wakeUp;           // Interrupted by stop()
+    std::jthread m_reporter;
+    bool m_stopped;
+};
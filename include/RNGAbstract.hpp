@@ -7,8 +7,31 @@
 
 #pragma once
 
+#include <cstdint>
+#include <span>
+
 class RNGAbstract
 {
 public:
+    virtual ~RNGAbstract() = default;
+
     virtual double generate_rn() const = 0;
+
+    // Fill a whole block with standard normals in a single call.
+    // The default falls back on one generate_rn() per draw, derived classes override it.
+    virtual void fill(std::span<double> normals) const
+    {
+        for (double& z : normals)
+        {
+            z = generate_rn();
+        }
+    }
+
+    // Position the calling thread on draw 'offset' of stream 'stream' (e.g. the index of the path).
+    // Only counter-based generators can honour it; sequential engines ignore it.
+    virtual void seek(std::uint64_t stream, std::uint64_t offset = 0) const {}
+
+    // Low-discrepancy sequences put their best coordinates first: the paths should then
+    // be built with a Brownian bridge
+    virtual bool low_discrepancy() const { return false; }
 };
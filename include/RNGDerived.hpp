@@ -1,21 +1,29 @@
 // RNGDerived.hpp
 // 
 // Derived classes for Random Numbers Generators
-// Currently supports Mersenne Twister, Polar Marsaglia and Box-Muller
+// Currently supports Mersenne Twister, Polar Marsaglia, Box-Muller, Philox (counter-based)
+// and Sobol (quasi-random)
 //
 // Pierre-Yves Sojic
 //
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <random>
+#include <vector>
 
 #include "RNGAbstract.hpp"
 
-class MersenneTwister : public RNGAbstract
+// Inverse of the standard normal CDF (Acklam's rational approximation, relative error about 1e-9)
+double inverse_normal_cdf(double p);
+
+class MersenneTwister final : public RNGAbstract
 {
 public:
     double generate_rn() const override;
+    void fill(std::span<double> normals) const override;
 
 private:
     // We use a static thread local random engine to enforce 1 engine per thread
@@ -23,20 +31,103 @@ private:
     static thread_local std::mt19937_64 m_randomEngine;
 };
 
-class PolarMarsagliaNet : public RNGAbstract
+class PolarMarsagliaNet final : public RNGAbstract
 {
 public:
     double generate_rn() const override;
+    void fill(std::span<double> normals) const override;
 
 private:
     static thread_local std::default_random_engine m_randomEngine;
 };
 
-class BoxMuller : public RNGAbstract
+class BoxMuller final : public RNGAbstract
 {
 public:
     double generate_rn() const override;
+    void fill(std::span<double> normals) const override;
 
 private:
     static thread_local std::default_random_engine m_randomEngine;
-};
\ No newline at end of file
+};
+
+class Philox final : public RNGAbstract
+{ // Counter-based Philox4x32-10 generator (Salmon et al., 2011).
+  // Draw n of stream s is a pure function of (seed, s, n): any path can be regenerated
+  // from any thread, chunk or process, and skipping ahead is O(1).
+public:
+    using Block = std::array<std::uint32_t, 4>;
+    using Key = std::array<std::uint32_t, 2>;
+
+public:
+    explicit Philox(std::uint64_t seed = 0);
+
+    double generate_rn() const override;
+    void fill(std::span<double> normals) const override;
+    void seek(std::uint64_t stream, std::uint64_t offset = 0) const override;
+
+    std::uint64_t seed() const;
+
+    static Block bijection(Block counter, Key key); // The 10 rounds of Philox4x32
+
+private:
+    void uniform_pair(std::uint64_t stream, std::uint64_t pair, double& U1, double& U2) const;
+    void normal_pair(std::uint64_t stream, std::uint64_t pair, double& z0, double& z1) const;
+
+private:
+    std::uint64_t m_seed;
+    // Position of the calling thread: one stream per thread at any time
+    static thread_local std::uint64_t m_stream;
+    static thread_local std::uint64_t m_position;
+};
+
+class Sobol final : public RNGAbstract
+{ // Sobol low-discrepancy sequence mapped to normals through the inverse normal CDF.
+  // Stream (path) i reads point i of the sequence (Gray code order, point i + 1 without scrambling
+  // as point 0 is the origin), coordinate d gives its d-th normal.
+  // Primitive polynomials are enumerated by degree so any dimension is available, the first 1111 dimensions
+  // using the initial direction numbers of Joe and Kuo (see SobolTable.hpp), and the
+  // points can be scrambled (random digital shift or hash-based Owen scrambling) so that
+  // independent seeds give independent replications.
+public:
+    enum class Scrambling
+    {
+        None,
+        DigitalShift,
+        Owen
+    };
+
+public:
+    Sobol(std::size_t dimension, Scrambling scrambling = Scrambling::Owen, std::uint64_t seed = 0);
+
+    double generate_rn() const override;
+    void fill(std::span<double> normals) const override;
+    void seek(std::uint64_t stream, std::uint64_t offset = 0) const override;
+    bool low_discrepancy() const override { return true; }
+
+    std::size_t dimension() const;
+
+private:
+    static constexpr int Bits = 32;
+
+    struct Cursor
+    { // Point currently read by the calling thread
+        std::uint64_t owner = 0;        // Id of the Sobol instance the cursor belongs to
+        std::uint64_t index = 0;        // Index of the point
+        std::size_t position = 0;       // Next coordinate to read
+        std::vector<std::uint32_t> x;   // Unscrambled integer coordinates
+    };
+
+    Cursor& cursor() const;
+    void move_to(Cursor& c, std::uint64_t index) const;
+    std::uint64_t first_point() const;
+    double normal(const Cursor& c, std::size_t d) const;
+
+private:
+    std::size_t m_dimension;
+    Scrambling m_scrambling;
+    std::uint64_t m_id;                         // Unique id, used to invalidate the thread cursors
+    std::vector<std::uint32_t> m_directions;    // Bits direction numbers per dimension
+    std::vector<std::uint32_t> m_scramble;      // Shift or Owen seed per dimension
+    static thread_local Cursor m_cursor;
+};
@@ -0,0 +1,143 @@
+// RNGPipeline.hpp
+// 
+// Producer/consumer pipeline of random normals: generator threads fill tiles of normals
+// (cache-sized blocks, laid out as the stepping workers consume them) into lock-free
+// single-producer/single-consumer rings, one ring per stepping worker.
+// A full ring blocks its generator (backpressure), an empty one its worker: both waits are
+// counted, so that the number of generator and stepper threads can be balanced.
+// 
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+template <typename T>
+class SPSCRing
+{ // Ring of preallocated slots, filled and read in place by a single producer and a single consumer
+public:
+    SPSCRing(std::size_t capacity, const T& prototype); // Capacity rounded up to a power of two
+
+    T* try_back();                                      // Producer: free slot, nullptr if the ring is full
+    T* back(std::size_t& stalls, std::stop_token token = {}); // Producer: waits for a free slot (nullptr if stopped)
+    void push();                                        // Producer: publishes the slot
+    T* try_front();                                     // Consumer: oldest slot, nullptr if the ring is empty
+    T* front(std::size_t& starvations);                 // Consumer: waits for a slot
+    void pop();                                         // Consumer: releases the slot
+    std::size_t size() const;                           // Slots in use (approximate while the other side runs)
+    std::size_t capacity() const;
+
+private:
+    std::vector<T> m_slots;
+    std::size_t m_mask;
+    alignas(64) std::atomic_size_t m_head;  // Next slot to read, written by the consumer
+    std::size_t m_cachedTail;               // Consumer's copy of the tail
+    alignas(64) std::atomic_size_t m_tail;  // Next slot to write, written by the producer
+    std::size_t m_cachedHead;               // Producer's copy of the head
+};
+
+struct NormalTile
+{ // Normals of a group of paths over a range of time steps, structure of arrays
+    std::size_t chunk;                      // Chunk the tile belongs to (>= number of chunks: end of the run)
+    std::vector<double> normals;
+};
+
+struct PipelineStats
+{ // Balance of the last pipelined run
+    std::size_t generators{};
+    std::size_t steppers{};
+    std::size_t tiles{};                    // Tiles handed over to the steppers
+    std::size_t starved{};                  // Waits of the steppers on an empty ring (generators too slow)
+    std::size_t stalled{};                  // Waits of the generators on a full ring (steppers too slow)
+};
+
+//------------Implementations------------
+
+template <typename T>
+SPSCRing<T>::SPSCRing(std::size_t capacity, const T& prototype)
+    : m_slots(std::bit_ceil(std::max<std::size_t>(capacity, 2)), prototype), m_mask{ m_slots.size() - 1 },
+    m_head{}, m_cachedTail{}, m_tail{}, m_cachedHead{}
+{}
+
+template <typename T>
+T* SPSCRing<T>::try_back()
+{
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cachedHead == m_slots.size())
+    {
+        m_cachedHead = m_head.load(std::memory_order_acquire);
+        if (tail - m_cachedHead == m_slots.size())
+            return nullptr;
+    }
+    return &m_slots[tail & m_mask];
+}
+
+template <typename T>
+T* SPSCRing<T>::back(std::size_t& stalls, std::stop_token token)
+{
+    T* slot = try_back();
+    if (!slot)
+    {
+        ++stalls;
+        while (!(slot = try_back()) && !token.stop_requested())
+            std::this_thread::yield();
+    }
+    return slot;
+}
+
+template <typename T>
+void SPSCRing<T>::push()
+{
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename T>
+T* SPSCRing<T>::try_front()
+{
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cachedTail)
+    {
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        if (head == m_cachedTail)
+            return nullptr;
+    }
+    return &m_slots[head & m_mask];
+}
+
+template <typename T>
+T* SPSCRing<T>::front(std::size_t& starvations)
+{
+    T* slot = try_front();
+    if (!slot)
+    {
+        ++starvations;
+        while (!(slot = try_front()))
+            std::this_thread::yield();
+    }
+    return slot;
+}
+
+template <typename T>
+void SPSCRing<T>::pop()
+{
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename T>
+std::size_t SPSCRing<T>::size() const
+{
+    return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+std::size_t SPSCRing<T>::capacity() const
+{
+    return m_slots.size();
+}
@@ -11,6 +11,7 @@
 #include "OptionData.hpp"
 #include <random>
 #include <iostream>
+#include <span>
 
 // Interface contract specification
 
@@ -56,6 +57,37 @@ concept IReaction = requires (SDE c, double S, double t)
     c.reaction(S, t);
 };
 
+template<typename SDE>
+concept IDriftCorrected = requires (SDE c, double S, double t, double B)
+{
+    c.drift_corrected(S, t, B);
+};
+
+template<typename SDE>
+concept IDiffusionDerivative = requires (SDE c, double S)
+{
+    c.diffusion_derivative(S);
+};
+
+template<typename SDE>
+concept IEulerBlock = requires (SDE c, std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt)
+{
+    c.euler_block(x, z, next, t, dt);
+};
+
+template<typename SDE>
+concept IMilsteinBlock = requires (SDE c, std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt)
+{
+    c.milstein_block(x, z, next, t, dt);
+};
+
+template<typename SDE>
+concept IAdjointModel = requires (SDE c, double S, double t, ModelInputs<double> inputs)
+{
+    c.drift(S, t, inputs);
+    c.diffusion(S, t, inputs);
+};
+
 template<typename SDE>
     requires IExpiry<SDE>
 class SDEBase
@@ -73,8 +105,19 @@ public:
     double convection(double S, double t) const requires IConvection<SDE>; // Convection term
     double reaction(double S, double t) const requires IReaction<SDE>; // Reaction term
 
-    double drift_corrected(double S, double t, double B) const requires IDrift<SDE>; 
-    double diffusion_derivative(double S) const requires IDiffusion<SDE>;
+    double drift_corrected(double S, double t, double B) const requires IDriftCorrected<SDE>; // Drift - B * diffusion * d(diffusion)/dS
+    double diffusion_derivative(double S) const requires IDiffusionDerivative<SDE>; // d(diffusion)/dS
+
+    // Euler step of a whole block of paths at once (vectorised)
+    void euler_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const requires IEulerBlock<SDE>;
+    // Milstein step of a whole block of paths at once
+    void milstein_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const requires IMilsteinBlock<SDE>;
+
+    // Drift and diffusion in terms of explicit model inputs of any number type (adjoint sensitivities)
+    template <typename Real>
+    Real drift(const Real& S, double t, const ModelInputs<Real>& inputs) const requires IAdjointModel<SDE>;
+    template <typename Real>
+    Real diffusion(const Real& S, double t, const ModelInputs<Real>& inputs) const requires IAdjointModel<SDE>;
 
 private:
     SDE m_SDE;
@@ -145,15 +188,49 @@ double SDEBase<SDE>::reaction(double S, double t) const
 template <typename SDE>
     requires IExpiry<SDE>
 double SDEBase<SDE>::drift_corrected(double S, double t, double B) const
-    requires IDrift<SDE>
+    requires IDriftCorrected<SDE>
 {
-    return m_SDE.drift_corrected(S, t);
+    return m_SDE.drift_corrected(S, t, B);
 }
 
 template <typename SDE>
     requires IExpiry<SDE>
 double SDEBase<SDE>::diffusion_derivative(double S) const
-    requires IDiffusion<SDE>
+    requires IDiffusionDerivative<SDE>
+{
+    return m_SDE.diffusion_derivative(S);
+}
+
+template <typename SDE>
+    requires IExpiry<SDE>
+void SDEBase<SDE>::euler_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const
+    requires IEulerBlock<SDE>
+{
+    m_SDE.euler_block(x, z, next, t, dt);
+}
+
+template <typename SDE>
+    requires IExpiry<SDE>
+void SDEBase<SDE>::milstein_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const
+    requires IMilsteinBlock<SDE>
+{
+    m_SDE.milstein_block(x, z, next, t, dt);
+}
+
+template <typename SDE>
+    requires IExpiry<SDE>
+template <typename Real>
+Real SDEBase<SDE>::drift(const Real& S, double t, const ModelInputs<Real>& inputs) const
+    requires IAdjointModel<SDE>
+{
+    return m_SDE.drift(S, t, inputs);
+}
+
+template <typename SDE>
+    requires IExpiry<SDE>
+template <typename Real>
+Real SDEBase<SDE>::diffusion(const Real& S, double t, const ModelInputs<Real>& inputs) const
+    requires IAdjointModel<SDE>
 {
-    return m_SDE.diffusion_derivative();
+    return m_SDE.diffusion(S, t, inputs);
 }
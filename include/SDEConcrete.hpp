@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <random>
+#include <span>
 
 #include "OptionData.hpp"
 #include "SDEBase.hpp"
@@ -30,6 +31,14 @@ public:
     double drift_corrected(double S, double t, double B) const;
     double diffusion_derivative(double S) const;
 
+    void euler_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const;
+
+    // Same terms on explicit model inputs (e.g. aad::Real for the adjoint sensitivities)
+    template <typename Real>
+    static Real drift(const Real& S, double t, const ModelInputs<Real>& inputs);
+    template <typename Real>
+    static Real diffusion(const Real& S, double t, const ModelInputs<Real>& inputs);
+
 private:
     std::shared_ptr<OptionData> m_data; // double data for the option
 };
@@ -49,6 +58,42 @@ public:
     double drift_corrected(double S, double t, double B) const;
     double diffusion_derivative(double S) const;
 
+    void euler_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const;
+    void milstein_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const; // One vector pow per block
+
+    // Same terms on explicit model inputs (e.g. aad::Real for the adjoint sensitivities)
+    template <typename Real>
+    static Real drift(const Real& S, double t, const ModelInputs<Real>& inputs);
+    template <typename Real>
+    static Real diffusion(const Real& S, double t, const ModelInputs<Real>& inputs);
+
 private:
     std::shared_ptr<OptionData> m_data; 
-};
\ No newline at end of file
+};
+
+//------------Implementations------------
+
+template <typename Real>
+Real GBM::drift(const Real& S, double t, const ModelInputs<Real>& inputs)
+{
+    return (inputs.r - inputs.q) * S;
+}
+
+template <typename Real>
+Real GBM::diffusion(const Real& S, double t, const ModelInputs<Real>& inputs)
+{
+    return inputs.vol * S;
+}
+
+template <typename Real>
+Real CEV::drift(const Real& S, double t, const ModelInputs<Real>& inputs)
+{
+    return (inputs.r - inputs.q) * S;
+}
+
+template <typename Real>
+Real CEV::diffusion(const Real& S, double t, const ModelInputs<Real>& inputs)
+{
+    using std::pow; // aad::pow found by argument-dependent lookup
+    return inputs.vol * pow(S, inputs.betaCEV);
+}
@@ -0,0 +1,34 @@
+// SIMDKernels.hpp
+//
+// Vectorised kernels used to advance a block of paths stored as a structure of arrays.
+// The instruction set (AVX-512, AVX2 or plain scalar code) is chosen at runtime from the
+// capabilities of the CPU, the code is portable to non-x86 targets.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace simd
+{
+    enum class ISA
+    {
+        Scalar,
+        AVX2,
+        AVX512
+    };
+
+    ISA detected_isa();         // Best instruction set supported by the CPU
+    ISA active_isa();           // Instruction set currently used by the kernels
+    void set_isa(ISA isa);      // Force an instruction set (capped to what the CPU supports)
+    const char* isa_name(ISA isa);
+
+    // Euler step of GBM: next = x + x * (a + b * z), with a = (r - q) dt and b = vol sqrt(dt)
+    void gbm_euler(const double* x, const double* z, double* next, std::size_t n, double a, double b);
+
+    // Euler step of CEV: next = x + a * x + c * x^beta * z, with a = (r - q) dt and c = vol sqrt(dt)
+    // (x^beta by simd::pow)
+    void cev_euler(const double* x, const double* z, double* next, std::size_t n, double a, double c, double beta);
+}
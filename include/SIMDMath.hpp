@@ -0,0 +1,35 @@
+// SIMDMath.hpp
+//
+// Vectorised elementary functions over arrays, on the instruction set selected in SIMDKernels.hpp
+// (AVX-512, AVX2, or the scalar libm calls).
+// Accuracy against libm: sqrt is correctly rounded, exp, log, pow and sincos are within 2 ulp
+// (measured: 1 ulp, 2 ulp for pow with large exponents, see the benchmark). Arguments outside the
+// range of the vector code (overflow, underflow, subnormals, infinities, NaN, |x| > 1e5 for sincos)
+// go through libm, element by element.
+// Every element goes through the same code whatever its position (the tails of the arrays are
+// padded), so a value always gives the same result.
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace simd
+{
+    // y[i] = exp(x[i]) (x and y may be the same array, as for all the functions below)
+    void exp(const double* x, double* y, std::size_t n);
+
+    // y[i] = log(x[i])
+    void log(const double* x, double* y, std::size_t n);
+
+    // y[i] = x[i]^e, the same exponent for every element
+    void pow(const double* x, double e, double* y, std::size_t n);
+
+    // y[i] = sqrt(x[i])
+    void sqrt(const double* x, double* y, std::size_t n);
+
+    // s[i] = sin(x[i]), c[i] = cos(x[i])
+    void sincos(const double* x, double* s, double* c, std::size_t n);
+}
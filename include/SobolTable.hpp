@@ -0,0 +1,24 @@
+// SobolTable.hpp
+//
+// Initial direction numbers m_1, ..., m_s of the Sobol sequence for the first dimensions, from the
+// new-joe-kuo-6.21201 table of S. Joe and F. Y. Kuo (Constructing Sobol sequences with better
+// two-dimensional projections, SIAM J. Sci. Comput. 30, 2635-2654, 2008). Dimension d >= 2 uses the
+// (d - 1)-th primitive polynomial in degree then coefficient order, s being its degree: the values
+// are stored back to back, dimension after dimension. The table stops at 1111 dimensions (every
+// polynomial up to degree 13).
+//
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sobol_table
+{
+    inline constexpr std::size_t Dimensions = 1111;    // The first dimension (van der Corput) included
+    inline constexpr std::size_t Values = 13223;       // Sum of the degrees of the 1110 polynomials
+
+    extern const std::uint16_t initial[Values];
+}
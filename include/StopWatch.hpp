@@ -83,18 +83,19 @@ private:
 };
 
 //-----------Implementation-----------
+// Inline: the header is included by several translation units (engine, batch runner)
 
 using Clock = std::chrono::high_resolution_clock;
 
-StopWatch::StopWatch()
+inline StopWatch::StopWatch()
 	: m_name{}, m_startTimePoint{ Clock::now() }, m_endTimePoint{ m_startTimePoint }, m_duration{}, m_isRunning{ false }
 {}
 
-StopWatch::StopWatch(const std::string& name)
+inline StopWatch::StopWatch(const std::string& name)
 	: m_name{name}, m_startTimePoint{ Clock::now() }, m_endTimePoint{ m_startTimePoint }, m_duration{}, m_isRunning{ false }
 {}
 
-void StopWatch::Start()
+inline void StopWatch::Start()
 {
 	if (!m_isRunning)
 	{
@@ -104,12 +105,12 @@ void StopWatch::Start()
 	// Does nothing if stopwatch is already running
 }
 
-void StopWatch::set_name(const std::string& name)
+inline void StopWatch::set_name(const std::string& name)
 {
 	m_name = name;
 }
 
-void StopWatch::Stop()
+inline void StopWatch::Stop()
 {
 	if (m_isRunning)
 	{
@@ -121,14 +122,14 @@ void StopWatch::Stop()
 	// Does nothing if stopwatch is not running
 }
 
-void StopWatch::Reset()
+inline void StopWatch::Reset()
 {
 	m_startTimePoint = Clock::now();
 	m_endTimePoint = m_startTimePoint;
 	m_duration = 0.0;
 }
 
-double StopWatch::GetTime() const
+inline double StopWatch::GetTime() const
 {
 	if (m_isRunning)
 	{
@@ -139,7 +140,7 @@ double StopWatch::GetTime() const
 	return m_duration;
 }
 
-void StopWatch::display_time() const
+inline void StopWatch::display_time() const
 {
 	std::cout << m_name << " - " << m_duration << "s\n";
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+// ThreadPool.hpp
+// 
+// Fixed set of worker threads pulling tasks from a shared FIFO queue.
+// Used to run independent simulations side by side (e.g. the jobs of a batch): the tasks
+// are started in submission order, so submitting the longest ones first balances the load.
+// 
+// Pierre-Yves Sojic
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+public:
+    explicit ThreadPool(std::size_t nThreads = 0);  // 0 = hardware concurrency
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();                                  // Finishes the queued tasks and joins the workers
+
+    void submit(Task task);
+    void wait();                                    // Blocks until every submitted task is done, rethrows the first exception
+    std::size_t size() const;                       // Number of worker threads
+
+private:
+    void worker();
+
+private:
+    std::vector<std::jthread> m_workers;
+    std::deque<Task> m_tasks;                       // Tasks not started yet
+    std::size_t m_active;                           // Tasks being run
+    bool m_stop;                                    // Set by the destructor
+    std::exception_ptr m_error;                     // First exception thrown by a task
+    std::mutex m_mutex;
+    std::condition_variable m_taskReady;            // Signals the workers
+    std::condition_variable m_idle;                 // Signals wait()
+};
@@ -0,0 +1,37 @@
+// AAD.cpp
+//
+// Implementation of AAD.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include "AAD.hpp"
+
+aad::Tape& aad::Tape::local()
+{
+	thread_local Tape tape;
+	return tape;
+}
+
+void aad::Tape::propagate(std::uint32_t result)
+{
+	m_adjoints.assign(m_nodes.size(), 0.0);
+	if (result == NoNode)
+		return; // Constant result: every adjoint is zero
+
+	// Nodes are recorded after their arguments: one sweep in reverse order is enough
+	m_adjoints[result] = 1.0;
+	for (std::size_t i = result + 1; i-- > 0;)
+	{
+		double adjoint = m_adjoints[i];
+		if (adjoint == 0.0)
+			continue;
+
+		const Node& node = m_nodes[i];
+		for (int k = 0; k < 2; ++k)
+		{
+			if (node.arg[k] != NoNode)
+				m_adjoints[node.arg[k]] += node.partial[k] * adjoint;
+		}
+	}
+}
@@ -0,0 +1,448 @@
+// BatchRunner.cpp
+//
+// Implementation of BatchRunner.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iomanip>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "BatchRunner.hpp"
+#include "MCDispatch.hpp"
+#include "SDEConcrete.hpp"
+#include "StopWatch.hpp"
+#include "ThreadPool.hpp"
+
+namespace
+{
+	using Fields = std::vector<std::pair<std::string, std::string>>;
+
+	std::string trim(const std::string& s)
+	{
+		std::size_t first = s.find_first_not_of(" \t\r");
+		if (first == std::string::npos)
+			return {};
+		std::size_t last = s.find_last_not_of(" \t\r");
+		return s.substr(first, last - first + 1);
+	}
+
+	std::string lower(std::string s)
+	{
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return s;
+	}
+
+	double to_number(const std::string& key, const std::string& value)
+	{
+		std::size_t end{};
+		double x{};
+		try
+		{
+			x = std::stod(value, &end);
+		}
+		catch (const std::exception&)
+		{
+			end = 0;
+		}
+		if (end == 0 || end != value.size())
+			throw std::invalid_argument("Invalid value '" + value + "' for " + key + ".");
+		return x;
+	}
+
+	// Non-negative integer, parsed as such: 64-bit seeds are kept exactly, values out of range are rejected
+	std::uint64_t to_count(const std::string& key, const std::string& value)
+	{
+		std::size_t end{};
+		unsigned long long x{};
+		try
+		{
+			if (value.front() != '-') // stoull would wrap negative values around
+				x = std::stoull(value, &end);
+		}
+		catch (const std::exception&)
+		{
+			end = 0;
+		}
+		if (end == 0 || end != value.size() || x > std::numeric_limits<std::uint64_t>::max())
+			throw std::invalid_argument("Invalid value '" + value + "' for " + key + ".");
+		return static_cast<std::uint64_t>(x);
+	}
+
+	void set_field(BatchJob& job, const std::string& key, const std::string& value)
+	{
+		if (key == "id") job.id = value;
+		else if (key == "model") job.model = lower(value);
+		else if (key == "scheme") job.scheme = lower(value);
+		else if (key == "rng") job.rng = lower(value);
+		else if (key == "pricer") job.pricer = lower(value);
+		else if (key == "barrier_type") job.barrierType = lower(value);
+		else if (key == "barrier") job.barrier = to_number(key, value);
+		else if (key == "S0") job.data.S0 = to_number(key, value);
+		else if (key == "K") job.data.K = to_number(key, value);
+		else if (key == "T") job.data.T = to_number(key, value);
+		else if (key == "r") job.data.r = to_number(key, value);
+		else if (key == "vol") job.data.vol = to_number(key, value);
+		else if (key == "q") job.data.q = to_number(key, value);
+		else if (key == "beta") job.data.betaCEV = to_number(key, value);
+		else if (key == "NT") job.NT = to_count(key, value);
+		else if (key == "paths") job.paths = to_count(key, value);
+		else if (key == "seed") job.seed = to_count(key, value);
+		else if (key == "antithetic") job.antithetic = to_count(key, value) != 0;
+		else if (key == "target_error") job.targetError = to_number(key, value);
+		else throw std::invalid_argument("Unknown key '" + key + "'.");
+	}
+
+	// Fills a job whose id is the line number by default, the id of the line being set first so that
+	// a job that fails validation is still reported under it
+	void make_job(BatchJob& job, const Fields& fields)
+	{
+		for (const auto& [key, value] : fields)
+		{
+			if (key == "id" && !value.empty())
+				job.id = value;
+		}
+		for (const auto& [key, value] : fields)
+		{
+			if (!value.empty())
+				set_field(job, key, value);
+		}
+
+		if (job.data.S0 <= 0.0 || job.data.T <= 0.0 || job.data.vol <= 0.0)
+			throw std::invalid_argument("S0, T and vol must be strictly positive.");
+		if (job.NT < 1 || job.paths < 1)
+			throw std::invalid_argument("NT and paths must be strictly positive integers.");
+		if (job.pricer == "barrier" && job.barrier <= 0.0)
+			throw std::invalid_argument("Barrier jobs need a strictly positive barrier.");
+	}
+
+	std::vector<std::string> split_csv(const std::string& line)
+	{
+		std::vector<std::string> cells;
+		std::istringstream in(line);
+		std::string cell;
+		while (std::getline(in, cell, ','))
+			cells.push_back(trim(cell));
+		if (!line.empty() && line.back() == ',')
+			cells.emplace_back();
+		return cells;
+	}
+
+	// Flat JSON object: string, number and boolean values
+	Fields parse_json(const std::string& line)
+	{
+		Fields fields;
+		std::size_t i = 0;
+		auto skip = [&]()
+			{
+				while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i])))
+					++i;
+			};
+		auto expect = [&](char c)
+			{
+				skip();
+				if (i >= line.size() || line[i] != c)
+					throw std::invalid_argument(std::string("Expected '") + c + "' in JSON object.");
+				++i;
+			};
+		auto string = [&]()
+			{
+				expect('"');
+				std::string s;
+				while (i < line.size() && line[i] != '"')
+				{
+					if (line[i] == '\\' && i + 1 < line.size())
+						++i;
+					s += line[i++];
+				}
+				expect('"');
+				return s;
+			};
+
+		expect('{');
+		skip();
+		if (i < line.size() && line[i] == '}')
+			return fields;
+
+		while (true)
+		{
+			std::string key = string();
+			expect(':');
+			skip();
+			std::string value;
+			if (i < line.size() && line[i] == '"')
+			{
+				value = string();
+			}
+			else
+			{
+				std::size_t end = line.find_first_of(",}", i);
+				value = trim(line.substr(i, end == std::string::npos ? std::string::npos : end - i));
+				i = end == std::string::npos ? line.size() : end;
+				if (value == "true") value = "1";
+				else if (value == "false") value = "0";
+			}
+			fields.emplace_back(key, value);
+
+			skip();
+			if (i < line.size() && line[i] == ',')
+			{
+				++i;
+				continue;
+			}
+			expect('}');
+			return fields;
+		}
+	}
+
+	// Quoted CSV field, the quotes doubled
+	std::string quoted(const std::string& s)
+	{
+		std::string field = "\"";
+		for (char c : s)
+			field += c == '"' ? std::string("\"\"") : std::string(1, c);
+		return field + '"';
+	}
+
+	template <typename SDE>
+	void price(const BatchJob& job, BatchResult& result)
+	{
+		auto od = std::make_shared<OptionData>(job.data);
+		SDEBase<SDE> sde{ SDE(od) };
+
+		std::unique_ptr<FDMAbstract<SDE>> fdm;
+		if (job.scheme == "euler")
+			fdm = std::make_unique<EulerFDM<SDE>>(sde, job.NT);
+		else if (job.scheme == "milstein")
+			fdm = std::make_unique<MilsteinFDM<SDE>>(sde, job.NT);
+		else if (job.scheme == "pc")
+			fdm = std::make_unique<PredictorCorrectorFDM<SDE>>(sde, job.NT);
+		else if (job.scheme == "logeuler")
+			fdm = std::make_unique<LogEulerFDM<SDE>>(sde, job.NT);
+		else if (job.scheme == "exact")
+		{
+			if constexpr (std::is_same_v<SDE, GBM>) // Exact GBM step, never built for the other models
+				fdm = std::make_unique<ExactFDM<SDE>>(sde, job.NT, od->vol, od->r, od->q);
+			else
+				throw std::invalid_argument("Invalid scheme '" + job.scheme + "' for model '" + job.model + "'.");
+		}
+		else
+			throw std::invalid_argument("Invalid scheme '" + job.scheme + "' for model '" + job.model + "'.");
+
+		std::unique_ptr<RNGAbstract> rng;
+		if (job.rng == "mt") rng = std::make_unique<MersenneTwister>();
+		else if (job.rng == "polar") rng = std::make_unique<PolarMarsagliaNet>();
+		else if (job.rng == "boxmuller") rng = std::make_unique<BoxMuller>();
+		else if (job.rng == "philox") rng = std::make_unique<Philox>(job.seed);
+		else if (job.rng == "sobol") rng = std::make_unique<Sobol>(job.NT, Sobol::Scrambling::Owen, job.seed);
+		else throw std::invalid_argument("Invalid RNG '" + job.rng + "'.");
+
+		auto discounter = [od]() { return std::exp(-od->r * od->T); };
+		std::shared_ptr<PricerAbstract> pricer;
+		if (job.pricer == "european")
+		{
+			pricer = std::make_shared<EuropeanPricer>(od->K, discounter, 0);
+		}
+		else if (job.pricer == "asian")
+		{
+			pricer = std::make_shared<AsianPricer>(od->K, discounter, 0);
+		}
+		else if (job.pricer == "barrier")
+		{
+			const std::string types[] = { "ui", "uo", "di", "do" };
+			auto type = std::find(std::begin(types), std::end(types), job.barrierType);
+			if (type == std::end(types))
+				throw std::invalid_argument("Invalid barrier type '" + job.barrierType + "'.");
+
+			auto barrier = std::make_shared<BarrierPricer>(od->K, discounter, 0);
+			barrier->set_barrier_type(static_cast<BarrierPricer::BarrierType>(type - std::begin(types) + 1));
+			barrier->set_barrier_amount(job.barrier);
+			pricer = barrier;
+		}
+		else
+		{
+			throw std::invalid_argument("Invalid pricer '" + job.pricer + "'.");
+		}
+		pricer->set_display(false); // The interface is shared by every job
+
+		StopWatch sw;
+		sw.Start();
+		run_dispatched(sde, *fdm, *rng, *pricer, job.paths,
+			[&job](auto& engine)
+			{
+				engine.set_thread_count(1); // The jobs run side by side
+				engine.set_block_size(64);
+				engine.set_progress(false);
+				engine.set_antithetic(job.antithetic);
+				if (job.targetError > 0.0)
+					engine.set_target_error(job.targetError, job.paths);
+			});
+		sw.Stop();
+
+		result.call = pricer->call_price();
+		result.callError = pricer->call_standard_error();
+		result.put = pricer->put_price();
+		result.putError = pricer->put_standard_error();
+		result.nSim = pricer->simulation_count();
+		result.duration = sw.GetTime();
+		if (rng->low_discrepancy()) // No i.i.d. standard error for quasi-random points
+			result.callError = result.putError = std::numeric_limits<double>::quiet_NaN();
+	}
+}
+
+double BatchJob::cost() const
+{
+	return static_cast<double>(paths) * static_cast<double>(NT);
+}
+
+BatchRunner::BatchRunner(std::size_t nThreads)
+	: m_nThreads{ nThreads == 0 ? std::max<std::size_t>(1, std::thread::hardware_concurrency()) : nThreads }, m_duration{}
+{}
+
+BatchRunner::Format BatchRunner::format_of(const std::string& path)
+{
+	std::string extension = lower(path.substr(path.find_last_of('.') == std::string::npos ? path.size() : path.find_last_of('.')));
+	if (extension == ".csv")
+		return Format::CSV;
+	if (extension == ".jsonl" || extension == ".json")
+		return Format::JSONLines;
+
+	throw std::invalid_argument("Unknown job file format (expected .csv or .jsonl): " + path);
+}
+
+std::vector<BatchJob> BatchRunner::read_jobs(std::istream& in, Format format)
+{
+	std::vector<BatchJob> jobs;
+	std::vector<std::string> header;
+	std::string line;
+	std::size_t lineNumber = 0;
+
+	while (std::getline(in, line))
+	{
+		++lineNumber;
+		line = trim(line);
+		if (line.empty() || line.front() == '#')
+			continue;
+
+		if (format == Format::CSV && header.empty())
+		{ // First row: the keys
+			header = split_csv(line);
+			continue;
+		}
+
+		BatchJob job;
+		job.id = std::to_string(lineNumber);
+		job.data.betaCEV = 1.0;
+		try
+		{
+			if (format == Format::JSONLines)
+			{
+				make_job(job, parse_json(line));
+			}
+			else
+			{
+				std::vector<std::string> cells = split_csv(line);
+				if (cells.size() != header.size())
+					throw std::invalid_argument("Expected " + std::to_string(header.size()) + " columns.");
+
+				Fields fields;
+				for (std::size_t c = 0; c < cells.size(); ++c)
+					fields.emplace_back(header[c], cells[c]);
+				make_job(job, fields);
+			}
+		}
+		catch (const std::invalid_argument& e)
+		{ // Reported in the results, the other jobs still run
+			job.error = "Job file line " + std::to_string(lineNumber) + ": " + e.what();
+		}
+		jobs.push_back(std::move(job));
+	}
+
+	return jobs;
+}
+
+BatchResult BatchRunner::run_job(const BatchJob& job)
+{
+	BatchResult result;
+	result.id = job.id;
+	result.error = job.error;
+	if (!job.error.empty())
+		return result;
+
+	try
+	{
+		if (job.model == "gbm")
+			price<GBM>(job, result);
+		else if (job.model == "cev")
+			price<CEV>(job, result);
+		else
+			throw std::invalid_argument("Invalid model '" + job.model + "'.");
+	}
+	catch (const std::exception& e)
+	{
+		result.error = e.what();
+	}
+
+	return result;
+}
+
+void BatchRunner::write_results(std::ostream& out, const std::vector<BatchResult>& results)
+{
+	out << "id,status,call,call_error,put,put_error,paths,seconds\n";
+	for (const BatchResult& result : results)
+	{
+		// The ids come from the job file: quoted like the error messages
+		if (!result.error.empty())
+		{
+			out << quoted(result.id) << ',' << quoted("error: " + result.error) << ",,,,,,\n";
+			continue;
+		}
+
+		out << quoted(result.id) << ",ok," << std::setprecision(10) << result.call << ',' << result.callError << ',' << result.put << ','
+			<< result.putError << ',' << result.nSim << ',' << std::setprecision(6) << result.duration << '\n';
+	}
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob>& jobs)
+{
+	StopWatch sw;
+	sw.Start();
+
+	// Longest jobs first: the short ones fill the cores at the end of the run
+	std::vector<std::size_t> order(jobs.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&jobs](std::size_t a, std::size_t b) { return jobs[a].cost() > jobs[b].cost(); });
+
+	std::vector<BatchResult> results(jobs.size());
+	{
+		ThreadPool pool(std::min(m_nThreads, std::max<std::size_t>(1, jobs.size())));
+		for (std::size_t i : order)
+			pool.submit([&jobs, &results, i]() { results[i] = run_job(jobs[i]); });
+		pool.wait();
+	}
+
+	sw.Stop();
+	m_duration = sw.GetTime();
+	return results;
+}
+
+double BatchRunner::duration() const
+{
+	return m_duration;
+}
+
+std::size_t BatchRunner::thread_count() const
+{
+	return m_nThreads;
+}
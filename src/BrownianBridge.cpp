@@ -0,0 +1,93 @@
+// BrownianBridge.cpp
+//
+// Implementation of BrownianBridge.hpp
+// Times are measured in units of the mesh size, t_j = j + 1 for the j-th point of the path.
+//
+// Pierre-Yves Sojic
+//
+
+#include <cmath>
+#include <stdexcept>
+
+#include "BrownianBridge.hpp"
+
+BrownianBridge::BrownianBridge(std::size_t NT)
+	: m_NT{ NT }, m_bridgeIndex(NT), m_leftIndex(NT), m_rightIndex(NT), m_leftWeight(NT), m_rightWeight(NT), m_stdDev(NT)
+{
+	if (NT < 1)
+		throw std::invalid_argument("NT must be a stricly positive integer.");
+
+	auto t = [](std::size_t j) { return static_cast<double>(j + 1); };
+
+	// map[j] != 0 once point j has been built
+	std::vector<std::size_t> map(NT, 0);
+
+	// The end point comes first
+	map[NT - 1] = 1;
+	m_bridgeIndex[0] = NT - 1;
+	m_stdDev[0] = std::sqrt(t(NT - 1));
+	m_leftWeight[0] = m_rightWeight[0] = 0.0;
+
+	for (std::size_t j = 0, i = 1; i < NT; ++i)
+	{
+		// Find the next unpopulated interval [j, k)
+		while (map[j])
+			++j;
+		std::size_t k = j;
+		while (!map[k])
+			++k;
+
+		// Its midpoint is built from its two neighbours
+		std::size_t l = j + ((k - 1 - j) >> 1);
+		map[l] = i;
+		m_bridgeIndex[i] = l;
+		m_leftIndex[i] = j;
+		m_rightIndex[i] = k;
+
+		if (j != 0)
+		{
+			double tl = t(j - 1);
+			m_leftWeight[i] = (t(k) - t(l)) / (t(k) - tl);
+			m_rightWeight[i] = (t(l) - tl) / (t(k) - tl);
+			m_stdDev[i] = std::sqrt((t(l) - tl) * (t(k) - t(l)) / (t(k) - tl));
+		}
+		else
+		{ // Left neighbour is the origin, W(0) = 0
+			m_leftWeight[i] = (t(k) - t(l)) / t(k);
+			m_rightWeight[i] = t(l) / t(k);
+			m_stdDev[i] = std::sqrt(t(l) * (t(k) - t(l)) / t(k));
+		}
+
+		j = k + 1;
+		if (j >= NT)
+			j = 0;
+	}
+}
+
+void BrownianBridge::transform(std::span<const double> normals, std::span<double> increments) const
+{
+	// Build the Brownian path in place
+	increments[m_NT - 1] = m_stdDev[0] * normals[0];
+	for (std::size_t i = 1; i < m_NT; ++i)
+	{
+		std::size_t j = m_leftIndex[i];
+		std::size_t k = m_rightIndex[i];
+		std::size_t l = m_bridgeIndex[i];
+
+		if (j != 0)
+			increments[l] = m_leftWeight[i] * increments[j - 1] + m_rightWeight[i] * increments[k] + m_stdDev[i] * normals[i];
+		else
+			increments[l] = m_rightWeight[i] * increments[k] + m_stdDev[i] * normals[i];
+	}
+
+	// Path to increments (unit time steps)
+	for (std::size_t i = m_NT - 1; i > 0; --i)
+	{
+		increments[i] -= increments[i - 1];
+	}
+}
+
+std::size_t BrownianBridge::size() const
+{
+	return m_NT;
+}
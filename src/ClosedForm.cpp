@@ -0,0 +1,105 @@
+// ClosedForm.cpp
+//
+// Implementation of ClosedForm.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include <cmath>
+#include <numbers>
+
+#include "ClosedForm.hpp"
+
+namespace
+{
+	// E[max(X - K, 0)] and E[max(K - X, 0)] for X lognormal with E[log X] = m and Var[log X] = v
+	double lognormal_call(double m, double v, double K)
+	{
+		double sd = std::sqrt(v);
+		double d1 = (m - std::log(K) + v) / sd;
+
+		return std::exp(m + 0.5 * v) * ClosedForm::normal_cdf(d1) - K * ClosedForm::normal_cdf(d1 - sd);
+	}
+
+	double lognormal_put(double m, double v, double K)
+	{
+		double sd = std::sqrt(v);
+		double d1 = (m - std::log(K) + v) / sd;
+
+		return K * ClosedForm::normal_cdf(sd - d1) - std::exp(m + 0.5 * v) * ClosedForm::normal_cdf(-d1);
+	}
+
+	// Moments of log S_T
+	double terminal_mean(const OptionData& od) { return std::log(od.S0) + (od.r - od.q - 0.5 * od.vol * od.vol) * od.T; }
+	double terminal_variance(const OptionData& od) { return od.vol * od.vol * od.T; }
+
+	// Moments of the log of the geometric average: the average of log S at t_i = i T / NT, i = 0..NT
+	// has variance vol^2 T / (NT (NT + 1)^2) sum_{i,j} min(i, j) = vol^2 T (2 NT + 1) / (6 (NT + 1))
+	double geometric_mean(const OptionData& od) { return std::log(od.S0) + 0.5 * (od.r - od.q - 0.5 * od.vol * od.vol) * od.T; }
+	double geometric_variance(const OptionData& od, std::size_t NT)
+	{
+		double N = static_cast<double>(NT);
+		return od.vol * od.vol * od.T * (2.0 * N + 1.0) / (6.0 * (N + 1.0));
+	}
+
+	double d1(const OptionData& od)
+	{
+		return (std::log(od.S0 / od.K) + (od.r - od.q + 0.5 * od.vol * od.vol) * od.T) / (od.vol * std::sqrt(od.T));
+	}
+
+	double normal_pdf(double x)
+	{
+		return std::exp(-0.5 * x * x) * std::numbers::inv_sqrtpi / std::numbers::sqrt2;
+	}
+}
+
+double ClosedForm::normal_cdf(double x)
+{
+	return 0.5 * std::erfc(-x / std::numbers::sqrt2);
+}
+
+double ClosedForm::black_scholes_call(const OptionData& od)
+{
+	return std::exp(-od.r * od.T) * lognormal_call(terminal_mean(od), terminal_variance(od), od.K);
+}
+
+double ClosedForm::black_scholes_put(const OptionData& od)
+{
+	return std::exp(-od.r * od.T) * lognormal_put(terminal_mean(od), terminal_variance(od), od.K);
+}
+
+double ClosedForm::black_scholes_call_delta(const OptionData& od)
+{
+	return std::exp(-od.q * od.T) * normal_cdf(d1(od));
+}
+
+double ClosedForm::black_scholes_call_gamma(const OptionData& od)
+{
+	return std::exp(-od.q * od.T) * normal_pdf(d1(od)) / (od.S0 * od.vol * std::sqrt(od.T));
+}
+
+double ClosedForm::black_scholes_call_vega(const OptionData& od)
+{
+	return od.S0 * std::exp(-od.q * od.T) * normal_pdf(d1(od)) * std::sqrt(od.T);
+}
+
+double ClosedForm::black_scholes_call_rho(const OptionData& od)
+{
+	double d2 = d1(od) - od.vol * std::sqrt(od.T);
+	return od.K * od.T * std::exp(-od.r * od.T) * normal_cdf(d2);
+}
+
+double ClosedForm::geometric_asian_call(const OptionData& od, std::size_t NT)
+{
+	return std::exp(-od.r * od.T) * lognormal_call(geometric_mean(od), geometric_variance(od, NT), od.K);
+}
+
+double ClosedForm::geometric_asian_put(const OptionData& od, std::size_t NT)
+{
+	return std::exp(-od.r * od.T) * lognormal_put(geometric_mean(od), geometric_variance(od, NT), od.K);
+}
+
+double ClosedForm::discounted_terminal(const OptionData& od)
+{
+	return od.S0 * std::exp(-od.q * od.T);
+}
@@ -0,0 +1,135 @@
+// ControlVariate.cpp
+//
+// Implementation of ControlVariate.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "ControlVariate.hpp"
+
+void ControlMoments::add(double y, const double* x, std::size_t k)
+{
+	++m_n;
+	double n = static_cast<double>(m_n);
+
+	std::array<double, MaxControls> dx{};
+	for (std::size_t i = 0; i < k; ++i)
+	{
+		dx[i] = x[i] - m_meanX[i];
+		m_meanX[i] += dx[i] / n;
+	}
+	double dy = y - m_meanY;
+	m_meanY += dy / n;
+
+	// Old deviation times new deviation
+	m_m2Y += dy * (y - m_meanY);
+	for (std::size_t i = 0; i < k; ++i)
+	{
+		m_cXY[i] += dx[i] * (y - m_meanY);
+		for (std::size_t j = 0; j < k; ++j)
+			m_cXX[i][j] += dx[i] * (x[j] - m_meanX[j]);
+	}
+}
+
+void ControlMoments::merge(const ControlMoments& other, std::size_t k)
+{
+	if (other.m_n == 0)
+		return;
+	if (m_n == 0)
+	{
+		*this = other;
+		return;
+	}
+
+	double na = static_cast<double>(m_n), nb = static_cast<double>(other.m_n);
+	double n = na + nb;
+	double w = na * nb / n;
+
+	std::array<double, MaxControls> dx{};
+	for (std::size_t i = 0; i < k; ++i)
+		dx[i] = other.m_meanX[i] - m_meanX[i];
+	double dy = other.m_meanY - m_meanY;
+
+	m_m2Y += other.m_m2Y + dy * dy * w;
+	for (std::size_t i = 0; i < k; ++i)
+	{
+		m_cXY[i] += other.m_cXY[i] + dx[i] * dy * w;
+		for (std::size_t j = 0; j < k; ++j)
+			m_cXX[i][j] += other.m_cXX[i][j] + dx[i] * dx[j] * w;
+	}
+
+	for (std::size_t i = 0; i < k; ++i)
+		m_meanX[i] += dx[i] * nb / n;
+	m_meanY += dy * nb / n;
+	m_n += other.m_n;
+}
+
+ControlMoments::Estimate ControlMoments::estimate(const double* expected, std::size_t k) const
+{
+	// Normal equations restricted to the controls that actually vary (e.g. a put that never ends in the money)
+	std::array<std::size_t, MaxControls> used{};
+	std::size_t m = 0;
+	for (std::size_t i = 0; i < k; ++i)
+	{
+		if (m_cXX[i][i] > 1e-12 * (1.0 + m_m2Y))
+			used[m++] = i;
+	}
+
+	std::array<std::array<double, MaxControls + 1>, MaxControls> a{};
+	for (std::size_t r = 0; r < m; ++r)
+	{
+		for (std::size_t c = 0; c < m; ++c)
+			a[r][c] = m_cXX[used[r]][used[c]];
+		a[r][m] = m_cXY[used[r]];
+	}
+
+	// Gaussian elimination with partial pivoting (m <= MaxControls)
+	std::array<double, MaxControls> beta{};
+	for (std::size_t c = 0; c < m; ++c)
+	{
+		std::size_t pivot = c;
+		for (std::size_t r = c + 1; r < m; ++r)
+		{
+			if (std::abs(a[r][c]) > std::abs(a[pivot][c]))
+				pivot = r;
+		}
+		std::swap(a[c], a[pivot]);
+		if (std::abs(a[c][c]) < 1e-14 * std::abs(m_cXX[used[c]][used[c]]))
+			return { m_meanY, m_n > 1 ? m_m2Y / (m_n - 1) : 0.0, 1.0 }; // Collinear controls: no adjustment
+
+		for (std::size_t r = c + 1; r < m; ++r)
+		{
+			double f = a[r][c] / a[c][c];
+			for (std::size_t j = c; j <= m; ++j)
+				a[r][j] -= f * a[c][j];
+		}
+	}
+	for (std::size_t c = m; c-- > 0;)
+	{
+		double s = a[c][m];
+		for (std::size_t j = c + 1; j < m; ++j)
+			s -= a[c][j] * beta[j];
+		beta[c] = s / a[c][c];
+	}
+
+	double mean = m_meanY;
+	double explained{};
+	for (std::size_t r = 0; r < m; ++r)
+	{
+		mean -= beta[r] * (m_meanX[used[r]] - expected[used[r]]);
+		explained += beta[r] * m_cXY[used[r]];
+	}
+
+	// Residual sum of squares of the regression
+	double residual = m_m2Y - explained;
+	double reduction = residual > 0.0 ? m_m2Y / residual : std::numeric_limits<double>::infinity();
+	// One degree of freedom per coefficient, plus the mean
+	double variance = m_n > m + 1 ? std::max(residual, 0.0) / (m_n - m - 1) : 0.0;
+
+	return { mean, variance, m_m2Y > 0.0 ? reduction : 1.0 };
+}
@@ -0,0 +1,80 @@
+// Greeks.cpp
+//
+// Implementation of Greeks.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "Greeks.hpp"
+
+PathTangents path_tangents(const PathBlock& block, std::size_t p, const GreekModel& model)
+{
+	std::size_t NT = block.nRows - 1;
+	double dt = model.T / NT;
+	double sqrtDt = std::sqrt(dt);
+	double diffusion = model.vol * sqrtDt;
+	bool exact = model.scheme == GreekScheme::Exact;
+	double growth = exact ? (model.r - model.q - 0.5 * model.vol * model.vol) * dt : 1.0 + (model.r - model.q) * dt;
+
+	double S = block.data[p];
+	PathTangents t{ S, S, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, S, S, block.nRows };
+
+	// The tangents are kept relative to S. Euler: V_{j+1} = V_j S_{j+1} / S_j + S_j sqrt(dt) Z_j
+	// gives V_{j+1} / S_{j+1} = V_j / S_j + sqrt(dt) Z_j S_j / S_{j+1}, and likewise with dt for r.
+	// Exact: log S_{j+1} - log S_j is linear in vol and r, V_{j+1} / S_{j+1} = V_j / S_j + sqrt(dt) Z_j - vol dt
+	double vegaRatio{}, rhoRatio{};
+	for (std::size_t j = 1; j <= NT; ++j)
+	{
+		double next = block.data[j * block.stride + p];
+		double Z = exact ? (std::log(next / S) - growth) / diffusion : (next / S - growth) / diffusion;
+
+		if (exact)
+		{
+			vegaRatio += sqrtDt * Z - model.vol * dt;
+			rhoRatio += dt;
+			t.vegaScore += (Z * Z - 1.0) / model.vol - sqrtDt * Z; // dZ/dvol = sqrt(dt) - Z / vol
+		}
+		else
+		{
+			double back = S / next;
+			vegaRatio += sqrtDt * Z * back;
+			rhoRatio += dt * back;
+			t.vegaScore += (Z * Z - 1.0) / model.vol; // S_{j+1} given S_j is normal with standard deviation vol S_j sqrt(dt)
+		}
+		t.vegaAverage += next * vegaRatio;
+		t.rhoAverage += next * rhoRatio;
+		t.average += next;
+		t.brownian += sqrtDt * Z;
+		t.min = std::min(t.min, next);
+		t.max = std::max(t.max, next);
+		if (j == 1 && exact)
+		{ // log S_1 is normal with mean log S0 + growth and standard deviation vol sqrt(dt): dZ/dS0 = -1 / (S0 vol sqrt(dt)),
+		  // the score is Z / (S0 vol sqrt(dt)) and the second derivative of the density over the density (Z^2 - 1 - vol sqrt(dt) Z) / (S0 vol sqrt(dt))^2
+			t.deltaScore = Z / (model.S0 * diffusion);
+			t.gammaScore = (Z * Z - 1.0 - diffusion * Z) / (model.S0 * model.S0 * diffusion * diffusion);
+		}
+		else if (j == 1)
+		{ // S_1 is normal with mean S0 growth and standard deviation S0 vol sqrt(dt): with c = growth / (vol sqrt(dt)),
+		  // dZ/dS0 = -(c + Z) / S0, the score is (Z^2 - 1 + c Z) / S0 and its derivative (1 - 3 Z^2 - 4 c Z - c^2) / S0^2
+			double c = growth / diffusion;
+			double score = Z * Z - 1.0 + c * Z;
+			t.deltaScore = score / model.S0;
+			t.gammaScore = (score * score + 1.0 - 3.0 * Z * Z - 4.0 * c * Z - c * c) / (model.S0 * model.S0);
+		}
+
+		S = next;
+	}
+
+	t.terminal = S;
+	t.vegaTerminal = S * vegaRatio;
+	t.rhoTerminal = S * rhoRatio;
+	t.average /= block.nRows;
+	t.vegaAverage /= block.nRows;
+	t.rhoAverage /= block.nRows;
+	t.rhoScore = t.brownian / model.vol;
+
+	return t;
+}
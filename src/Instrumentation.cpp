@@ -0,0 +1,145 @@
+// Instrumentation.cpp
+//
+// Implementation of Instrumentation.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+#include "Instrumentation.hpp"
+
+namespace profiling
+{
+	namespace
+	{
+		const char* stage_names[NStages] = { "random", "advance", "pricer", "sync", "reduction" };
+	}
+
+	void StageProfile::reset(std::size_t nThreads)
+	{
+		m_threads.assign(nThreads, ThreadCounters{});
+	}
+
+	void StageProfile::begin()
+	{
+		m_beginTime = std::chrono::steady_clock::now();
+		m_beginTicks = ticks();
+	}
+
+	void StageProfile::end()
+	{
+		m_endTicks = ticks();
+		m_endTime = std::chrono::steady_clock::now();
+	}
+
+	std::size_t StageProfile::thread_count() const
+	{
+		return m_threads.size();
+	}
+
+	double StageProfile::to_seconds(std::uint64_t t) const
+	{
+		if (m_endTicks <= m_beginTicks)
+			return 0.0;
+		return wall_time() * static_cast<double>(t) / static_cast<double>(m_endTicks - m_beginTicks);
+	}
+
+	double StageProfile::seconds(Stage stage) const
+	{
+		std::uint64_t t{};
+		for (const ThreadCounters& counters : m_threads)
+			t += counters.ticks[static_cast<std::size_t>(stage)];
+		return to_seconds(t);
+	}
+
+	std::uint64_t StageProfile::calls(Stage stage) const
+	{
+		std::uint64_t n{};
+		for (const ThreadCounters& counters : m_threads)
+			n += counters.calls[static_cast<std::size_t>(stage)];
+		return n;
+	}
+
+	double StageProfile::wall_time() const
+	{
+		return std::chrono::duration<double>(m_endTime - m_beginTime).count();
+	}
+
+	double StageProfile::imbalance() const
+	{
+		std::uint64_t total{}, largest{};
+		std::size_t workers{};
+		for (const ThreadCounters& counters : m_threads)
+		{
+			if (counters.chunks == 0)
+				continue;
+			total += counters.chunks;
+			largest = std::max(largest, counters.chunks);
+			++workers;
+		}
+		return total == 0 ? 1.0 : static_cast<double>(largest) * workers / total;
+	}
+
+	void StageProfile::write_table(std::ostream& out) const
+	{
+		std::ios_base::fmtflags flags = out.flags();
+		std::streamsize precision = out.precision();
+
+		double busy{};
+		for (const ThreadCounters& counters : m_threads)
+			busy += to_seconds(counters.busy);
+
+		out << "\nStage profile (wall time " << std::fixed << std::setprecision(4) << wall_time() << "s)\n";
+		out << std::setw(12) << "stage" << std::setw(14) << "seconds" << std::setw(10) << "share" << std::setw(14) << "calls" << std::setw(14) << "ns/call" << '\n';
+		for (std::size_t s = 0; s < NStages; ++s)
+		{
+			Stage stage = static_cast<Stage>(s);
+			double t = seconds(stage);
+			std::uint64_t n = calls(stage);
+			out << std::setw(12) << stage_names[s] << std::setw(14) << std::setprecision(4) << t << std::setw(9) << std::setprecision(1)
+				<< (busy > 0.0 ? 100.0 * t / busy : 0.0) << '%' << std::setw(14) << n << std::setw(14) << (n > 0 ? 1e9 * t / n : 0.0) << '\n';
+		}
+
+		out << std::setw(12) << "thread" << std::setw(14) << "busy (s)" << std::setw(10) << "chunks" << std::setw(14) << "paths" << '\n';
+		for (std::size_t t = 0; t < m_threads.size(); ++t)
+		{
+			const ThreadCounters& counters = m_threads[t];
+			out << std::setw(12) << t << std::setw(14) << std::setprecision(4) << to_seconds(counters.busy) << std::setw(10) << counters.chunks
+				<< std::setw(14) << counters.paths << '\n';
+		}
+		out << "Load imbalance (largest / average chunks per thread): " << std::setprecision(2) << imbalance() << "\n\n";
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+	void StageProfile::write_json(std::ostream& out) const
+	{
+		std::ios_base::fmtflags flags = out.flags();
+		std::streamsize precision = out.precision();
+
+		out << std::setprecision(9) << "{\"wall_time\": " << wall_time() << ", \"imbalance\": " << imbalance() << ", \"stages\": {";
+		for (std::size_t s = 0; s < NStages; ++s)
+		{
+			Stage stage = static_cast<Stage>(s);
+			out << (s > 0 ? ", " : "") << '"' << stage_names[s] << "\": {\"seconds\": " << seconds(stage) << ", \"calls\": " << calls(stage) << '}';
+		}
+		out << "}, \"threads\": [";
+		for (std::size_t t = 0; t < m_threads.size(); ++t)
+		{
+			const ThreadCounters& counters = m_threads[t];
+			out << (t > 0 ? ", " : "") << "{\"busy\": " << to_seconds(counters.busy) << ", \"chunks\": " << counters.chunks << ", \"paths\": " << counters.paths
+				<< ", \"seconds\": [";
+			for (std::size_t s = 0; s < NStages; ++s)
+				out << (s > 0 ? ", " : "") << to_seconds(counters.ticks[s]);
+			out << "]}";
+		}
+		out << "]}\n";
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+}
@@ -5,11 +5,18 @@
 // Pierre-Yves Sojic
 //
 
+#include <iomanip>
 #include <iostream>
 #include <memory>
 
 #include "Interface.hpp"
 
+namespace
+{
+	// Appended to the errors of runs on low-discrepancy points, which are not independent draws
+	constexpr const char* QuasiRandomNote = " (i.i.d. formula, not meaningful for quasi-random draws)";
+}
+
 void Interface::display_european(double callprice, double putprice, std::size_t nSim, double duration) const
 {
 	std::cout << "\nOption parameters: S0 = " << m_data->S0 << ", K = " << m_data->K
@@ -45,5 +52,52 @@ void Interface::display_barrier(double callprice, double putprice, double barrie
 
 	std::cout << "\nCall Price = " << callprice << ", Put Price = " << putprice << std::endl;
 
+	std::cout << "\nTime elapsed: " << duration << "s" << std::endl;
+}
+
+void Interface::display_standard_errors(double callerror, double puterror, bool quasirandom) const
+{
+	std::cout << "Standard Error: Call = " << callerror << ", Put = " << puterror;
+	if (quasirandom) // Sobol points are not independent, the formula overstates the error by an unknown factor
+		std::cout << QuasiRandomNote;
+	std::cout << std::endl;
+}
+
+void Interface::display_control_variates(double plaincallprice, double plainputprice, double callreduction, double putreduction) const
+{
+	std::cout << "\nWithout control variates: Call Price = " << plaincallprice << ", Put Price = " << plainputprice << std::endl;
+	std::cout << "Variance reduction factor: Call = " << callreduction << ", Put = " << putreduction << std::endl;
+}
+
+void Interface::display_greeks(const std::array<double, NGreeks>& callgreeks, const std::array<double, NGreeks>& putgreeks,
+	const std::array<double, NGreeks>& callerrors, const std::array<double, NGreeks>& puterrors, bool quasirandom) const
+{
+	const char* names[NGreeks] = { "Delta", "Gamma", "Vega", "Rho" };
+
+	std::cout << "\nGreeks (standard error)" << (quasirandom ? QuasiRandomNote : "") << ':' << std::endl;
+	for (std::size_t g = 0; g < NGreeks; ++g)
+	{
+		std::cout << names[g] << ": Call = " << callgreeks[g] << " (" << callerrors[g] << ")"
+			<< ", Put = " << putgreeks[g] << " (" << puterrors[g] << ")" << std::endl;
+	}
+}
+
+void Interface::display_portfolio(const std::vector<std::string>& labels, const std::vector<double>& callprices, const std::vector<double>& putprices,
+	const std::vector<double>& callerrors, const std::vector<double>& puterrors, std::size_t nSim, double duration, bool quasirandom) const
+{
+	std::cout << "\nOption parameters: S0 = " << m_data->S0 << ", vol = " << m_data->vol << ", T = " << m_data->T
+		<< ", r = " << m_data->r << ", q = " << m_data->q << std::endl;
+	std::cout << "Number of MC simulations = " << nSim << ", contracts = " << labels.size() << std::endl;
+
+	std::cout << '\n' << std::left << std::setw(32) << "Contract" << std::right << std::setw(14) << "Call" << std::setw(14) << "(error)"
+		<< std::setw(14) << "Put" << std::setw(14) << "(error)" << std::endl;
+	for (std::size_t i = 0; i < labels.size(); ++i)
+	{
+		std::cout << std::left << std::setw(32) << labels[i] << std::right << std::setw(14) << callprices[i] << std::setw(14) << callerrors[i]
+			<< std::setw(14) << putprices[i] << std::setw(14) << puterrors[i] << std::endl;
+	}
+	if (quasirandom)
+		std::cout << "Errors:" << QuasiRandomNote << std::endl;
+
 	std::cout << "\nTime elapsed: " << duration << "s" << std::endl;
 }
\ No newline at end of file
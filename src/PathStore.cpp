@@ -0,0 +1,378 @@
+// PathStore.cpp
+//
+// Implementation of PathStore.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+#include "PathStore.hpp"
+
+namespace
+{
+	constexpr char Magic[8] = { 'M', 'C', 'P', 'A', 'T', 'H', 'S', '\0' };
+	constexpr std::uint32_t Version = 1;
+	constexpr std::size_t DataOffset = 4096;	// Blocks start on a page boundary
+	constexpr std::size_t NStatistics = 5;		// Terminal, sum, log sum, min, max
+
+	struct FileHeader
+	{ // Native byte order
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t statistics;
+		double S0, K, T, r, vol, q, H, betaCEV, scale;
+		char model[16];
+		char scheme[16];
+		char rng[16];
+		std::uint64_t seed;
+		std::uint64_t NT;
+		std::uint64_t nSim;
+		std::uint64_t nSamples;				// Samples recorded (fewer than the run's after an adaptive stop)
+		std::uint64_t chunkSize;
+		std::uint64_t blockSize;
+		std::uint64_t antithetic;
+		std::uint64_t dataOffset;
+	};
+	static_assert(std::is_trivially_copyable_v<FileHeader> && sizeof(FileHeader) <= DataOffset);
+
+	void copy_name(char (&to)[16], const std::string& from)
+	{
+		std::memset(to, 0, sizeof(to));
+		std::memcpy(to, from.data(), std::min(from.size(), sizeof(to) - 1));
+	}
+
+	std::string read_name(const char (&from)[16])
+	{
+		return std::string(from, strnlen(from, sizeof(from)));
+	}
+
+	std::size_t block_bytes(const PathFileInfo& info)
+	{
+		return info.rows() * info.width() * sizeof(double);
+	}
+
+	std::size_t block_count(std::size_t nSamples, const PathFileInfo& info)
+	{
+		return (nSamples + info.blockSize - 1) / info.blockSize;
+	}
+}
+
+//--------------File info-----------------
+
+std::size_t PathFileInfo::samples() const
+{
+	return antithetic ? (nSim + 1) / 2 : nSim;
+}
+
+std::size_t PathFileInfo::width() const
+{
+	return antithetic ? 2 * blockSize : blockSize;
+}
+
+std::size_t PathFileInfo::rows() const
+{
+	return statistics ? NStatistics : NT + 1;
+}
+
+//--------------Mapped file-----------------
+
+MappedFile MappedFile::create(const std::string& path, std::size_t size)
+{
+	MappedFile file;
+	file.m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file.m_fd < 0)
+		throw std::invalid_argument("Cannot create the path file " + path);
+	file.m_writable = true;
+	file.resize(size);
+
+	return file;
+}
+
+MappedFile MappedFile::open(const std::string& path)
+{
+	MappedFile file;
+	file.m_fd = ::open(path.c_str(), O_RDONLY);
+	if (file.m_fd < 0)
+		throw std::invalid_argument("Cannot open the path file " + path);
+
+	struct stat status {};
+	if (fstat(file.m_fd, &status) != 0)
+		throw std::invalid_argument("Cannot read the size of the path file " + path);
+	file.m_size = static_cast<std::size_t>(status.st_size);
+
+	if (file.m_size > 0)
+	{
+		void* data = mmap(nullptr, file.m_size, PROT_READ, MAP_SHARED, file.m_fd, 0);
+		if (data == MAP_FAILED)
+			throw std::invalid_argument("Cannot map the path file " + path);
+		file.m_data = static_cast<std::byte*>(data);
+		madvise(data, file.m_size, MADV_SEQUENTIAL); // Read ahead, every chunk is read front to back
+	}
+
+	return file;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_fd{ std::exchange(other.m_fd, -1) }, m_data{ std::exchange(other.m_data, nullptr) }, m_size{ std::exchange(other.m_size, 0) },
+	m_writable{ other.m_writable }
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		m_fd = std::exchange(other.m_fd, -1);
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+		m_writable = other.m_writable;
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+void MappedFile::resize(std::size_t size)
+{
+	if (!m_writable)
+		throw std::logic_error("Read-only mapping.");
+
+	if (m_data)
+		munmap(m_data, m_size);
+	m_data = nullptr;
+
+	if (ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+		throw std::invalid_argument("Cannot resize the path file.");
+	m_size = size;
+
+	if (m_size > 0)
+	{
+		void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+		if (data == MAP_FAILED)
+			throw std::invalid_argument("Cannot map the path file.");
+		m_data = static_cast<std::byte*>(data);
+	}
+}
+
+void MappedFile::close()
+{
+	if (m_data)
+		munmap(m_data, m_size);
+	if (m_fd >= 0)
+		::close(m_fd);
+	m_data = nullptr;
+	m_fd = -1;
+	m_size = 0;
+}
+
+//--------------Recorder-----------------
+
+PathRecorder::PathRecorder(const std::string& path, const PathFileInfo& info, const std::shared_ptr<PricerAbstract>& pricer)
+	: PricerAbstract(PayoffFunc{}, PayoffFunc{}, [data = info.data]() { return std::exp(-data.r * data.T); }, info.nSim),
+	m_path{ path }, m_info{ info }, m_pricer{ pricer }
+{
+	if (m_info.NT < 1 || m_info.nSim < 1 || m_info.blockSize < 1 || m_info.chunkSize % m_info.blockSize != 0)
+		throw std::invalid_argument("Path file: NT and NSim must be positive, the block size must divide the chunk size.");
+	if (m_pricer)
+		m_pricer->set_display(false);
+}
+
+const PathFileInfo& PathRecorder::info() const
+{
+	return m_info;
+}
+
+void PathRecorder::prepare(std::size_t nSlots)
+{
+	if (nSlots != (m_info.samples() + m_info.chunkSize - 1) / m_info.chunkSize)
+		throw std::invalid_argument("Path file: the engine's number of simulations or chunk size differs from the file info.");
+
+	PricerAbstract::prepare(nSlots);
+	m_slotSamples.assign(nSlots, 0);
+	m_file = std::make_unique<MappedFile>(MappedFile::create(m_path, DataOffset + block_count(m_info.samples(), m_info) * block_bytes(m_info)));
+
+	if (m_pricer)
+	{
+		m_pricer->prepare(nSlots);
+		if (m_info.statistics && (m_pricer->required_statistics() & PathStatistic::FullPath))
+			throw std::invalid_argument("Path file: the pricer needs whole paths, only their statistics are recorded.");
+	}
+}
+
+double PathRecorder::merge_slot(std::size_t slot)
+{
+	return m_pricer ? m_pricer->merge_slot(slot) : 0.0;
+}
+
+void PathRecorder::truncate(std::size_t nSlots)
+{
+	PricerAbstract::truncate(nSlots);
+	m_slotSamples.resize(nSlots);
+	if (m_pricer)
+		m_pricer->truncate(nSlots);
+}
+
+double* PathRecorder::block_data(std::size_t slot, std::size_t nSamples)
+{
+	std::size_t first = slot * m_info.chunkSize + m_slotSamples[slot];
+	if (first % m_info.blockSize != 0 || nSamples > m_info.blockSize)
+		throw std::logic_error("Path file: the engine's block size differs from the file info.");
+
+	m_slotSamples[slot] += nSamples;
+	m_partials[slot].count += nSamples;
+
+	return reinterpret_cast<double*>(m_file->data() + DataOffset + (first / m_info.blockSize) * block_bytes(m_info));
+}
+
+void PathRecorder::process_path(const std::vector<double>& path, std::size_t slot)
+{
+	throw std::logic_error("Path file: paths are recorded in block mode only.");
+}
+
+void PathRecorder::process_block(const PathBlock& block, std::size_t slot)
+{
+	if (m_info.statistics || block.nRows != m_info.NT + 1 || block.antithetic != m_info.antithetic)
+		throw std::logic_error("Path file: the blocks sent by the engine differ from the file info.");
+
+	double* to = block_data(slot, block.samples());
+	for (std::size_t j = 0; j < block.nRows; ++j)
+		std::memcpy(to + j * m_info.width(), block.row(j).data(), block.nPaths * sizeof(double));
+
+	if (m_pricer)
+		m_pricer->process_block(block, slot);
+}
+
+unsigned PathRecorder::required_statistics() const
+{
+	using namespace PathStatistic;
+	return m_info.statistics ? Terminal | Sum | LogSum | Min | Max : FullPath;
+}
+
+void PathRecorder::process_statistics(const PathStatistics& stats, std::size_t slot)
+{
+	if (!m_info.statistics || stats.nPoints != m_info.NT + 1 || stats.antithetic != m_info.antithetic)
+		throw std::logic_error("Path file: the statistics sent by the engine differ from the file info.");
+
+	double* to = block_data(slot, stats.samples());
+	const double* rows[NStatistics] = { stats.terminal, stats.sum, stats.logSum, stats.min, stats.max };
+	for (std::size_t j = 0; j < NStatistics; ++j)
+		std::memcpy(to + j * m_info.width(), rows[j], stats.nPaths * sizeof(double));
+
+	if (m_pricer)
+		m_pricer->process_statistics(stats, slot);
+}
+
+void PathRecorder::post_process(double duration)
+{
+	std::size_t nSamples{};
+	for (std::size_t samples : m_slotSamples)
+		nSamples += samples;
+	m_NSim = nSamples;
+
+	// Only the recorded samples are kept (adaptive runs stop early)
+	m_file->resize(DataOffset + block_count(nSamples, m_info) * block_bytes(m_info));
+
+	FileHeader header{};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.statistics = m_info.statistics;
+	const OptionData& od = m_info.data;
+	header.S0 = od.S0; header.K = od.K; header.T = od.T; header.r = od.r; header.vol = od.vol; header.q = od.q;
+	header.H = od.H; header.betaCEV = od.betaCEV; header.scale = od.scale;
+	copy_name(header.model, m_info.model);
+	copy_name(header.scheme, m_info.scheme);
+	copy_name(header.rng, m_info.rng);
+	header.seed = m_info.seed;
+	header.NT = m_info.NT;
+	header.nSim = m_info.nSim;
+	header.nSamples = nSamples;
+	header.chunkSize = m_info.chunkSize;
+	header.blockSize = m_info.blockSize;
+	header.antithetic = m_info.antithetic;
+	header.dataOffset = DataOffset;
+	std::memcpy(m_file->data(), &header, sizeof(header));
+	m_file.reset();
+
+	if (m_pricer)
+	{
+		m_pricer->post_process(duration);
+		m_callPrice = m_pricer->call_price();
+		m_putPrice = m_pricer->put_price();
+		m_callError = m_pricer->call_standard_error();
+		m_putError = m_pricer->put_standard_error();
+	}
+
+	if (m_display)
+		std::cout << "\nRecorded " << nSamples << " samples to " << m_path << " in " << duration << "s\n";
+}
+
+bool PathRecorder::supports_control(ControlVariate::Kind kind) const
+{
+	return false;
+}
+
+//--------------Replay-----------------
+
+PathReplay::PathReplay(const std::string& path)
+	: m_file{ MappedFile::open(path) }, m_nBlocks{}
+{
+	FileHeader header{};
+	if (m_file.size() < DataOffset)
+		throw std::invalid_argument("Not a path file: " + path);
+	std::memcpy(&header, m_file.data(), sizeof(header));
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.dataOffset != DataOffset)
+		throw std::invalid_argument("Not a path file (or another version): " + path);
+
+	m_info.statistics = header.statistics != 0;
+	OptionData& od = m_info.data;
+	od.S0 = header.S0; od.K = header.K; od.T = header.T; od.r = header.r; od.vol = header.vol; od.q = header.q;
+	od.H = header.H; od.betaCEV = header.betaCEV; od.scale = header.scale;
+	m_info.model = read_name(header.model);
+	m_info.scheme = read_name(header.scheme);
+	m_info.rng = read_name(header.rng);
+	m_info.seed = header.seed;
+	m_info.NT = header.NT;
+	m_info.chunkSize = header.chunkSize;
+	m_info.blockSize = header.blockSize;
+	m_info.antithetic = header.antithetic != 0;
+	// Samples actually recorded: the replay covers those only
+	m_info.nSim = m_info.antithetic ? 2 * header.nSamples : header.nSamples;
+
+	m_nBlocks = block_count(m_info.samples(), m_info);
+	if (m_file.size() < DataOffset + m_nBlocks * block_bytes(m_info))
+		throw std::invalid_argument("Truncated path file: " + path);
+}
+
+const PathFileInfo& PathReplay::info() const
+{
+	return m_info;
+}
+
+PathBlock PathReplay::block(std::size_t k) const
+{
+	std::size_t nSamples = std::min(m_info.blockSize, m_info.samples() - k * m_info.blockSize);
+	const double* data = reinterpret_cast<const double*>(m_file.data() + DataOffset + k * block_bytes(m_info));
+
+	return PathBlock{ data, m_info.antithetic ? 2 * nSamples : nSamples, m_info.width(), m_info.NT + 1, m_info.antithetic };
+}
+
+PathStatistics PathReplay::statistics(std::size_t k) const
+{
+	std::size_t nSamples = std::min(m_info.blockSize, m_info.samples() - k * m_info.blockSize);
+	const double* data = reinterpret_cast<const double*>(m_file.data() + DataOffset + k * block_bytes(m_info));
+	std::size_t width = m_info.width();
+
+	return PathStatistics{ m_info.antithetic ? 2 * nSamples : nSamples, m_info.NT + 1, data, data + width, data + 2 * width, data + 3 * width,
+		data + 4 * width, m_info.antithetic };
+}
@@ -10,8 +10,11 @@
 #include <cmath>
 #include <iostream>
 #include <numeric>
+#include <sstream>
+#include <utility>
 
 #include "PricerDerived.hpp"
+#include "SIMDMath.hpp"
 
 //--------------European Option-----------------
 
@@ -19,62 +22,290 @@ EuropeanPricer::EuropeanPricer(const PayoffFunc& callpayoff, const PayoffFunc& p
 	: PricerAbstract(callpayoff, putpayoff, discounter, nSim)
 {}
 
-void EuropeanPricer::process_path(const std::vector<double>& path)
+EuropeanPricer::EuropeanPricer(double strike, const DiscounterFunc& discounter, std::size_t nSim)
+	: PricerAbstract(strike, discounter, nSim)
+{}
+
+void EuropeanPricer::process_path(const std::vector<double>& path, std::size_t slot)
+{
+	// Each path simulation is added to the sums of its slot
+	accumulate(slot, 1, false, [&](std::size_t)
+		{
+			return PathSample{ call_payoff(path.back()), put_payoff(path.back()), path.back() };
+		});
+	accumulate_greeks(slot, PathBlock{ path.data(), 1, 1, path.size() });
+}
+
+void EuropeanPricer::process_block(const PathBlock& block, std::size_t slot)
+{
+	std::span<const double> terminal = block.back(); // Only the terminal row is needed
+	accumulate(slot, block.nPaths, block.antithetic, [&](std::size_t p)
+		{
+			return PathSample{ call_payoff(terminal[p]), put_payoff(terminal[p]), terminal[p] };
+		});
+	accumulate_greeks(slot, block);
+}
+
+void EuropeanPricer::payoffs(const PathBlock& block, std::span<double> calls, std::span<double> puts) const
+{
+	std::span<const double> terminal = block.back();
+	for (std::size_t p = 0; p < block.nPaths; ++p)
+	{
+		calls[p] = call_payoff(terminal[p]);
+		puts[p] = put_payoff(terminal[p]);
+	}
+}
+
+std::pair<aad::Real, aad::Real> EuropeanPricer::adjoint_payoffs(std::span<const aad::Real> path) const
 {
-	m_callSum += m_callPayoff(path.back()); // Each path simulation is added to the sum variable
-	m_putSum += m_putPayoff(path.back());
-	m_NSim.fetch_add(1, std::memory_order_relaxed); // Increment the simulation counter
+	if (!m_vanilla)
+		throw std::logic_error("Differentiable payoffs need the vanilla payoffs.");
+
+	const aad::Real& S = path.back();
+	return { max(S - m_strike, 0.0), max(m_strike - S, 0.0) };
+}
+
+unsigned EuropeanPricer::required_statistics() const
+{
+	if (m_greeks)
+		return PathStatistic::FullPath;
+	return PathStatistic::Terminal;
+}
+
+void EuropeanPricer::process_statistics(const PathStatistics& stats, std::size_t slot)
+{
+	accumulate(slot, stats.nPaths, stats.antithetic, [&](std::size_t p)
+		{
+			return PathSample{ call_payoff(stats.terminal[p]), put_payoff(stats.terminal[p]), stats.terminal[p] };
+		});
 }
 
 void EuropeanPricer::post_process(double duration)
 {
 	// End function
+	merge();
 
 	m_callPrice = m_discounter() * m_callSum / m_NSim; // Take the average of the calculated prices and discounts them to time 0
 	m_putPrice = m_discounter() * m_putSum / m_NSim;
+	apply_estimates();
+
+	if (!m_display)
+		return;
 
 	std::cout << "\n=============================\n";
 	std::cout << "\nEUROPEAN OPTION: " << std::endl;
 
 	Interface::instance()->display_european(m_callPrice, m_putPrice, m_NSim, duration); // Call the interface to display results
+	display_statistics();
 
 	std::cout << "\n=============================\n";
 }
 
+GreekSample EuropeanPricer::greek_sample(const PathTangents& t) const
+{
+	const GreekModel& m = m_greekModel;
+	double S = t.terminal;
+	double callSlope = S > m_strike ? 1.0 : 0.0; // Derivatives of the payoffs w.r.t. S_T
+	double putSlope = S < m_strike ? -1.0 : 0.0;
+
+	// The pathwise delta slope * S_T / S0 is not differentiable again: its derivative is taken on the
+	// path density instead, d/dS0 E[slope S_T] / S0 = E[slope S_T (score - 1 / S0)] / S0 with the score of the first step
+	double gammaWeight = S * (t.deltaScore - 1.0 / m.S0) / m.S0;
+
+	GreekSample s;
+	s.call = { callSlope * S / m.S0, callSlope * gammaWeight, callSlope * t.vegaTerminal, callSlope * t.rhoTerminal - m.T * std::max(S - m_strike, 0.0) };
+	s.put = { putSlope * S / m.S0, putSlope * gammaWeight, putSlope * t.vegaTerminal, putSlope * t.rhoTerminal - m.T * std::max(m_strike - S, 0.0) };
+
+	return s;
+}
+
 //--------------Asian Option-----------------
 
 AsianPricer::AsianPricer(const PayoffFunc& callpayoff, const PayoffFunc& putpayoff, const DiscounterFunc& discounter, std::size_t nSim)
-	: PricerAbstract(callpayoff, putpayoff, discounter, nSim), m_geom_callSum{}, m_geom_callPrice{}, m_geom_putSum{}, m_geom_putPrice{}
+	: PricerAbstract(callpayoff, putpayoff, discounter, nSim), m_geomPartials(1), m_geom_callSum{}, m_geom_putSum{}, m_geom_callPrice{}, m_geom_putPrice{}
+{}
+
+AsianPricer::AsianPricer(double strike, const DiscounterFunc& discounter, std::size_t nSim)
+	: PricerAbstract(strike, discounter, nSim), m_geomPartials(1), m_geom_callSum{}, m_geom_putSum{}, m_geom_callPrice{}, m_geom_putPrice{}
 {}
 
-void AsianPricer::process_path(const std::vector<double>& path)
+void AsianPricer::prepare(std::size_t nSlots)
+{
+	PricerAbstract::prepare(nSlots);
+	m_geomPartials.assign(nSlots, PartialSums{});
+}
+
+void AsianPricer::truncate(std::size_t nSlots)
+{
+	PricerAbstract::truncate(nSlots);
+	m_geomPartials.resize(nSlots);
+}
+
+void AsianPricer::process_path(const std::vector<double>& path, std::size_t slot)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
 	double avg = Average(path);
 	double geom_avg = GeometricAverage(path);
-    
-	m_callSum += m_callPayoff(avg); 
-	m_geom_callSum += m_callPayoff(geom_avg);
-	m_putSum += m_putPayoff(avg);
-	m_geom_putSum += m_putPayoff(geom_avg);
-	m_NSim.fetch_add(1, std::memory_order_relaxed);
+
+	accumulate(slot, 1, false, [&](std::size_t)
+		{
+			return PathSample{ call_payoff(avg), put_payoff(avg), path.back(), geom_avg };
+		});
+	accumulate_sums(m_geomPartials[slot], 1, false, [&](std::size_t)
+		{
+			return std::pair{ call_payoff(geom_avg), put_payoff(geom_avg) };
+		});
+	accumulate_greeks(slot, PathBlock{ path.data(), 1, 1, path.size() });
+}
+
+void AsianPricer::process_block(const PathBlock& block, std::size_t slot)
+{
+	// Running sums of the prices and of their logarithms, one per path, updated row by row
+	thread_local std::vector<double> sums, logSums, logs;
+	sums.assign(block.nPaths, 0.0);
+	logSums.assign(block.nPaths, 0.0);
+	logs.resize(block.nPaths);
+
+	for (std::size_t j = 0; j < block.nRows; ++j)
+	{
+		std::span<const double> row = block.row(j);
+		simd::log(row.data(), logs.data(), block.nPaths);
+		for (std::size_t p = 0; p < block.nPaths; ++p)
+		{
+			sums[p] += row[p];
+			logSums[p] += logs[p];
+		}
+	}
+
+	std::span<const double> terminal = block.back();
+	accumulate(slot, block.nPaths, block.antithetic, [&](std::size_t p)
+		{
+			double avg = sums[p] / block.nRows;
+			return PathSample{ call_payoff(avg), put_payoff(avg), terminal[p], std::exp(logSums[p] / block.nRows) };
+		});
+	accumulate_sums(m_geomPartials[slot], block.nPaths, block.antithetic, [&](std::size_t p)
+		{
+			double geom_avg = std::exp(logSums[p] / block.nRows);
+			return std::pair{ call_payoff(geom_avg), put_payoff(geom_avg) };
+		});
+	accumulate_greeks(slot, block);
+}
+
+void AsianPricer::payoffs(const PathBlock& block, std::span<double> calls, std::span<double> puts) const
+{
+	// Arithmetic average, the row sums are kept in calls until the payoffs are evaluated
+	std::fill(calls.begin(), calls.begin() + block.nPaths, 0.0);
+	for (std::size_t j = 0; j < block.nRows; ++j)
+	{
+		std::span<const double> row = block.row(j);
+		for (std::size_t p = 0; p < block.nPaths; ++p)
+			calls[p] += row[p];
+	}
+
+	for (std::size_t p = 0; p < block.nPaths; ++p)
+	{
+		double avg = calls[p] / block.nRows;
+		calls[p] = call_payoff(avg);
+		puts[p] = put_payoff(avg);
+	}
+}
+
+std::pair<aad::Real, aad::Real> AsianPricer::adjoint_payoffs(std::span<const aad::Real> path) const
+{
+	if (!m_vanilla)
+		throw std::logic_error("Differentiable payoffs need the vanilla payoffs.");
+
+	aad::Real sum;
+	for (const aad::Real& S : path)
+		sum += S;
+	aad::Real avg = sum / static_cast<double>(path.size());
+
+	return { max(avg - m_strike, 0.0), max(m_strike - avg, 0.0) };
+}
+
+unsigned AsianPricer::required_statistics() const
+{
+	if (m_greeks)
+		return PathStatistic::FullPath;
+
+	bool terminal = std::any_of(m_controls.begin(), m_controls.end(), [](const ControlVariate& control)
+		{
+			return control.kind != ControlVariate::Kind::GeometricAverage;
+		});
+
+	return PathStatistic::Sum | PathStatistic::LogSum | (terminal ? PathStatistic::Terminal : 0u);
+}
+
+bool AsianPricer::supports_control(ControlVariate::Kind kind) const
+{
+	return true; // The geometric average is computed next to the arithmetic one
+}
+
+void AsianPricer::process_statistics(const PathStatistics& stats, std::size_t slot)
+{
+	accumulate(slot, stats.nPaths, stats.antithetic, [&](std::size_t p)
+		{
+			double avg = stats.sum[p] / stats.nPoints;
+			double terminal = stats.terminal ? stats.terminal[p] : 0.0;
+			return PathSample{ call_payoff(avg), put_payoff(avg), terminal, std::exp(stats.logSum[p] / stats.nPoints) };
+		});
+	accumulate_sums(m_geomPartials[slot], stats.nPaths, stats.antithetic, [&](std::size_t p)
+		{
+			double geom_avg = std::exp(stats.logSum[p] / stats.nPoints);
+			return std::pair{ call_payoff(geom_avg), put_payoff(geom_avg) };
+		});
 }
 
 void AsianPricer::post_process(double duration)
 {
+	merge();
+	m_geom_callSum = 0.0;
+	m_geom_putSum = 0.0;
+	for (const PartialSums& geomPartial : m_geomPartials)
+	{ // Same fixed slot order as merge()
+		m_geom_callSum += geomPartial.callSum;
+		m_geom_putSum += geomPartial.putSum;
+	}
+
 	m_callPrice = m_discounter() * m_callSum / m_NSim;
 	m_geom_callPrice = m_discounter() * m_geom_callSum / m_NSim;
 	m_putPrice = m_discounter() * m_putSum / m_NSim;
 	m_geom_putPrice = m_discounter() * m_geom_putSum / m_NSim;
+	apply_estimates();
+
+	if (!m_display)
+		return;
 
 	std::cout << "\n=============================\n";
 	std::cout << "\nASIAN OPTION: " << std::endl;
 
 	Interface::instance()->display_asian(m_callPrice, m_putPrice, m_geom_callPrice, m_geom_putPrice, m_NSim, duration);
+	display_statistics();
 
 	std::cout << "\n=============================\n";
 }
 
+GreekSample AsianPricer::greek_sample(const PathTangents& t) const
+{
+	const GreekModel& m = m_greekModel;
+	double A = t.average;
+	double callSlope = A > m_strike ? 1.0 : 0.0; // Derivatives of the payoffs w.r.t. the average
+	double putSlope = A < m_strike ? -1.0 : 0.0;
+
+	// d/dS0 E[slope A] / S0 with the score of the path density: E[slope A (score - 1 / S0)] / S0. S0 itself is one of
+	// the averaged points when S_1..S_NT are held fixed: dA/dS0 = 1 / (NT + 1) adds slope / ((NT + 1) S0), and the jump
+	// of the slope at A = K adds density_A(K) K / ((NT + 1) S0). Differentiating P(A > K) both ways gives
+	// density_A(K) = E[1{A > K} score] / (K / S0 - 1 / (NT + 1)), hence the last term (none if A > K on every path)
+	double n = static_cast<double>(t.nPoints);
+	double jump = m_strike * n > m.S0 ? t.deltaScore * m_strike / (n * m_strike - m.S0) : 0.0;
+	double gammaWeight = (A * (t.deltaScore - 1.0 / m.S0) + 1.0 / n) / m.S0 + jump;
+
+	GreekSample s;
+	s.call = { callSlope * A / m.S0, callSlope * gammaWeight, callSlope * t.vegaAverage, callSlope * t.rhoAverage - m.T * std::max(A - m_strike, 0.0) };
+	s.put = { putSlope * A / m.S0, putSlope * gammaWeight, putSlope * t.vegaAverage, putSlope * t.rhoAverage - m.T * std::max(m_strike - A, 0.0) };
+
+	return s;
+}
+
 double AsianPricer::Average(const std::vector<double>& path)
 {
 	double avg = std::accumulate(path.begin(), path.end(), 0.0);
@@ -84,10 +315,11 @@ double AsianPricer::Average(const std::vector<double>& path)
 
 double AsianPricer::GeometricAverage(const std::vector<double>& path)
 {
-	double log_sum = std::accumulate(path.begin(), path.end(), 0.0, [](double sum, double value)
-		{
-			return sum + std::log(value);
-		});
+	// Logarithms of the whole path at once
+	thread_local std::vector<double> logs;
+	logs.resize(path.size());
+	simd::log(path.data(), logs.data(), path.size());
+	double log_sum = std::accumulate(logs.begin(), logs.end(), 0.0);
 
 	// Calculate the geometric mean by taking the exponential of the averaged logarithm sum
 	return std::exp(log_sum / path.size());
@@ -106,56 +338,146 @@ BarrierPricer::BarrierPricer(const PayoffFunc& callpayoff, const PayoffFunc& put
 	: PricerAbstract(callpayoff, putpayoff, discounter, nSim), m_barrierType{}, m_barrierAmount{}
 {}
 
-void BarrierPricer::process_path(const std::vector<double>& path)
+BarrierPricer::BarrierPricer(double strike, const DiscounterFunc& discounter, std::size_t nSim)
+	: PricerAbstract(strike, discounter, nSim), m_barrierType{}, m_barrierAmount{}
+{}
+
+void BarrierPricer::process_path(const std::vector<double>& path, std::size_t slot)
 {
 	auto [min, max] = std::minmax_element(path.begin(), path.end());
+	bool active = is_active(*min, *max);
 
-	switch (m_barrierType)
+	accumulate(slot, 1, false, [&](std::size_t)
+		{
+			if (!active)
+				return PathSample{ 0.0, 0.0, path.back() };
+			return PathSample{ call_payoff(path.back()), put_payoff(path.back()), path.back() };
+		});
+	accumulate_greeks(slot, PathBlock{ path.data(), 1, 1, path.size() });
+}
+
+void BarrierPricer::process_block(const PathBlock& block, std::size_t slot)
+{
+	// Running extrema, one per path, updated row by row
+	thread_local std::vector<double> mins, maxs;
+	mins.assign(block.row(0).begin(), block.row(0).end());
+	maxs.assign(block.row(0).begin(), block.row(0).end());
+
+	for (std::size_t j = 1; j < block.nRows; ++j)
 	{
-	case BarrierType::Up_and_In:
-		if (*max >= m_barrierAmount)
+		std::span<const double> row = block.row(j);
+		for (std::size_t p = 0; p < block.nPaths; ++p)
 		{
-			m_callSum += m_callPayoff(path.back());
-			m_putSum += m_putPayoff(path.back());
+			mins[p] = std::min(mins[p], row[p]);
+			maxs[p] = std::max(maxs[p], row[p]);
 		}
-		break;
-	case BarrierType::Up_and_Out:
-		if (*max < m_barrierAmount)
+	}
+
+	std::span<const double> terminal = block.back();
+	accumulate(slot, block.nPaths, block.antithetic, [&](std::size_t p)
 		{
-			m_callSum += m_callPayoff(path.back());
-			m_putSum += m_putPayoff(path.back());
-		}
-		break;
-	case BarrierType::Down_and_In:
-		if (*min <= m_barrierAmount)
+			if (!is_active(mins[p], maxs[p]))
+				return PathSample{ 0.0, 0.0, terminal[p] };
+			return PathSample{ call_payoff(terminal[p]), put_payoff(terminal[p]), terminal[p] };
+		});
+	accumulate_greeks(slot, block);
+}
+
+void BarrierPricer::payoffs(const PathBlock& block, std::span<double> calls, std::span<double> puts) const
+{
+	// Running extrema kept in calls (min) and puts (max) until the payoffs are evaluated
+	std::copy(block.row(0).begin(), block.row(0).end(), calls.begin());
+	std::copy(block.row(0).begin(), block.row(0).end(), puts.begin());
+	for (std::size_t j = 1; j < block.nRows; ++j)
+	{
+		std::span<const double> row = block.row(j);
+		for (std::size_t p = 0; p < block.nPaths; ++p)
 		{
-			m_callSum += m_callPayoff(path.back());
-			m_putSum += m_putPayoff(path.back());
+			calls[p] = std::min(calls[p], row[p]);
+			puts[p] = std::max(puts[p], row[p]);
 		}
-		break;
-	case BarrierType::Down_and_Out:
-		if (*min > m_barrierAmount)
+	}
+
+	std::span<const double> terminal = block.back();
+	for (std::size_t p = 0; p < block.nPaths; ++p)
+	{
+		bool active = is_active(calls[p], puts[p]);
+		calls[p] = active ? call_payoff(terminal[p]) : 0.0;
+		puts[p] = active ? put_payoff(terminal[p]) : 0.0;
+	}
+}
+
+unsigned BarrierPricer::required_statistics() const
+{
+	if (m_greeks)
+		return PathStatistic::FullPath;
+
+	bool up = m_barrierType == BarrierType::Up_and_In || m_barrierType == BarrierType::Up_and_Out;
+
+	return PathStatistic::Terminal | (up ? PathStatistic::Max : PathStatistic::Min);
+}
+
+void BarrierPricer::process_statistics(const PathStatistics& stats, std::size_t slot)
+{
+	accumulate(slot, stats.nPaths, stats.antithetic, [&](std::size_t p)
 		{
-			m_callSum += m_callPayoff(path.back());
-			m_putSum += m_putPayoff(path.back());
-		}
-		break;
+			double min = stats.min ? stats.min[p] : 0.0;
+			double max = stats.max ? stats.max[p] : 0.0;
+			if (!is_active(min, max))
+				return PathSample{ 0.0, 0.0, stats.terminal[p] };
+			return PathSample{ call_payoff(stats.terminal[p]), put_payoff(stats.terminal[p]), stats.terminal[p] };
+		});
+}
+
+bool BarrierPricer::is_active(double min, double max) const
+{
+	switch (m_barrierType)
+	{
+	case BarrierType::Up_and_In:
+		return max >= m_barrierAmount;
+	case BarrierType::Up_and_Out:
+		return max < m_barrierAmount;
+	case BarrierType::Down_and_In:
+		return min <= m_barrierAmount;
+	case BarrierType::Down_and_Out:
+		return min > m_barrierAmount;
 	}
 
-	m_NSim.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+GreekSample BarrierPricer::greek_sample(const PathTangents& t) const
+{
+	// The knock-in/out indicator has no pathwise derivative: payoff times the scores of the path density
+	bool active = is_active(t.min, t.max);
+	double call = active ? std::max(t.terminal - m_strike, 0.0) : 0.0;
+	double put = active ? std::max(m_strike - t.terminal, 0.0) : 0.0;
+	double T = m_greekModel.T;
+
+	GreekSample s;
+	s.call = { call * t.deltaScore, call * t.gammaScore, call * t.vegaScore, call * (t.rhoScore - T) };
+	s.put = { put * t.deltaScore, put * t.gammaScore, put * t.vegaScore, put * (t.rhoScore - T) };
+
+	return s;
 }
 
 void BarrierPricer::post_process(double duration)
 {
 	// End function
+	merge();
 
 	m_callPrice = m_discounter() * m_callSum / m_NSim; // Take the average of the calculated prices and discounts them to time 0
 	m_putPrice = m_discounter() * m_putSum / m_NSim;
+	apply_estimates();
+
+	if (!m_display)
+		return;
 
 	std::cout << "\n=============================\n";
 	std::cout << "\nBARRIER OPTION: " << std::endl;
 
 	Interface::instance()->display_barrier(m_callPrice, m_putPrice, m_barrierAmount, m_NSim, duration); // Call the interface to display results
+	display_statistics();
 
 	std::cout << "\n=============================\n";
 }
@@ -169,3 +491,462 @@ void BarrierPricer::set_barrier_amount(double barrierAmount)
 {
 	m_barrierAmount = barrierAmount;
 }
+
+//--------------Portfolio-----------------
+
+PortfolioPricer::PortfolioPricer(const DiscounterFunc& discounter, std::size_t nSim)
+	: PricerAbstract(PayoffFunc{}, PayoffFunc{}, discounter, nSim), m_statistics{}
+{}
+
+void PortfolioPricer::add_contract(const std::shared_ptr<PricerAbstract>& contract, const std::string& label)
+{
+	if (!contract)
+		throw std::invalid_argument("Portfolio contract must not be null.");
+
+	contract->set_display(false); // Results are displayed together
+	m_contracts.push_back(contract);
+	m_labels.push_back(label);
+}
+
+std::size_t PortfolioPricer::size() const
+{
+	return m_contracts.size();
+}
+
+const PricerAbstract& PortfolioPricer::contract(std::size_t i) const
+{
+	return *m_contracts.at(i);
+}
+
+void PortfolioPricer::prepare(std::size_t nSlots)
+{
+	if (m_contracts.empty())
+		throw std::invalid_argument("Portfolio has no contract.");
+
+	PricerAbstract::prepare(nSlots);
+	m_fullPath.assign(m_contracts.size(), false);
+	m_statistics = 0;
+	for (std::size_t i = 0; i < m_contracts.size(); ++i)
+	{
+		m_contracts[i]->prepare(nSlots);
+		unsigned flags = m_contracts[i]->required_statistics();
+		if (flags & PathStatistic::FullPath)
+			m_fullPath[i] = true;
+		else
+			m_statistics |= flags;
+	}
+}
+
+double PortfolioPricer::merge_slot(std::size_t slot)
+{
+	double error{};
+	for (const auto& contract : m_contracts)
+		error = std::max(error, contract->merge_slot(slot));
+
+	return error;
+}
+
+void PortfolioPricer::truncate(std::size_t nSlots)
+{
+	PricerAbstract::truncate(nSlots);
+	for (const auto& contract : m_contracts)
+		contract->truncate(nSlots);
+}
+
+void PortfolioPricer::process_path(const std::vector<double>& path, std::size_t slot)
+{
+	if (m_statistics)
+	{ // Statistics of the path computed once for all the contracts that stream, on the contiguous points
+		double sum = path[0], logSum{}, min = path[0], max = path[0];
+		if (m_statistics & PathStatistic::LogSum)
+		{
+			thread_local std::vector<double> logs;
+			logs.resize(path.size());
+			simd::log(path.data(), logs.data(), path.size());
+			for (double x : logs)
+				logSum += x;
+		}
+		for (std::size_t j = 1; j < path.size(); ++j)
+		{
+			sum += path[j];
+			min = std::min(min, path[j]);
+			max = std::max(max, path[j]);
+		}
+
+		PathStatistics stats{ 1, path.size(), &path.back(), &sum, &logSum, &min, &max, false };
+		for (std::size_t i = 0; i < m_contracts.size(); ++i)
+		{
+			if (!m_fullPath[i])
+				m_contracts[i]->process_statistics(stats, slot);
+		}
+	}
+
+	for (std::size_t i = 0; i < m_contracts.size(); ++i)
+	{
+		if (m_fullPath[i])
+			m_contracts[i]->process_path(path, slot);
+	}
+}
+
+void PortfolioPricer::process_block(const PathBlock& block, std::size_t slot)
+{
+	if (m_statistics)
+	{ // Statistics of the block computed once for all the contracts that stream
+		thread_local std::vector<double> buffer;
+		buffer.resize(5 * block.nPaths);
+		double* sum = buffer.data();
+		double* logSum = sum + block.nPaths;
+		double* min = logSum + block.nPaths;
+		double* max = min + block.nPaths;
+		double* logs = max + block.nPaths;	// Logarithms of the current row
+
+		std::span<const double> first = block.row(0);
+		for (std::size_t p = 0; p < block.nPaths; ++p)
+			sum[p] = min[p] = max[p] = first[p];
+		if (m_statistics & PathStatistic::LogSum)
+			simd::log(first.data(), logSum, block.nPaths);
+		else
+			std::fill(logSum, logSum + block.nPaths, 0.0);
+		for (std::size_t j = 1; j < block.nRows; ++j)
+		{
+			std::span<const double> row = block.row(j);
+			if (m_statistics & PathStatistic::Sum)
+			{
+				for (std::size_t p = 0; p < block.nPaths; ++p)
+					sum[p] += row[p];
+			}
+			if (m_statistics & PathStatistic::LogSum)
+			{
+				simd::log(row.data(), logs, block.nPaths);
+				for (std::size_t p = 0; p < block.nPaths; ++p)
+					logSum[p] += logs[p];
+			}
+			if (m_statistics & PathStatistic::Min)
+			{
+				for (std::size_t p = 0; p < block.nPaths; ++p)
+					min[p] = std::min(min[p], row[p]);
+			}
+			if (m_statistics & PathStatistic::Max)
+			{
+				for (std::size_t p = 0; p < block.nPaths; ++p)
+					max[p] = std::max(max[p], row[p]);
+			}
+		}
+
+		PathStatistics stats{ block.nPaths, block.nRows, block.back().data(), sum, logSum, min, max, block.antithetic };
+		for (std::size_t i = 0; i < m_contracts.size(); ++i)
+		{
+			if (!m_fullPath[i])
+				m_contracts[i]->process_statistics(stats, slot);
+		}
+	}
+
+	for (std::size_t i = 0; i < m_contracts.size(); ++i)
+	{
+		if (m_fullPath[i])
+			m_contracts[i]->process_block(block, slot);
+	}
+}
+
+unsigned PortfolioPricer::required_statistics() const
+{
+	unsigned flags{};
+	for (const auto& contract : m_contracts)
+		flags |= contract->required_statistics();
+
+	return (flags & PathStatistic::FullPath) ? static_cast<unsigned>(PathStatistic::FullPath) : flags;
+}
+
+void PortfolioPricer::process_statistics(const PathStatistics& stats, std::size_t slot)
+{
+	// Only called when no contract needs the whole paths
+	for (const auto& contract : m_contracts)
+		contract->process_statistics(stats, slot);
+}
+
+bool PortfolioPricer::supports_control(ControlVariate::Kind kind) const
+{
+	return false;
+}
+
+void PortfolioPricer::post_process(double duration)
+{
+	std::vector<double> calls, puts, callErrors, putErrors;
+	m_callPrice = 0.0;
+	m_putPrice = 0.0;
+	for (const auto& contract : m_contracts)
+	{
+		contract->post_process(duration);
+		calls.push_back(contract->call_price());
+		puts.push_back(contract->put_price());
+		callErrors.push_back(contract->call_standard_error());
+		putErrors.push_back(contract->put_standard_error());
+		m_callPrice += contract->call_price();
+		m_putPrice += contract->put_price();
+	}
+	m_NSim = m_contracts.front()->simulation_count();
+
+	if (!m_display)
+		return;
+
+	std::cout << "\n=============================\n";
+	std::cout << "\nPORTFOLIO: " << std::endl;
+
+	Interface::instance()->display_portfolio(m_labels, calls, puts, callErrors, putErrors, m_NSim, duration, m_quasiRandom);
+
+	std::cout << "\n=============================\n";
+}
+
+//--------------Strike Grid-----------------
+
+StrikeGridPricer::StrikeGridPricer(const std::vector<double>& strikes, Underlying underlying, const DiscounterFunc& discounter, std::size_t nSim)
+	: PricerAbstract(PayoffFunc{}, PayoffFunc{}, discounter, nSim), m_strikes{ strikes }, m_underlying{ underlying }
+{
+	if (m_strikes.empty())
+		throw std::invalid_argument("Strike grid must not be empty.");
+	if (!std::is_sorted(m_strikes.begin(), m_strikes.end()))
+		throw std::invalid_argument("Strikes must be sorted in increasing order.");
+	if (underlying != Underlying::Terminal && underlying != Underlying::Average)
+		throw std::invalid_argument("Invalid underlying of the strike grid.");
+}
+
+const std::vector<double>& StrikeGridPricer::strikes() const
+{
+	return m_strikes;
+}
+
+const std::vector<double>& StrikeGridPricer::call_prices() const
+{
+	return m_callPrices;
+}
+
+const std::vector<double>& StrikeGridPricer::put_prices() const
+{
+	return m_putPrices;
+}
+
+const std::vector<double>& StrikeGridPricer::call_errors() const
+{
+	return m_callErrors;
+}
+
+const std::vector<double>& StrikeGridPricer::put_errors() const
+{
+	return m_putErrors;
+}
+
+void StrikeGridPricer::prepare(std::size_t nSlots)
+{
+	PricerAbstract::prepare(nSlots);
+	m_bins.assign(nSlots, std::vector<Bin>(m_strikes.size() + 1, Bin{}));
+	m_runningBins.assign(m_strikes.size() + 1, Bin{});
+	m_NSim = 0;
+}
+
+double StrikeGridPricer::merge_slot(std::size_t slot)
+{
+	for (std::size_t b = 0; b < m_runningBins.size(); ++b)
+	{
+		const Bin& from = m_bins[slot][b];
+		Bin& to = m_runningBins[b];
+		to.count += from.count; to.sum += from.sum; to.sumSq += from.sumSq;
+		to.callPairs += from.callPairs; to.callPairSum += from.callPairSum; to.callPairProduct += from.callPairProduct;
+		to.putPairs += from.putPairs; to.putPairSum += from.putPairSum; to.putPairProduct += from.putPairProduct;
+	}
+	m_NSim += m_partials[slot].count;
+	estimate(m_runningBins, m_NSim);
+
+	double error{};
+	for (std::size_t k = 0; k < m_strikes.size(); ++k)
+		error = std::max({ error, m_callErrors[k], m_putErrors[k] });
+
+	return error;
+}
+
+void StrikeGridPricer::truncate(std::size_t nSlots)
+{
+	PricerAbstract::truncate(nSlots);
+	m_bins.resize(nSlots);
+}
+
+std::size_t StrikeGridPricer::bin(double x) const
+{
+	return static_cast<std::size_t>(std::lower_bound(m_strikes.begin(), m_strikes.end(), x) - m_strikes.begin());
+}
+
+void StrikeGridPricer::add(std::size_t slot, std::size_t nPaths, bool antithetic, const double* values)
+{
+	std::vector<Bin>& bins = m_bins[slot];
+	for (std::size_t p = 0; p < nPaths; ++p)
+	{
+		Bin& b = bins[bin(values[p])];
+		b.count += 1.0;
+		b.sum += values[p];
+		b.sumSq += values[p] * values[p];
+	}
+
+	std::size_t nSamples = antithetic ? nPaths / 2 : nPaths;
+	if (antithetic)
+	{ // Cross terms of the squared pair averages
+		for (std::size_t p = 0; p < nSamples; ++p)
+		{
+			double x1 = values[p], x2 = values[p + nSamples];
+			Bin& call = bins[bin(std::min(x1, x2))];
+			call.callPairs += 1.0;
+			call.callPairSum += x1 + x2;
+			call.callPairProduct += x1 * x2;
+			Bin& put = bins[bin(std::max(x1, x2))];
+			put.putPairs += 1.0;
+			put.putPairSum += x1 + x2;
+			put.putPairProduct += x1 * x2;
+		}
+	}
+	m_partials[slot].count += nSamples;
+}
+
+void StrikeGridPricer::estimate(const std::vector<Bin>& bins, std::size_t nSamples)
+{
+	std::size_t nStrikes = m_strikes.size();
+	m_callPrices.assign(nStrikes, 0.0);
+	m_putPrices.assign(nStrikes, 0.0);
+	m_callErrors.assign(nStrikes, 0.0);
+	m_putErrors.assign(nStrikes, 0.0);
+	if (nSamples == 0)
+		return;
+
+	Bin total{};
+	for (const Bin& b : bins)
+	{
+		total.count += b.count; total.sum += b.sum; total.sumSq += b.sumSq;
+		total.callPairs += b.callPairs; total.callPairSum += b.callPairSum; total.callPairProduct += b.callPairProduct;
+	}
+	bool antithetic = total.count > static_cast<double>(nSamples); // Two paths per sample
+
+	double discount = m_discounter();
+	double n = static_cast<double>(nSamples);
+	auto finish = [&](double sum, double sumSq, double cross, double& price, double& error)
+		{ // Moments of the samples: the payoffs, or the averages of the pairs
+			if (antithetic)
+			{
+				sum *= 0.5;
+				sumSq = 0.25 * (sumSq + 2.0 * cross);
+			}
+			double mean = sum / n;
+			price = discount * mean;
+			error = n > 1.0 ? discount * std::sqrt(std::max(sumSq - n * mean * mean, 0.0) / (n - 1.0) / n) : 0.0;
+		};
+
+	// Prefix sums over the bins below the strike (puts), the calls take the rest
+	Bin below{};
+	for (std::size_t k = 0; k < nStrikes; ++k)
+	{
+		const Bin& b = bins[k];
+		below.count += b.count; below.sum += b.sum; below.sumSq += b.sumSq;
+		below.callPairs += b.callPairs; below.callPairSum += b.callPairSum; below.callPairProduct += b.callPairProduct;
+		below.putPairs += b.putPairs; below.putPairSum += b.putPairSum; below.putPairProduct += b.putPairProduct;
+
+		double K = m_strikes[k];
+		double count = total.count - below.count, sum = total.sum - below.sum, sumSq = total.sumSq - below.sumSq;
+		double pairs = total.callPairs - below.callPairs;
+		double callCross = (total.callPairProduct - below.callPairProduct) - K * (total.callPairSum - below.callPairSum) + K * K * pairs;
+		finish(sum - K * count, sumSq - 2.0 * K * sum + K * K * count, callCross, m_callPrices[k], m_callErrors[k]);
+
+		double putCross = K * K * below.putPairs - K * below.putPairSum + below.putPairProduct;
+		finish(K * below.count - below.sum, K * K * below.count - 2.0 * K * below.sum + below.sumSq, putCross, m_putPrices[k], m_putErrors[k]);
+	}
+}
+
+void StrikeGridPricer::process_path(const std::vector<double>& path, std::size_t slot)
+{
+	double x = m_underlying == Underlying::Terminal ? path.back() : std::accumulate(path.begin(), path.end(), 0.0) / path.size();
+	add(slot, 1, false, &x);
+}
+
+void StrikeGridPricer::process_block(const PathBlock& block, std::size_t slot)
+{
+	thread_local std::vector<double> values;
+	if (m_underlying == Underlying::Terminal)
+	{
+		values.assign(block.back().begin(), block.back().end());
+	}
+	else
+	{
+		values.assign(block.nPaths, 0.0);
+		for (std::size_t j = 0; j < block.nRows; ++j)
+		{
+			std::span<const double> row = block.row(j);
+			for (std::size_t p = 0; p < block.nPaths; ++p)
+				values[p] += row[p];
+		}
+		for (double& value : values)
+			value /= block.nRows;
+	}
+
+	add(slot, block.nPaths, block.antithetic, values.data());
+}
+
+unsigned StrikeGridPricer::required_statistics() const
+{
+	return m_underlying == Underlying::Terminal ? PathStatistic::Terminal : PathStatistic::Sum;
+}
+
+void StrikeGridPricer::process_statistics(const PathStatistics& stats, std::size_t slot)
+{
+	if (m_underlying == Underlying::Terminal)
+	{
+		add(slot, stats.nPaths, stats.antithetic, stats.terminal);
+		return;
+	}
+
+	thread_local std::vector<double> values;
+	values.resize(stats.nPaths);
+	for (std::size_t p = 0; p < stats.nPaths; ++p)
+		values[p] = stats.sum[p] / stats.nPoints;
+	add(slot, stats.nPaths, stats.antithetic, values.data());
+}
+
+bool StrikeGridPricer::supports_control(ControlVariate::Kind kind) const
+{
+	return false;
+}
+
+void StrikeGridPricer::post_process(double duration)
+{
+	// Bins merged in slot order
+	std::vector<Bin> bins(m_strikes.size() + 1, Bin{});
+	m_NSim = 0;
+	for (std::size_t slot = 0; slot < m_bins.size(); ++slot)
+	{
+		for (std::size_t b = 0; b < bins.size(); ++b)
+		{
+			const Bin& from = m_bins[slot][b];
+			Bin& to = bins[b];
+			to.count += from.count; to.sum += from.sum; to.sumSq += from.sumSq;
+			to.callPairs += from.callPairs; to.callPairSum += from.callPairSum; to.callPairProduct += from.callPairProduct;
+			to.putPairs += from.putPairs; to.putPairSum += from.putPairSum; to.putPairProduct += from.putPairProduct;
+		}
+		m_NSim += m_partials[slot].count;
+	}
+	estimate(bins, m_NSim);
+	m_callPrice = m_callPrices.front();
+	m_putPrice = m_putPrices.front();
+	m_callError = m_callErrors.front();
+	m_putError = m_putErrors.front();
+
+	if (!m_display)
+		return;
+
+	std::cout << "\n=============================\n";
+	std::cout << "\nSTRIKE GRID: " << std::endl;
+
+	std::vector<std::string> labels;
+	for (double K : m_strikes)
+	{
+		std::ostringstream label;
+		label << (m_underlying == Underlying::Terminal ? "European" : "Asian") << " K = " << K;
+		labels.push_back(label.str());
+	}
+	Interface::instance()->display_portfolio(labels, m_callPrices, m_putPrices, m_callErrors, m_putErrors, m_NSim, duration, m_quasiRandom);
+
+	std::cout << "\n=============================\n";
+}
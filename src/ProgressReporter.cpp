@@ -0,0 +1,79 @@
+// ProgressReporter.cpp
+//
+// Implementation of ProgressReporter.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ProgressReporter.hpp"
+
+ProgressReporter::ProgressReporter(std::size_t total, std::size_t nThreads, Interval interval, Callback callback)
+	: m_total{ total }, m_nThreads{ std::max<std::size_t>(nThreads, 1) }, m_interval{ interval }, m_callback{ std::move(callback) },
+	m_counters{ std::make_unique<Counter[]>(m_nThreads) }, m_start{ std::chrono::steady_clock::now() }, m_stopped{ false }
+{
+	m_reporter = std::jthread([this](std::stop_token token) { run(token); });
+}
+
+ProgressReporter::~ProgressReporter()
+{
+	stop();
+}
+
+void ProgressReporter::stop()
+{
+	if (m_stopped)
+		return;
+
+	m_reporter.request_stop();
+	if (m_reporter.joinable())
+		m_reporter.join();
+	m_stopped = true;
+
+	if (m_callback)
+		m_callback(snapshot(true));
+}
+
+ProgressSnapshot ProgressReporter::snapshot(bool finished) const
+{
+	std::size_t done{};
+	for (std::size_t t = 0; t < m_nThreads; ++t)
+		done += m_counters[t].value.load(std::memory_order_relaxed);
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	double rate = elapsed > 0.0 ? done / elapsed : 0.0;
+	double eta = rate > 0.0 && done < m_total ? (m_total - done) / rate : 0.0;
+
+	return { done, m_total, elapsed, rate, eta, finished };
+}
+
+void ProgressReporter::run(std::stop_token token)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		// Returns early once stop() is called
+		m_wakeUp.wait_for(lock, token, m_interval, []() { return false; });
+		if (token.stop_requested())
+			return;
+
+		if (m_callback)
+			m_callback(snapshot());
+	}
+}
+
+ProgressReporter::Callback ProgressReporter::console()
+{
+	return [](const ProgressSnapshot& progress)
+		{
+			std::ostringstream line;
+			line << "\rSimulations: " << progress.done << " / " << progress.total << " (" << std::fixed << std::setprecision(1)
+				<< (progress.total > 0 ? 100.0 * progress.done / progress.total : 100.0) << "%), " << std::setprecision(0) << progress.rate
+				<< " paths/s, ETA " << std::setprecision(1) << progress.eta << "s   ";
+			std::cout << line.str() << (progress.finished ? "\n" : "") << std::flush; // Use \r to overwrite the line
+		};
+}
@@ -5,9 +5,76 @@
 // Pierre-Yves Sojic
 //
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <numbers>
 #include <random>
+#include <stdexcept>
 
 #include "RNGDerived.hpp"
+#include "SIMDMath.hpp"
+#include "SobolTable.hpp"
+
+namespace
+{
+    constexpr std::size_t TransformBatch = 256;  // Pairs transformed together by the vector math
+
+    // Box-Muller over arrays of at most TransformBatch uniforms, U1 in (0,1]:
+    // on return u1 holds R cos(theta) and u2 holds R sin(theta), R = sqrt(-2 log U1), theta = 2 pi U2
+    void box_muller(double* u1, double* u2, std::size_t n)
+    {
+        double c[TransformBatch];
+
+        simd::log(u1, u1, n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            u1[i] *= -2.0;
+            u2[i] *= 2.0 * std::numbers::pi;
+        }
+        simd::sqrt(u1, u1, n);
+        simd::sincos(u2, u2, c, n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            u2[i] *= u1[i];
+            u1[i] *= c[i];
+        }
+    }
+}
+
+double inverse_normal_cdf(double p)
+{
+    // Coefficients of the rational approximations (P. J. Acklam)
+    constexpr double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                              1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+    constexpr double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                              6.680131188771972e+01, -1.328068155288572e+01 };
+    constexpr double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                             -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+    constexpr double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                             3.754408661907416e+00 };
+    constexpr double pLow = 0.02425;
+
+    if (p < pLow)
+    { // Lower tail
+        double q = std::sqrt(-2.0 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    if (p > 1.0 - pLow)
+    { // Upper tail
+        double q = std::sqrt(-2.0 * std::log1p(-p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+
+    // Central region
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+        (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
 
 thread_local std::mt19937_64 MersenneTwister::m_randomEngine{ std::random_device{}() };
 
@@ -18,6 +85,17 @@ double MersenneTwister::generate_rn() const
     return normDist(m_randomEngine);
 }
 
+void MersenneTwister::fill(std::span<double> normals) const
+{
+    // A single distribution for the whole block so that the spare variate it caches is not lost
+    std::normal_distribution<double> normDist(0.0, 1.0);
+
+    for (double& z : normals)
+    {
+        z = normDist(m_randomEngine);
+    }
+}
+
 thread_local std::default_random_engine PolarMarsagliaNet::m_randomEngine{ std::random_device{}() };
 
 double PolarMarsagliaNet::generate_rn() const
@@ -38,6 +116,42 @@ double PolarMarsagliaNet::generate_rn() const
     return u * fac;
 }
 
+void PolarMarsagliaNet::fill(std::span<double> normals) const
+{
+    std::uniform_real_distribution<double> unifDist(0.0, 1.0);
+
+    double u[TransformBatch], v[TransformBatch], S[TransformBatch], fac[TransformBatch];
+
+    for (std::size_t i = 0; i < normals.size(); i += 2 * TransformBatch)
+    {
+        std::size_t nPairs = std::min(TransformBatch, (normals.size() - i + 1) / 2);
+
+        for (std::size_t k = 0; k < nPairs; ++k)
+        {
+            do
+            {
+                u[k] = 2.0 * unifDist(m_randomEngine) - 1.0;
+                v[k] = 2.0 * unifDist(m_randomEngine) - 1.0;
+                S[k] = u[k] * u[k] + v[k] * v[k];
+            } while (S[k] > 1.0 || S[k] <= 0.0);
+        }
+
+        // sqrt(-2 log(S) / S) for the whole batch
+        simd::log(S, fac, nPairs);
+        for (std::size_t k = 0; k < nPairs; ++k)
+            fac[k] *= -2.0 / S[k];
+        simd::sqrt(fac, fac, nPairs);
+
+        // Keep both variates of the pair
+        for (std::size_t k = 0; k < nPairs; ++k)
+        {
+            normals[i + 2 * k] = u[k] * fac[k];
+            if (i + 2 * k + 1 < normals.size())
+                normals[i + 2 * k + 1] = v[k] * fac[k];
+        }
+    }
+}
+
 thread_local std::default_random_engine BoxMuller::m_randomEngine{ std::random_device{}() };
 
 double BoxMuller::generate_rn() const
@@ -53,5 +167,391 @@ double BoxMuller::generate_rn() const
     } while (U1 <= 0.0);
 
     // Box-Muller method
-    return std::sqrt(- 2.0 * std::log(U1)) * std::cos(2.0 * 3.1415159 * U2);
+    return std::sqrt(- 2.0 * std::log(U1)) * std::cos(2.0 * std::numbers::pi * U2);
+}
+
+
+void BoxMuller::fill(std::span<double> normals) const
+{
+    std::uniform_real_distribution<double> unifDist(0.0, 1.0);
+
+    double U1[TransformBatch], U2[TransformBatch];
+
+    for (std::size_t i = 0; i < normals.size(); i += 2 * TransformBatch)
+    {
+        std::size_t nPairs = std::min(TransformBatch, (normals.size() - i + 1) / 2);
+
+        for (std::size_t k = 0; k < nPairs; ++k)
+        {
+            do
+            {
+                U1[k] = unifDist(m_randomEngine);   // In interval [0,1)
+                U2[k] = unifDist(m_randomEngine);  // In interval [0,1)
+            } while (U1[k] <= 0.0);
+        }
+
+        box_muller(U1, U2, nPairs);
+
+        // Keep both variates of the pair
+        for (std::size_t k = 0; k < nPairs; ++k)
+        {
+            normals[i + 2 * k] = U1[k];
+            if (i + 2 * k + 1 < normals.size())
+                normals[i + 2 * k + 1] = U2[k];
+        }
+    }
+}
+
+//--------------Philox-----------------
+
+namespace
+{
+    constexpr std::uint32_t PhiloxM0 = 0xD2511F53;  // Round multipliers
+    constexpr std::uint32_t PhiloxM1 = 0xCD9E8D57;
+    constexpr std::uint32_t PhiloxW0 = 0x9E3779B9;  // Weyl sequence for the key schedule
+    constexpr std::uint32_t PhiloxW1 = 0xBB67AE85;
+
+    // Uniform in the open interval (0,1) from the top 53 bits of a 64 bits integer
+    double to_open_unit(std::uint64_t x)
+    {
+        return (static_cast<double>(x >> 11) + 0.5) * 0x1.0p-53;
+    }
+}
+
+thread_local std::uint64_t Philox::m_stream{};
+thread_local std::uint64_t Philox::m_position{};
+
+Philox::Philox(std::uint64_t seed)
+    : m_seed{ seed }
+{}
+
+std::uint64_t Philox::seed() const
+{
+    return m_seed;
+}
+
+Philox::Block Philox::bijection(Block ctr, Key key)
+{
+    for (int round = 0; round < 10; ++round)
+    {
+        std::uint64_t p0 = static_cast<std::uint64_t>(PhiloxM0) * ctr[0];
+        std::uint64_t p1 = static_cast<std::uint64_t>(PhiloxM1) * ctr[2];
+
+        ctr = { static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<std::uint32_t>(p1),
+                static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<std::uint32_t>(p0) };
+
+        key[0] += PhiloxW0;
+        key[1] += PhiloxW1;
+    }
+
+    return ctr;
+}
+
+void Philox::uniform_pair(std::uint64_t stream, std::uint64_t pair, double& U1, double& U2) const
+{
+    // Counter = (index of the pair, stream), key = seed
+    Block ctr{ static_cast<std::uint32_t>(pair), static_cast<std::uint32_t>(pair >> 32),
+               static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32) };
+    Key key{ static_cast<std::uint32_t>(m_seed), static_cast<std::uint32_t>(m_seed >> 32) };
+    Block bits = bijection(ctr, key);
+
+    U1 = to_open_unit((static_cast<std::uint64_t>(bits[1]) << 32) | bits[0]);
+    U2 = to_open_unit((static_cast<std::uint64_t>(bits[3]) << 32) | bits[2]);
+}
+
+void Philox::normal_pair(std::uint64_t stream, std::uint64_t pair, double& z0, double& z1) const
+{
+    // Box-Muller on the two uniforms, both variates are kept (same transform as fill)
+    uniform_pair(stream, pair, z0, z1);
+    box_muller(&z0, &z1, 1);
+}
+
+void Philox::seek(std::uint64_t stream, std::uint64_t offset) const
+{
+    m_stream = stream;
+    m_position = offset;
+}
+
+double Philox::generate_rn() const
+{
+    double z0, z1;
+    normal_pair(m_stream, m_position / 2, z0, z1);
+
+    return (m_position++ % 2 == 0) ? z0 : z1;
+}
+
+void Philox::fill(std::span<double> normals) const
+{
+    std::size_t i = 0;
+    double U1[TransformBatch], U2[TransformBatch];
+
+    if (m_position % 2 == 1 && !normals.empty())
+    { // Finish the pair started by a previous call
+        normals[i++] = generate_rn();
+    }
+
+    // Whole pairs, transformed by batches
+    while (i + 1 < normals.size())
+    {
+        std::size_t nPairs = std::min(TransformBatch, (normals.size() - i) / 2);
+
+        for (std::size_t k = 0; k < nPairs; ++k)
+            uniform_pair(m_stream, m_position / 2 + k, U1[k], U2[k]);
+        box_muller(U1, U2, nPairs);
+
+        for (std::size_t k = 0; k < nPairs; ++k)
+        {
+            normals[i + 2 * k] = U1[k];
+            normals[i + 2 * k + 1] = U2[k];
+        }
+        i += 2 * nPairs;
+        m_position += 2 * nPairs;
+    }
+
+    if (i < normals.size())
+    {
+        normals[i] = generate_rn();
+    }
+}
+
+//--------------Sobol-----------------
+
+namespace
+{
+    std::uint64_t splitmix64(std::uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // Multiplication of polynomials over GF(2) modulo 'poly' of degree 'degree'
+    std::uint64_t gf2_mulmod(std::uint64_t a, std::uint64_t b, std::uint64_t poly, int degree)
+    {
+        std::uint64_t res = 0;
+        while (b)
+        {
+            if (b & 1)
+                res ^= a;
+            b >>= 1;
+            a <<= 1;
+            if (a >> degree & 1)
+                a ^= poly;
+        }
+        return res;
+    }
+
+    std::uint64_t gf2_powmod(std::uint64_t e, std::uint64_t poly, int degree)
+    { // x^e modulo poly
+        std::uint64_t res = 1, base = 2;
+        if (base >> degree & 1)
+            base ^= poly;
+        while (e)
+        {
+            if (e & 1)
+                res = gf2_mulmod(res, base, poly, degree);
+            base = gf2_mulmod(base, base, poly, degree);
+            e >>= 1;
+        }
+        return res;
+    }
+
+    bool is_primitive(std::uint64_t poly, int degree)
+    { // x must have order exactly 2^degree - 1 modulo poly
+        std::uint64_t order = (1ull << degree) - 1;
+        if (gf2_powmod(order, poly, degree) != 1)
+            return false;
+
+        std::uint64_t n = order;
+        for (std::uint64_t q = 2; q * q <= n; ++q)
+        {
+            if (n % q == 0)
+            {
+                if (gf2_powmod(order / q, poly, degree) == 1)
+                    return false;
+                while (n % q == 0)
+                    n /= q;
+            }
+        }
+        return n == 1 || gf2_powmod(order / n, poly, degree) != 1;
+    }
+
+    std::uint32_t reverse_bits(std::uint32_t x)
+    {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+        x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Owen (nested uniform) scrambling of the bits of x, hash-based (Burley, 2020)
+    std::uint32_t owen_scramble(std::uint32_t x, std::uint32_t seed)
+    {
+        x = reverse_bits(x);
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return reverse_bits(x);
+    }
+
+    std::atomic<std::uint64_t> sobolInstances{ 0 };
+}
+
+thread_local Sobol::Cursor Sobol::m_cursor{};
+
+Sobol::Sobol(std::size_t dimension, Scrambling scrambling, std::uint64_t seed)
+    : m_dimension{ dimension }, m_scrambling{ scrambling }, m_id{ ++sobolInstances },
+    m_directions(dimension * Bits), m_scramble(dimension, 0)
+{
+    if (dimension < 1)
+        throw std::invalid_argument("Sobol dimension must be a strictly positive integer.");
+
+    // First dimension: van der Corput sequence
+    for (int k = 0; k < Bits; ++k)
+        m_directions[k] = 1u << (Bits - 1 - k);
+
+    std::uint64_t poly = 1;     // Current primitive polynomial, x + 1 comes first
+    int degree = 0;
+    const std::uint16_t* initial = sobol_table::initial; // Joe-Kuo values of the current dimension
+
+    for (std::size_t d = 1; d < dimension; ++d)
+    {
+        // Next primitive polynomial, enumerated by degree then by coefficients
+        do
+        {
+            poly += 2;
+            if (poly >> (degree + 1))
+            {
+                ++degree;
+                poly = (1ull << degree) | 1;
+            }
+        } while (!is_primitive(poly, degree));
+
+        // Initial direction numbers: Joe-Kuo's (good two-dimensional projections) within the table. Beyond it
+        // any odd m_k < 2^k gives a valid sequence, they are drawn from a fixed generator so that the sequence is reproducible
+        std::vector<std::uint64_t> m(Bits + 1);
+        std::uint64_t state = 0x5EED0000ull + d;
+        for (int k = 1; k <= degree && k <= Bits; ++k)
+        {
+            if (d < sobol_table::Dimensions)
+            {
+                m[k] = *initial++;
+                continue;
+            }
+            state = splitmix64(state);
+            m[k] = ((state % (1ull << (k - 1))) << 1) | 1;
+        }
+
+        // Recurrence m_k = 2 a_1 m_{k-1} ^ ... ^ 2^(s-1) a_{s-1} m_{k-s+1} ^ 2^s m_{k-s} ^ m_{k-s}
+        for (int k = degree + 1; k <= Bits; ++k)
+        {
+            m[k] = m[k - degree] ^ (m[k - degree] << degree);
+            for (int j = 1; j < degree; ++j)
+            {
+                if (poly >> (degree - j) & 1)
+                    m[k] ^= m[k - j] << j;
+            }
+        }
+
+        for (int k = 1; k <= Bits; ++k)
+            m_directions[d * Bits + k - 1] = static_cast<std::uint32_t>(m[k] << (Bits - k));
+    }
+
+    if (m_scrambling != Scrambling::None)
+    {
+        for (std::size_t d = 0; d < dimension; ++d)
+            m_scramble[d] = static_cast<std::uint32_t>(splitmix64(seed ^ splitmix64(d)));
+    }
+}
+
+std::size_t Sobol::dimension() const
+{
+    return m_dimension;
+}
+
+Sobol::Cursor& Sobol::cursor() const
+{
+    if (m_cursor.owner != m_id)
+    {
+        m_cursor.owner = m_id;
+        m_cursor.x.assign(m_dimension, 0);
+        m_cursor.index = 0;
+        m_cursor.position = 0;
+        move_to(m_cursor, first_point());
+    }
+    return m_cursor;
+}
+
+void Sobol::move_to(Cursor& c, std::uint64_t index) const
+{
+    if (index == c.index + 1)
+    { // Gray code: consecutive points differ by a single direction number
+        int k = std::countr_zero(index);
+        for (std::size_t d = 0; d < m_dimension; ++d)
+            c.x[d] ^= m_directions[d * Bits + k];
+    }
+    else if (index != c.index)
+    {
+        std::uint64_t gray = index ^ (index >> 1);
+        for (std::size_t d = 0; d < m_dimension; ++d)
+        {
+            std::uint32_t x = 0;
+            std::uint64_t g = gray;
+            for (int k = 0; g != 0 && k < Bits; ++k, g >>= 1)
+            {
+                if (g & 1)
+                    x ^= m_directions[d * Bits + k];
+            }
+            c.x[d] = x;
+        }
+    }
+    c.index = index;
+}
+
+std::uint64_t Sobol::first_point() const
+{ // Unscrambled, point 0 sits at the corner of the cube and would map to normals of about -6.2
+    return m_scrambling == Scrambling::None ? 1 : 0;
+}
+
+double Sobol::normal(const Cursor& c, std::size_t d) const
+{
+    std::uint32_t x = c.x[d];
+    if (m_scrambling == Scrambling::DigitalShift)
+        x ^= m_scramble[d];
+    else if (m_scrambling == Scrambling::Owen)
+        x = owen_scramble(x, m_scramble[d]);
+
+    // Middle of the dyadic cell: never 0 or 1
+    return inverse_normal_cdf((static_cast<double>(x) + 0.5) * 0x1.0p-32);
+}
+
+void Sobol::seek(std::uint64_t stream, std::uint64_t offset) const
+{
+    Cursor& c = cursor();
+    move_to(c, first_point() + stream + offset / m_dimension);
+    c.position = offset % m_dimension;
+}
+
+double Sobol::generate_rn() const
+{
+    Cursor& c = cursor();
+    if (c.position == m_dimension)
+    { // Point exhausted, move on to the next one
+        move_to(c, c.index + 1);
+        c.position = 0;
+    }
+
+    return normal(c, c.position++);
+}
+
+void Sobol::fill(std::span<double> normals) const
+{
+    for (double& z : normals)
+    {
+        z = generate_rn();
+    }
 }
@@ -6,10 +6,13 @@
 // Pierre-Yves Sojic
 //
 
+#include <algorithm>
 #include <cmath>
 
 #include "OptionData.hpp"
 #include "SDEConcrete.hpp"
+#include "SIMDKernels.hpp"
+#include "SIMDMath.hpp"
 
 //--------------GBM-----------------
 
@@ -49,6 +52,11 @@ double GBM::diffusion_derivative(double S) const
 	return m_data->vol;
 }
 
+void GBM::euler_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const
+{
+	simd::gbm_euler(x.data(), z.data(), next.data(), x.size(), (m_data->r - m_data->q) * dt, m_data->vol * std::sqrt(dt));
+}
+
 //--------------CEV-----------------
 
 CEV::CEV(const std::shared_ptr<OptionData>& optionData) : m_data(optionData)
@@ -90,4 +98,31 @@ double CEV::diffusion_derivative(double S) const
 		return m_data->vol * m_data->betaCEV / pow(S, 1.0 - m_data->betaCEV);
 	}
 
-}
\ No newline at end of file
+}
+
+void CEV::euler_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const
+{
+	simd::cev_euler(x.data(), z.data(), next.data(), x.size(), (m_data->r - m_data->q) * dt, m_data->vol * std::sqrt(dt), m_data->betaCEV);
+}
+
+void CEV::milstein_block(std::span<const double> x, std::span<const double> z, std::span<double> next, double t, double dt) const
+{
+	constexpr std::size_t Batch = 256;
+	const double a = (m_data->r - m_data->q) * dt;
+	const double c = m_data->vol * std::sqrt(dt);
+	const double m = 0.5 * m_data->vol * m_data->vol * m_data->betaCEV * dt;
+	double powers[Batch];
+
+	for (std::size_t i = 0; i < x.size(); i += Batch)
+	{
+		std::size_t n = std::min(Batch, x.size() - i);
+		simd::pow(x.data() + i, m_data->betaCEV, powers, n);
+
+		// diffusion = vol S^beta, diffusion * d(diffusion)/dS = vol^2 beta S^(2 beta) / S
+		for (std::size_t p = 0; p < n; ++p)
+		{
+			double S = x[i + p], Z = z[i + p];
+			next[i + p] = S + a * S + c * powers[p] * Z + m * powers[p] * powers[p] / S * (Z * Z - 1.0);
+		}
+	}
+}
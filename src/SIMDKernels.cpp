@@ -0,0 +1,196 @@
+// SIMDKernels.cpp
+//
+// Implementation of SIMDKernels.hpp
+// Each kernel comes in a scalar, an AVX2 and an AVX-512 flavour. The vector flavours are
+// compiled with the matching target attribute so the rest of the program does not need
+// to be built for a specific CPU.
+//
+// Pierre-Yves Sojic
+//
+
+#include <algorithm>
+#include <atomic>
+
+#include "SIMDKernels.hpp"
+#include "SIMDMath.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MC_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    //--------------Scalar-----------------
+
+    void gbm_euler_scalar(const double* x, const double* z, double* next, std::size_t n, double a, double b)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            next[i] = x[i] + x[i] * (a + b * z[i]);
+    }
+
+    constexpr std::size_t PowerBatch = 256;   // Elements whose x^beta are computed together by simd::pow
+
+    // CEV kernels take the powers x^beta already computed
+    void cev_euler_scalar(const double* x, const double* powers, const double* z, double* next, std::size_t n, double a, double c)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            next[i] = x[i] + a * x[i] + c * powers[i] * z[i];
+    }
+
+#ifdef MC_SIMD_X86
+
+    //--------------AVX2-----------------
+
+    __attribute__((target("avx2,fma")))
+    void gbm_euler_avx2(const double* x, const double* z, double* next, std::size_t n, double a, double b)
+    {
+        const __m256d va = _mm256_set1_pd(a);
+        const __m256d vb = _mm256_set1_pd(b);
+
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d vx = _mm256_loadu_pd(x + i);
+            __m256d vz = _mm256_loadu_pd(z + i);
+            __m256d growth = _mm256_fmadd_pd(vb, vz, va);
+            _mm256_storeu_pd(next + i, _mm256_fmadd_pd(vx, growth, vx));
+        }
+        gbm_euler_scalar(x + i, z + i, next + i, n - i, a, b);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void cev_euler_avx2(const double* x, const double* powers, const double* z, double* next, std::size_t n, double a, double c)
+    {
+        const __m256d va = _mm256_set1_pd(1.0 + a);
+        const __m256d vc = _mm256_set1_pd(c);
+
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d vx = _mm256_loadu_pd(x + i);
+            __m256d vz = _mm256_loadu_pd(z + i);
+            __m256d shock = _mm256_mul_pd(_mm256_mul_pd(vc, _mm256_loadu_pd(powers + i)), vz);
+            _mm256_storeu_pd(next + i, _mm256_fmadd_pd(va, vx, shock));
+        }
+        cev_euler_scalar(x + i, powers + i, z + i, next + i, n - i, a, c);
+    }
+
+    //--------------AVX-512-----------------
+
+    __attribute__((target("avx512f")))
+    void gbm_euler_avx512(const double* x, const double* z, double* next, std::size_t n, double a, double b)
+    {
+        const __m512d va = _mm512_set1_pd(a);
+        const __m512d vb = _mm512_set1_pd(b);
+
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m512d vx = _mm512_loadu_pd(x + i);
+            __m512d vz = _mm512_loadu_pd(z + i);
+            __m512d growth = _mm512_fmadd_pd(vb, vz, va);
+            _mm512_storeu_pd(next + i, _mm512_fmadd_pd(vx, growth, vx));
+        }
+        gbm_euler_scalar(x + i, z + i, next + i, n - i, a, b);
+    }
+
+    __attribute__((target("avx512f")))
+    void cev_euler_avx512(const double* x, const double* powers, const double* z, double* next, std::size_t n, double a, double c)
+    {
+        const __m512d va = _mm512_set1_pd(1.0 + a);
+        const __m512d vc = _mm512_set1_pd(c);
+
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m512d vx = _mm512_loadu_pd(x + i);
+            __m512d vz = _mm512_loadu_pd(z + i);
+            __m512d shock = _mm512_mul_pd(_mm512_mul_pd(vc, _mm512_loadu_pd(powers + i)), vz);
+            _mm512_storeu_pd(next + i, _mm512_fmadd_pd(va, vx, shock));
+        }
+        cev_euler_scalar(x + i, powers + i, z + i, next + i, n - i, a, c);
+    }
+
+#endif
+
+    std::atomic<simd::ISA> activeISA{ simd::detected_isa() };
+}
+
+namespace simd
+{
+    ISA detected_isa()
+    {
+#ifdef MC_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return ISA::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return ISA::AVX2;
+#endif
+        return ISA::Scalar;
+    }
+
+    ISA active_isa()
+    {
+        return activeISA.load(std::memory_order_relaxed);
+    }
+
+    void set_isa(ISA isa)
+    {
+        activeISA.store(std::min(isa, detected_isa()), std::memory_order_relaxed);
+    }
+
+    const char* isa_name(ISA isa)
+    {
+        switch (isa)
+        {
+        case ISA::AVX512:
+            return "AVX-512";
+        case ISA::AVX2:
+            return "AVX2";
+        default:
+            return "Scalar";
+        }
+    }
+
+    void gbm_euler(const double* x, const double* z, double* next, std::size_t n, double a, double b)
+    {
+        switch (active_isa())
+        {
+#ifdef MC_SIMD_X86
+        case ISA::AVX512:
+            return gbm_euler_avx512(x, z, next, n, a, b);
+        case ISA::AVX2:
+            return gbm_euler_avx2(x, z, next, n, a, b);
+#endif
+        default:
+            return gbm_euler_scalar(x, z, next, n, a, b);
+        }
+    }
+
+    void cev_euler(const double* x, const double* z, double* next, std::size_t n, double a, double c, double beta)
+    {
+        double powers[PowerBatch];
+
+        for (std::size_t i = 0; i < n; i += PowerBatch)
+        {
+            std::size_t m = std::min(PowerBatch, n - i);
+            simd::pow(x + i, beta, powers, m);
+
+            switch (active_isa())
+            {
+#ifdef MC_SIMD_X86
+            case ISA::AVX512:
+                cev_euler_avx512(x + i, powers, z + i, next + i, m, a, c);
+                break;
+            case ISA::AVX2:
+                cev_euler_avx2(x + i, powers, z + i, next + i, m, a, c);
+                break;
+#endif
+            default:
+                cev_euler_scalar(x + i, powers, z + i, next + i, m, a, c);
+            }
+        }
+    }
+}
@@ -0,0 +1,716 @@
+// SIMDMath.cpp
+//
+// Implementation of SIMDMath.hpp
+// exp: x = n ln2 + r with |r| <= ln2 / 2 (Cody-Waite reduction with a two-part ln2 and FMAs),
+// exp(r) from its Taylor polynomial of degree 13 (truncation error below 2^-60), times 2^n.
+// log: x = 2^k m with sqrt(2) / 2 < m <= sqrt(2), log(1 + f) = f - f^2 / 2 + s (f^2 / 2 + R(s^2)), s = f / (2 + f)
+// (the fdlibm polynomial), summed in double-double so that pow(x, e) = exp(e log x) keeps the precision of exp.
+// sin, cos: x = k pi / 2 + r with a three-part pi / 2 (exact products by k up to |x| = 1e5), the fdlibm kernels
+// on r plus its correction, swapped and negated according to k mod 4.
+// The vector kernels give the same result on AVX2 and AVX-512 (same operations in the same order).
+//
+// Pierre-Yves Sojic
+//
+
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <numbers>
+
+#include "SIMDKernels.hpp"
+#include "SIMDMath.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MC_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr double Shifter = 0x1.8p52;    // Adding it leaves round(x) in the low bits of the mantissa
+
+    // exp
+    constexpr double Log2e = 1.4426950408889634;
+    constexpr double Ln2Hi = 0x1.62e42fefa39efp-1;
+    constexpr double Ln2Lo = 0x1.abc9e3b39803fp-56;
+    constexpr double ExpMin = -708.0;   // exp(x) stays a normal number
+    constexpr double ExpMax = 709.0;    // and 2^n below the largest exponent
+
+    // 1 / k!, k = 13 down to 2
+    constexpr double ExpCoefficients[] = { 1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0,
+        1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5 };
+
+    // log: ln2 split so that k ln2_hi is exact for any exponent k
+    constexpr double LogLn2Hi = 6.93147180369123816490e-01;
+    constexpr double LogLn2Lo = 1.90821492927058770002e-10;
+    constexpr double Lg1 = 6.666666666666735130e-01, Lg2 = 3.999999999940941908e-01, Lg3 = 2.857142874366239149e-01,
+        Lg4 = 2.222219843214978396e-01, Lg5 = 1.818357216161805012e-01, Lg6 = 1.531383769920937332e-01, Lg7 = 1.479819860511658591e-01;
+    constexpr double NormMin = std::numeric_limits<double>::min();  // Subnormals go through libm
+    constexpr double NormMax = std::numeric_limits<double>::max();
+    constexpr long long MantissaBits = 0x000FFFFFFFFFFFFF;
+    constexpr long long OneBits = 0x3FF0000000000000;
+
+    // sin, cos: pi / 2 = Pio2_1 + Pio2_2 + Pio2_3 + Pio2_3t, the first three on 33 bits
+    constexpr double InvPio2 = 6.36619772367581382433e-01;
+    constexpr double Pio2_1 = 1.57079632673412561417e+00;
+    constexpr double Pio2_2 = 6.07710050630396597660e-11;
+    constexpr double Pio2_3 = 2.02226624871116645580e-21;
+    constexpr double Pio2_3t = 8.47842766036889956997e-32;
+    constexpr double SinCosMax = 1e5;   // k below 2^17: k Pio2_i exact
+    constexpr double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03, S3 = -1.98412698298579493134e-04,
+        S4 = 2.75573137070700676789e-06, S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+    constexpr double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03, C3 = 2.48015872894767294178e-05,
+        C4 = -2.75573143513906633035e-07, C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+
+    // Lanes flagged in bad recomputed by f (libm)
+    template <std::size_t W, class F>
+    void fix_lanes(const double* x, double* y, unsigned bad, F f)
+    {
+        for (std::size_t l = 0; l < W; ++l)
+            if (bad >> l & 1u)
+                y[l] = f(x[l]);
+    }
+
+    //--------------Scalar-----------------
+
+    void exp_scalar(const double* x, double* y, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            y[i] = std::exp(x[i]);
+    }
+
+    void log_scalar(const double* x, double* y, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            y[i] = std::log(x[i]);
+    }
+
+    void pow_scalar(const double* x, double e, double* y, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            y[i] = std::pow(x[i], e);
+    }
+
+    void sqrt_scalar(const double* x, double* y, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            y[i] = std::sqrt(x[i]);
+    }
+
+    void sincos_scalar(const double* x, double* s, double* c, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            double xi = x[i];  // s or c may alias x
+            s[i] = std::sin(xi);
+            c[i] = std::cos(xi);
+        }
+    }
+
+#ifdef MC_SIMD_X86
+
+    //--------------AVX2-----------------
+
+    // Lanes below n (<= 4) for the tails
+    __attribute__((target("avx2,fma")))
+    inline __m256i tail_mask_avx2(std::size_t n)
+    {
+        return _mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(n)), _mm256_set_epi64x(3, 2, 1, 0));
+    }
+
+    // Tail padded with ones (a valid argument of every function)
+    __attribute__((target("avx2,fma")))
+    inline __m256d load_tail_avx2(const double* x, __m256i mask)
+    {
+        return _mm256_blendv_pd(_mm256_set1_pd(1.0), _mm256_maskload_pd(x, mask), _mm256_castsi256_pd(mask));
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256d two_sum_avx2(__m256d a, __m256d b, __m256d& err)
+    {
+        __m256d s = _mm256_add_pd(a, b);
+        __m256d bb = _mm256_sub_pd(s, a);
+        err = _mm256_add_pd(_mm256_sub_pd(a, _mm256_sub_pd(s, bb)), _mm256_sub_pd(b, bb));
+        return s;
+    }
+
+    template <class F>
+    __attribute__((target("avx2,fma")))
+    inline __m256d fix_avx2(__m256d vx, __m256d v, unsigned bad, F f)
+    {
+        alignas(32) double xs[4], vs[4];
+        _mm256_store_pd(xs, vx);
+        _mm256_store_pd(vs, v);
+        fix_lanes<4>(xs, vs, bad, f);
+        return _mm256_load_pd(vs);
+    }
+
+    // exp(x) for x in [ExpMin, ExpMax]
+    __attribute__((target("avx2,fma")))
+    inline __m256d exp_core_avx2(__m256d vx)
+    {
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d shifter = _mm256_set1_pd(Shifter);
+
+        __m256d shifted = _mm256_fmadd_pd(vx, _mm256_set1_pd(Log2e), shifter);
+        __m256d k = _mm256_sub_pd(shifted, shifter);
+        __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(Ln2Hi), vx);
+        r = _mm256_fnmadd_pd(k, _mm256_set1_pd(Ln2Lo), r);
+
+        __m256d p = _mm256_set1_pd(ExpCoefficients[0]);
+        for (std::size_t c = 1; c < std::size(ExpCoefficients); ++c)
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(ExpCoefficients[c]));
+        p = _mm256_fmadd_pd(p, r, one);
+        p = _mm256_fmadd_pd(p, r, one);
+
+        // 2^k built in the exponent bits
+        __m256i bits = _mm256_sub_epi64(_mm256_castpd_si256(shifted), _mm256_castpd_si256(shifter));
+        __m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52));
+        return _mm256_mul_pd(p, scale);
+    }
+
+    // log(x) = hi + lo for x a positive normal number
+    __attribute__((target("avx2,fma")))
+    inline __m256d log_core_avx2(__m256d vx, __m256d& lo)
+    {
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d shifter = _mm256_set1_pd(Shifter);
+
+        // x = 2^k m, m in [1, 2) then in (sqrt(2) / 2, sqrt(2)]
+        __m256i bits = _mm256_castpd_si256(vx);
+        __m256i e = _mm256_sub_epi64(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(1023));
+        __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(MantissaBits)), _mm256_set1_epi64x(OneBits)));
+        __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(std::numbers::sqrt2), _CMP_GT_OQ);
+        m = _mm256_blendv_pd(m, _mm256_mul_pd(m, half), big);
+        e = _mm256_sub_epi64(e, _mm256_castpd_si256(big));
+        __m256d k = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(e, _mm256_castpd_si256(shifter))), shifter);
+
+        __m256d f = _mm256_sub_pd(m, one);  // Exact
+        __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+        __m256d z = _mm256_mul_pd(s, s);
+        __m256d w = _mm256_mul_pd(z, z);
+        __m256d t1 = _mm256_mul_pd(w, _mm256_fmadd_pd(w, _mm256_fmadd_pd(w, _mm256_set1_pd(Lg6), _mm256_set1_pd(Lg4)), _mm256_set1_pd(Lg2)));
+        __m256d t2 = _mm256_mul_pd(z, _mm256_fmadd_pd(w, _mm256_fmadd_pd(w, _mm256_fmadd_pd(w, _mm256_set1_pd(Lg7), _mm256_set1_pd(Lg5)),
+            _mm256_set1_pd(Lg3)), _mm256_set1_pd(Lg1)));
+        __m256d R = _mm256_add_pd(t1, t2);
+
+        // f - f^2 / 2 and k ln2_hi with their rounding errors
+        __m256d hf = _mm256_mul_pd(half, f);
+        __m256d h = _mm256_mul_pd(hf, f);
+        __m256d hErr = _mm256_fmsub_pd(hf, f, h);
+        __m256d t = _mm256_sub_pd(f, h);
+        __m256d tErr = _mm256_sub_pd(_mm256_sub_pd(f, t), h);
+        __m256d sumErr;
+        __m256d sum = two_sum_avx2(_mm256_mul_pd(k, _mm256_set1_pd(LogLn2Hi)), t, sumErr);
+
+        __m256d tail = _mm256_fmadd_pd(s, _mm256_add_pd(h, R), _mm256_mul_pd(k, _mm256_set1_pd(LogLn2Lo)));
+        tail = _mm256_add_pd(_mm256_sub_pd(_mm256_add_pd(sumErr, tErr), hErr), tail);
+        __m256d hi = _mm256_add_pd(sum, tail);
+        lo = _mm256_sub_pd(tail, _mm256_sub_pd(hi, sum));
+        return hi;
+    }
+
+    // sin(x), cos(x) for |x| <= SinCosMax
+    __attribute__((target("avx2,fma")))
+    inline void sincos_core_avx2(__m256d vx, __m256d& sn, __m256d& cs)
+    {
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d shifter = _mm256_set1_pd(Shifter);
+        const __m256i oneI = _mm256_set1_epi64x(1);
+        const __m256i twoI = _mm256_set1_epi64x(2);
+
+        __m256d shifted = _mm256_fmadd_pd(vx, _mm256_set1_pd(InvPio2), shifter);
+        __m256d k = _mm256_sub_pd(shifted, shifter);
+        __m256i q = _mm256_and_si256(_mm256_castpd_si256(shifted), _mm256_set1_epi64x(3));
+
+        // r + y = x - k pi / 2
+        __m256d e2, e3;
+        __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(Pio2_1), vx);
+        r = two_sum_avx2(r, _mm256_mul_pd(k, _mm256_set1_pd(-Pio2_2)), e2);
+        r = two_sum_avx2(r, _mm256_mul_pd(k, _mm256_set1_pd(-Pio2_3)), e3);
+        __m256d y = _mm256_fnmadd_pd(k, _mm256_set1_pd(Pio2_3t), _mm256_add_pd(e2, e3));
+        __m256d rr = _mm256_add_pd(r, y);
+        y = _mm256_sub_pd(y, _mm256_sub_pd(rr, r));
+        r = rr;
+
+        __m256d z = _mm256_mul_pd(r, r);
+        __m256d v = _mm256_mul_pd(z, r);
+        __m256d ps = _mm256_fmadd_pd(z, _mm256_fmadd_pd(z, _mm256_fmadd_pd(z, _mm256_fmadd_pd(z, _mm256_set1_pd(S6), _mm256_set1_pd(S5)),
+            _mm256_set1_pd(S4)), _mm256_set1_pd(S3)), _mm256_set1_pd(S2));
+        __m256d s = _mm256_fnmadd_pd(v, ps, _mm256_mul_pd(half, y));
+        s = _mm256_fnmadd_pd(v, _mm256_set1_pd(S1), _mm256_fmsub_pd(z, s, y));
+        s = _mm256_sub_pd(r, s);
+
+        __m256d pc = _mm256_mul_pd(z, _mm256_fmadd_pd(z, _mm256_fmadd_pd(z, _mm256_fmadd_pd(z, _mm256_fmadd_pd(z, _mm256_fmadd_pd(z,
+            _mm256_set1_pd(C6), _mm256_set1_pd(C5)), _mm256_set1_pd(C4)), _mm256_set1_pd(C3)), _mm256_set1_pd(C2)), _mm256_set1_pd(C1)));
+        __m256d hz = _mm256_mul_pd(half, z);
+        __m256d w = _mm256_sub_pd(one, hz);
+        __m256d c = _mm256_add_pd(w, _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(one, w), hz), _mm256_fmsub_pd(z, pc, _mm256_mul_pd(r, y))));
+
+        // Quadrant k mod 4: (s, c), (c, -s), (-s, -c), (-c, s)
+        __m256d swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(q, oneI), oneI));
+        __m256i sSign = _mm256_slli_epi64(_mm256_and_si256(q, twoI), 62);
+        __m256i cSign = _mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(q, oneI), twoI), 62);
+        sn = _mm256_xor_pd(_mm256_blendv_pd(s, c, swap), _mm256_castsi256_pd(sSign));
+        cs = _mm256_xor_pd(_mm256_blendv_pd(c, s, swap), _mm256_castsi256_pd(cSign));
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256d exp_vec_avx2(__m256d vx)
+    {
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(vx, _mm256_set1_pd(ExpMin), _CMP_GE_OQ), _mm256_cmp_pd(vx, _mm256_set1_pd(ExpMax), _CMP_LE_OQ));
+        __m256d v = exp_core_avx2(_mm256_and_pd(vx, valid));
+        if (unsigned bad = ~_mm256_movemask_pd(valid) & 0xFu)
+            return fix_avx2(vx, v, bad, [](double a) { return std::exp(a); });
+        return v;
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256d log_vec_avx2(__m256d vx)
+    {
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(vx, _mm256_set1_pd(NormMin), _CMP_GE_OQ), _mm256_cmp_pd(vx, _mm256_set1_pd(NormMax), _CMP_LE_OQ));
+        __m256d lo;
+        __m256d v = log_core_avx2(_mm256_blendv_pd(_mm256_set1_pd(1.0), vx, valid), lo);
+        if (unsigned bad = ~_mm256_movemask_pd(valid) & 0xFu)
+            return fix_avx2(vx, v, bad, [](double a) { return std::log(a); });
+        return v;
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256d pow_vec_avx2(__m256d vx, double e)
+    {
+        const __m256d ve = _mm256_set1_pd(e);
+
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(vx, _mm256_set1_pd(NormMin), _CMP_GE_OQ), _mm256_cmp_pd(vx, _mm256_set1_pd(NormMax), _CMP_LE_OQ));
+        __m256d lo;
+        __m256d hi = log_core_avx2(_mm256_blendv_pd(_mm256_set1_pd(1.0), vx, valid), lo);
+
+        // e log x = p + pErr, exp(p + pErr) = exp(p) (1 + pErr)
+        __m256d p = _mm256_mul_pd(ve, hi);
+        __m256d pErr = _mm256_fmadd_pd(ve, lo, _mm256_fmsub_pd(ve, hi, p));
+        valid = _mm256_and_pd(valid, _mm256_and_pd(_mm256_cmp_pd(p, _mm256_set1_pd(ExpMin), _CMP_GE_OQ), _mm256_cmp_pd(p, _mm256_set1_pd(ExpMax), _CMP_LE_OQ)));
+        __m256d v = exp_core_avx2(_mm256_and_pd(p, valid));
+        v = _mm256_fmadd_pd(v, pErr, v);
+        if (unsigned bad = ~_mm256_movemask_pd(valid) & 0xFu)
+            return fix_avx2(vx, v, bad, [e](double a) { return std::pow(a, e); });
+        return v;
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline void sincos_vec_avx2(__m256d vx, __m256d& s, __m256d& c)
+    {
+        __m256d absX = _mm256_andnot_pd(_mm256_set1_pd(-0.0), vx);
+        __m256d valid = _mm256_cmp_pd(absX, _mm256_set1_pd(SinCosMax), _CMP_LE_OQ);
+        sincos_core_avx2(_mm256_and_pd(vx, valid), s, c);
+        if (unsigned bad = ~_mm256_movemask_pd(valid) & 0xFu)
+        {
+            s = fix_avx2(vx, s, bad, [](double a) { return std::sin(a); });
+            c = fix_avx2(vx, c, bad, [](double a) { return std::cos(a); });
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void exp_avx2(const double* x, double* y, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(y + i, exp_vec_avx2(_mm256_loadu_pd(x + i)));
+        if (i < n)
+        {
+            __m256i mask = tail_mask_avx2(n - i);
+            _mm256_maskstore_pd(y + i, mask, exp_vec_avx2(load_tail_avx2(x + i, mask)));
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void log_avx2(const double* x, double* y, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(y + i, log_vec_avx2(_mm256_loadu_pd(x + i)));
+        if (i < n)
+        {
+            __m256i mask = tail_mask_avx2(n - i);
+            _mm256_maskstore_pd(y + i, mask, log_vec_avx2(load_tail_avx2(x + i, mask)));
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void pow_avx2(const double* x, double e, double* y, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(y + i, pow_vec_avx2(_mm256_loadu_pd(x + i), e));
+        if (i < n)
+        {
+            __m256i mask = tail_mask_avx2(n - i);
+            _mm256_maskstore_pd(y + i, mask, pow_vec_avx2(load_tail_avx2(x + i, mask), e));
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void sqrt_avx2(const double* x, double* y, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(y + i, _mm256_sqrt_pd(_mm256_loadu_pd(x + i)));
+        if (i < n)
+        {
+            __m256i mask = tail_mask_avx2(n - i);
+            _mm256_maskstore_pd(y + i, mask, _mm256_sqrt_pd(load_tail_avx2(x + i, mask)));
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void sincos_avx2(const double* x, double* s, double* c, std::size_t n)
+    {
+        __m256d vs, vc;
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            sincos_vec_avx2(_mm256_loadu_pd(x + i), vs, vc);
+            _mm256_storeu_pd(s + i, vs);
+            _mm256_storeu_pd(c + i, vc);
+        }
+        if (i < n)
+        {
+            __m256i mask = tail_mask_avx2(n - i);
+            sincos_vec_avx2(load_tail_avx2(x + i, mask), vs, vc);
+            _mm256_maskstore_pd(s + i, mask, vs);
+            _mm256_maskstore_pd(c + i, mask, vc);
+        }
+    }
+
+    //--------------AVX-512-----------------
+
+    __attribute__((target("avx512f")))
+    inline __m512d two_sum_avx512(__m512d a, __m512d b, __m512d& err)
+    {
+        __m512d s = _mm512_add_pd(a, b);
+        __m512d bb = _mm512_sub_pd(s, a);
+        err = _mm512_add_pd(_mm512_sub_pd(a, _mm512_sub_pd(s, bb)), _mm512_sub_pd(b, bb));
+        return s;
+    }
+
+    template <class F>
+    __attribute__((target("avx512f")))
+    inline __m512d fix_avx512(__m512d vx, __m512d v, unsigned bad, F f)
+    {
+        alignas(64) double xs[8], vs[8];
+        _mm512_store_pd(xs, vx);
+        _mm512_store_pd(vs, v);
+        fix_lanes<8>(xs, vs, bad, f);
+        return _mm512_load_pd(vs);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512d exp_core_avx512(__m512d vx)
+    {
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d shifter = _mm512_set1_pd(Shifter);
+
+        __m512d k = _mm512_sub_pd(_mm512_fmadd_pd(vx, _mm512_set1_pd(Log2e), shifter), shifter);
+        __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(Ln2Hi), vx);
+        r = _mm512_fnmadd_pd(k, _mm512_set1_pd(Ln2Lo), r);
+
+        __m512d p = _mm512_set1_pd(ExpCoefficients[0]);
+        for (std::size_t c = 1; c < std::size(ExpCoefficients); ++c)
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(ExpCoefficients[c]));
+        p = _mm512_fmadd_pd(p, r, one);
+        p = _mm512_fmadd_pd(p, r, one);
+
+        return _mm512_scalef_pd(p, k);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512d log_core_avx512(__m512d vx, __m512d& lo)
+    {
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d half = _mm512_set1_pd(0.5);
+
+        __m512d m = _mm512_getmant_pd(vx, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+        __m512d k = _mm512_getexp_pd(vx);
+        __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(std::numbers::sqrt2), _CMP_GT_OQ);
+        m = _mm512_mask_mul_pd(m, big, m, half);
+        k = _mm512_mask_add_pd(k, big, k, one);
+
+        __m512d f = _mm512_sub_pd(m, one);
+        __m512d s = _mm512_div_pd(f, _mm512_add_pd(_mm512_set1_pd(2.0), f));
+        __m512d z = _mm512_mul_pd(s, s);
+        __m512d w = _mm512_mul_pd(z, z);
+        __m512d t1 = _mm512_mul_pd(w, _mm512_fmadd_pd(w, _mm512_fmadd_pd(w, _mm512_set1_pd(Lg6), _mm512_set1_pd(Lg4)), _mm512_set1_pd(Lg2)));
+        __m512d t2 = _mm512_mul_pd(z, _mm512_fmadd_pd(w, _mm512_fmadd_pd(w, _mm512_fmadd_pd(w, _mm512_set1_pd(Lg7), _mm512_set1_pd(Lg5)),
+            _mm512_set1_pd(Lg3)), _mm512_set1_pd(Lg1)));
+        __m512d R = _mm512_add_pd(t1, t2);
+
+        __m512d hf = _mm512_mul_pd(half, f);
+        __m512d h = _mm512_mul_pd(hf, f);
+        __m512d hErr = _mm512_fmsub_pd(hf, f, h);
+        __m512d t = _mm512_sub_pd(f, h);
+        __m512d tErr = _mm512_sub_pd(_mm512_sub_pd(f, t), h);
+        __m512d sumErr;
+        __m512d sum = two_sum_avx512(_mm512_mul_pd(k, _mm512_set1_pd(LogLn2Hi)), t, sumErr);
+
+        __m512d tail = _mm512_fmadd_pd(s, _mm512_add_pd(h, R), _mm512_mul_pd(k, _mm512_set1_pd(LogLn2Lo)));
+        tail = _mm512_add_pd(_mm512_sub_pd(_mm512_add_pd(sumErr, tErr), hErr), tail);
+        __m512d hi = _mm512_add_pd(sum, tail);
+        lo = _mm512_sub_pd(tail, _mm512_sub_pd(hi, sum));
+        return hi;
+    }
+
+    __attribute__((target("avx512f")))
+    inline void sincos_core_avx512(__m512d vx, __m512d& sn, __m512d& cs)
+    {
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d half = _mm512_set1_pd(0.5);
+        const __m512d shifter = _mm512_set1_pd(Shifter);
+        const __m512i oneI = _mm512_set1_epi64(1);
+        const __m512i twoI = _mm512_set1_epi64(2);
+
+        __m512d shifted = _mm512_fmadd_pd(vx, _mm512_set1_pd(InvPio2), shifter);
+        __m512d k = _mm512_sub_pd(shifted, shifter);
+        __m512i q = _mm512_and_epi64(_mm512_castpd_si512(shifted), _mm512_set1_epi64(3));
+
+        __m512d e2, e3;
+        __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(Pio2_1), vx);
+        r = two_sum_avx512(r, _mm512_mul_pd(k, _mm512_set1_pd(-Pio2_2)), e2);
+        r = two_sum_avx512(r, _mm512_mul_pd(k, _mm512_set1_pd(-Pio2_3)), e3);
+        __m512d y = _mm512_fnmadd_pd(k, _mm512_set1_pd(Pio2_3t), _mm512_add_pd(e2, e3));
+        __m512d rr = _mm512_add_pd(r, y);
+        y = _mm512_sub_pd(y, _mm512_sub_pd(rr, r));
+        r = rr;
+
+        __m512d z = _mm512_mul_pd(r, r);
+        __m512d v = _mm512_mul_pd(z, r);
+        __m512d ps = _mm512_fmadd_pd(z, _mm512_fmadd_pd(z, _mm512_fmadd_pd(z, _mm512_fmadd_pd(z, _mm512_set1_pd(S6), _mm512_set1_pd(S5)),
+            _mm512_set1_pd(S4)), _mm512_set1_pd(S3)), _mm512_set1_pd(S2));
+        __m512d s = _mm512_fnmadd_pd(v, ps, _mm512_mul_pd(half, y));
+        s = _mm512_fnmadd_pd(v, _mm512_set1_pd(S1), _mm512_fmsub_pd(z, s, y));
+        s = _mm512_sub_pd(r, s);
+
+        __m512d pc = _mm512_mul_pd(z, _mm512_fmadd_pd(z, _mm512_fmadd_pd(z, _mm512_fmadd_pd(z, _mm512_fmadd_pd(z, _mm512_fmadd_pd(z,
+            _mm512_set1_pd(C6), _mm512_set1_pd(C5)), _mm512_set1_pd(C4)), _mm512_set1_pd(C3)), _mm512_set1_pd(C2)), _mm512_set1_pd(C1)));
+        __m512d hz = _mm512_mul_pd(half, z);
+        __m512d w = _mm512_sub_pd(one, hz);
+        __m512d c = _mm512_add_pd(w, _mm512_add_pd(_mm512_sub_pd(_mm512_sub_pd(one, w), hz), _mm512_fmsub_pd(z, pc, _mm512_mul_pd(r, y))));
+
+        __mmask8 swap = _mm512_test_epi64_mask(q, oneI);
+        __m512i sSign = _mm512_slli_epi64(_mm512_and_epi64(q, twoI), 62);
+        __m512i cSign = _mm512_slli_epi64(_mm512_and_epi64(_mm512_add_epi64(q, oneI), twoI), 62);
+        sn = _mm512_castsi512_pd(_mm512_xor_epi64(_mm512_castpd_si512(_mm512_mask_blend_pd(swap, s, c)), sSign));
+        cs = _mm512_castsi512_pd(_mm512_xor_epi64(_mm512_castpd_si512(_mm512_mask_blend_pd(swap, c, s)), cSign));
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512d exp_vec_avx512(__m512d vx)
+    {
+        __mmask8 valid = _mm512_cmp_pd_mask(vx, _mm512_set1_pd(ExpMin), _CMP_GE_OQ) & _mm512_cmp_pd_mask(vx, _mm512_set1_pd(ExpMax), _CMP_LE_OQ);
+        __m512d v = exp_core_avx512(_mm512_maskz_mov_pd(valid, vx));
+        if (unsigned bad = ~valid & 0xFFu)
+            return fix_avx512(vx, v, bad, [](double a) { return std::exp(a); });
+        return v;
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512d log_vec_avx512(__m512d vx)
+    {
+        __mmask8 valid = _mm512_cmp_pd_mask(vx, _mm512_set1_pd(NormMin), _CMP_GE_OQ) & _mm512_cmp_pd_mask(vx, _mm512_set1_pd(NormMax), _CMP_LE_OQ);
+        __m512d lo;
+        __m512d v = log_core_avx512(_mm512_mask_mov_pd(_mm512_set1_pd(1.0), valid, vx), lo);
+        if (unsigned bad = ~valid & 0xFFu)
+            return fix_avx512(vx, v, bad, [](double a) { return std::log(a); });
+        return v;
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512d pow_vec_avx512(__m512d vx, double e)
+    {
+        const __m512d ve = _mm512_set1_pd(e);
+
+        __mmask8 valid = _mm512_cmp_pd_mask(vx, _mm512_set1_pd(NormMin), _CMP_GE_OQ) & _mm512_cmp_pd_mask(vx, _mm512_set1_pd(NormMax), _CMP_LE_OQ);
+        __m512d lo;
+        __m512d hi = log_core_avx512(_mm512_mask_mov_pd(_mm512_set1_pd(1.0), valid, vx), lo);
+
+        __m512d p = _mm512_mul_pd(ve, hi);
+        __m512d pErr = _mm512_fmadd_pd(ve, lo, _mm512_fmsub_pd(ve, hi, p));
+        valid &= _mm512_cmp_pd_mask(p, _mm512_set1_pd(ExpMin), _CMP_GE_OQ) & _mm512_cmp_pd_mask(p, _mm512_set1_pd(ExpMax), _CMP_LE_OQ);
+        __m512d v = exp_core_avx512(_mm512_maskz_mov_pd(valid, p));
+        v = _mm512_fmadd_pd(v, pErr, v);
+        if (unsigned bad = ~valid & 0xFFu)
+            return fix_avx512(vx, v, bad, [e](double a) { return std::pow(a, e); });
+        return v;
+    }
+
+    __attribute__((target("avx512f")))
+    inline void sincos_vec_avx512(__m512d vx, __m512d& s, __m512d& c)
+    {
+        __mmask8 valid = _mm512_cmp_pd_mask(_mm512_abs_pd(vx), _mm512_set1_pd(SinCosMax), _CMP_LE_OQ);
+        sincos_core_avx512(_mm512_maskz_mov_pd(valid, vx), s, c);
+        if (unsigned bad = ~valid & 0xFFu)
+        {
+            s = fix_avx512(vx, s, bad, [](double a) { return std::sin(a); });
+            c = fix_avx512(vx, c, bad, [](double a) { return std::cos(a); });
+        }
+    }
+
+    // Tails: lanes below n, the others padded with ones
+    __attribute__((target("avx512f")))
+    inline __mmask8 tail_mask_avx512(std::size_t n)
+    {
+        return static_cast<__mmask8>((1u << n) - 1u);
+    }
+
+    __attribute__((target("avx512f")))
+    void exp_avx512(const double* x, double* y, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(y + i, exp_vec_avx512(_mm512_loadu_pd(x + i)));
+        if (i < n)
+        {
+            __mmask8 mask = tail_mask_avx512(n - i);
+            _mm512_mask_storeu_pd(y + i, mask, exp_vec_avx512(_mm512_mask_loadu_pd(_mm512_set1_pd(1.0), mask, x + i)));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void log_avx512(const double* x, double* y, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(y + i, log_vec_avx512(_mm512_loadu_pd(x + i)));
+        if (i < n)
+        {
+            __mmask8 mask = tail_mask_avx512(n - i);
+            _mm512_mask_storeu_pd(y + i, mask, log_vec_avx512(_mm512_mask_loadu_pd(_mm512_set1_pd(1.0), mask, x + i)));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void pow_avx512(const double* x, double e, double* y, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(y + i, pow_vec_avx512(_mm512_loadu_pd(x + i), e));
+        if (i < n)
+        {
+            __mmask8 mask = tail_mask_avx512(n - i);
+            _mm512_mask_storeu_pd(y + i, mask, pow_vec_avx512(_mm512_mask_loadu_pd(_mm512_set1_pd(1.0), mask, x + i), e));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void sqrt_avx512(const double* x, double* y, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(y + i, _mm512_sqrt_pd(_mm512_loadu_pd(x + i)));
+        if (i < n)
+        {
+            __mmask8 mask = tail_mask_avx512(n - i);
+            _mm512_mask_storeu_pd(y + i, mask, _mm512_sqrt_pd(_mm512_mask_loadu_pd(_mm512_set1_pd(1.0), mask, x + i)));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void sincos_avx512(const double* x, double* s, double* c, std::size_t n)
+    {
+        __m512d vs, vc;
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            sincos_vec_avx512(_mm512_loadu_pd(x + i), vs, vc);
+            _mm512_storeu_pd(s + i, vs);
+            _mm512_storeu_pd(c + i, vc);
+        }
+        if (i < n)
+        {
+            __mmask8 mask = tail_mask_avx512(n - i);
+            sincos_vec_avx512(_mm512_mask_loadu_pd(_mm512_set1_pd(1.0), mask, x + i), vs, vc);
+            _mm512_mask_storeu_pd(s + i, mask, vs);
+            _mm512_mask_storeu_pd(c + i, mask, vc);
+        }
+    }
+
+#endif
+}
+
+namespace simd
+{
+    void exp(const double* x, double* y, std::size_t n)
+    {
+        switch (active_isa())
+        {
+#ifdef MC_SIMD_X86
+        case ISA::AVX512:
+            return exp_avx512(x, y, n);
+        case ISA::AVX2:
+            return exp_avx2(x, y, n);
+#endif
+        default:
+            return exp_scalar(x, y, n);
+        }
+    }
+
+    void log(const double* x, double* y, std::size_t n)
+    {
+        switch (active_isa())
+        {
+#ifdef MC_SIMD_X86
+        case ISA::AVX512:
+            return log_avx512(x, y, n);
+        case ISA::AVX2:
+            return log_avx2(x, y, n);
+#endif
+        default:
+            return log_scalar(x, y, n);
+        }
+    }
+
+    void pow(const double* x, double e, double* y, std::size_t n)
+    {
+        switch (active_isa())
+        {
+#ifdef MC_SIMD_X86
+        case ISA::AVX512:
+            return pow_avx512(x, e, y, n);
+        case ISA::AVX2:
+            return pow_avx2(x, e, y, n);
+#endif
+        default:
+            return pow_scalar(x, e, y, n);
+        }
+    }
+
+    void sqrt(const double* x, double* y, std::size_t n)
+    {
+        switch (active_isa())
+        {
+#ifdef MC_SIMD_X86
+        case ISA::AVX512:
+            return sqrt_avx512(x, y, n);
+        case ISA::AVX2:
+            return sqrt_avx2(x, y, n);
+#endif
+        default:
+            return sqrt_scalar(x, y, n);
+        }
+    }
+
+    void sincos(const double* x, double* s, double* c, std::size_t n)
+    {
+        switch (active_isa())
+        {
+#ifdef MC_SIMD_X86
+        case ISA::AVX512:
+            return sincos_avx512(x, s, c, n);
+        case ISA::AVX2:
+            return sincos_avx2(x, s, c, n);
+#endif
+        default:
+            return sincos_scalar(x, s, c, n);
+        }
+    }
+}
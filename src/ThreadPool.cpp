@@ -0,0 +1,88 @@
+// ThreadPool.cpp
+//
+// Implementation of ThreadPool.hpp
+//
+// Pierre-Yves Sojic
+//
+
+#include <algorithm>
+#include <utility>
+
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(std::size_t nThreads)
+	: m_active{}, m_stop{ false }
+{
+	if (nThreads == 0)
+		nThreads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+	m_workers.reserve(nThreads);
+	for (std::size_t i = 0; i < nThreads; ++i)
+		m_workers.emplace_back([this]() { worker(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_taskReady.notify_all();
+	m_workers.clear(); // Join before the queue and the mutex are destroyed
+}
+
+void ThreadPool::submit(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_taskReady.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_tasks.empty() && m_active == 0; });
+
+	if (m_error)
+		std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+
+std::size_t ThreadPool::size() const
+{
+	return m_workers.size();
+}
+
+void ThreadPool::worker()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_taskReady.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+		if (m_tasks.empty())
+			return; // Stopped and nothing left to run
+
+		Task task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+		++m_active;
+		lock.unlock();
+
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+			lock.lock();
+			if (!m_error)
+				m_error = std::current_exception();
+			lock.unlock();
+		}
+
+		lock.lock();
+		--m_active;
+		if (m_tasks.empty() && m_active == 0)
+			m_idle.notify_all();
+	}
+}
@@ -0,0 +1,68 @@
+// Final project - Monte Carlo Simulator
+//
+// Entry point of the batch runner: prices every job of a job file without any prompt.
+// Usage: MonteCarloBatch <jobs.csv | jobs.jsonl> [results.csv] [--threads N]
+//
+// Pierre-Yves Sojic
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BatchRunner.hpp"
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		std::vector<std::string> files;
+		std::size_t nThreads = 0; // Hardware concurrency
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			if (arg == "--threads" && i + 1 < argc)
+				nThreads = std::stoul(argv[++i]);
+			else
+				files.push_back(arg);
+		}
+		if (files.empty() || files.size() > 2)
+		{
+			std::cerr << "Usage: MonteCarloBatch <jobs.csv | jobs.jsonl> [results.csv] [--threads N]\n";
+			return 1;
+		}
+
+		std::ifstream in(files[0]);
+		if (!in)
+			throw std::invalid_argument("Cannot open the job file " + files[0]);
+		std::vector<BatchJob> jobs = BatchRunner::read_jobs(in, BatchRunner::format_of(files[0]));
+
+		BatchRunner runner(nThreads);
+		std::vector<BatchResult> results = runner.run(jobs);
+
+		// Results on the standard output unless a file is given, the summary on the error stream
+		if (files.size() == 2)
+		{
+			std::ofstream out(files[1]);
+			if (!out)
+				throw std::invalid_argument("Cannot open the result file " + files[1]);
+			BatchRunner::write_results(out, results);
+		}
+		else
+		{
+			BatchRunner::write_results(std::cout, results);
+		}
+
+		std::size_t failed = std::count_if(results.begin(), results.end(), [](const BatchResult& r) { return !r.error.empty(); });
+		std::cerr << jobs.size() << " jobs (" << failed << " failed) on " << runner.thread_count() << " threads in " << runner.duration()
+			<< "s: " << (runner.duration() > 0.0 ? 3600.0 * jobs.size() / runner.duration() : 0.0) << " jobs/hour\n";
+
+		return failed == 0 ? 0 : 2;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "ERROR: " << e.what() << std::endl;
+	}
+
+	return 1;
+}
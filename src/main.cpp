@@ -9,7 +9,7 @@
 #include <iostream>
 
 #include "MCBuilder.hpp"
-#include "MCMediator.hpp"
+#include "MCDispatch.hpp"
 
 int main()
 {
@@ -28,10 +28,20 @@ int main()
 		// Put the SDE type as template parameter
 		MCBuilder<GBM> mbuilder(od);
 		auto mparts = mbuilder.parts();
-		auto mpath = mbuilder.get_path();
-		auto mfinish = mbuilder.get_finish();
-		MCMediator mediator(mparts, mpath, mfinish, 1'000'000);
-		mediator.start();
+
+		const std::size_t nSim = 1'000'000; // Number of simulations, or cap of an adaptive run
+		double targetError;
+		std::cout << "Target standard error (0 to run all the simulations):\n";
+		std::cin >> targetError;
+
+		// The runtime choices select one of the compiled engines, the inner loop is fully inlined
+		run_dispatched(std::get<0>(mparts), *std::get<1>(mparts), *std::get<2>(mparts), *mbuilder.pricer(), nSim,
+			[=](auto& engine)
+			{
+				engine.set_block_size(64); // Advance 64 paths at once with the SIMD kernels
+				if (targetError > 0.0)
+					engine.set_target_error(targetError, nSim); // Stop as soon as the prices are precise enough
+			});
 	}
 	catch (const std::exception& e)
 	{